@@ -0,0 +1,174 @@
+#ifndef _ACTORLEARNER_H_
+#define _ACTORLEARNER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Eigen/Dense"
+
+#include "BoundedQueue.h"
+#include "MultilinearQ.h"
+#include "Philox.h"
+#include "RadialBasisQ.h"
+#include "TileCoding.h"
+
+///
+/// \brief The ActorLearner class trains an agent asynchronously, simulation and learning overlap
+///
+/// Actor threads play epsilon greedy episodes with a snapshot of the agent. They push the transitions in blocks of
+/// BLOCK_SIZE through one bounded queue, together with the features of their states, computed with one
+/// activateBatch() per block. Learner threads pop the blocks and apply the Q-learning updates to the agent (Hogwild,
+/// the atomic updates of the agent). Every PUBLISH_INTERVAL learned transitions a learner publishes a new snapshot,
+/// the actors pick it up at the start of their next episode.
+///
+/// The agent is the template argument, it needs the interface of a LinearQ agent: the Features type, activate(),
+/// activateBatch(), actionValues(), actionValuesAtomic(), update(), snapshot(), reward(), argmax() and the constants
+/// ACTIONS, GAMMA, EPSILON and STEPS. The pipeline is compiled for TileCoding, MultilinearQ and RadialBasisQ, add an
+/// explicit instantiation at the end of ActorLearner.cpp for another agent.
+///
+/// If the learners fall behind, the queue fills up and the actors wait (backpressure), the policy of the actors is at
+/// most a queue of transitions older than the agent. Counters of every stage are available while running, see
+/// getStatistics().
+///
+/// The threads run in the background between start() and stop(), the caller can render or save snapshots meanwhile.
+/// The order of the updates depends on the scheduling, runs are not reproducible, unlike LinearQ::training().
+///
+template <typename Agent>
+class ActorLearner
+{
+public:
+
+  /// The counters of the stages since start()
+  struct Statistics
+  {
+    /// Simulated steps and finished episodes of all actors
+    std::uint64_t steps, episodes;
+
+    /// Blocks pushed by the actors and the pushes that had to wait for a full queue
+    std::uint64_t pushed, stalls;
+
+    /// Transitions learned and the number of times a learner had to wait for an empty queue
+    std::uint64_t learned, idles;
+
+    /// Published snapshots and the blocks in the queue now
+    std::uint64_t snapshots, queued;
+
+    /// The time from start() to now or to stop() in seconds
+    double seconds;
+  };
+
+  ///
+  /// \brief ActorLearner Prepares the pipeline, no thread runs yet
+  /// \param agent The agent to train, must outlive the pipeline and must not be used elsewhere while running
+  /// \param actors The number of actor threads, all hardware threads but the learners if 0
+  /// \param learners The number of learner threads
+  /// \param seed The seed of the start states and of the exploration
+  /// \param queue_blocks The capacity of the queue in blocks, a power of two
+  ///
+  /// Throws std::invalid_argument if there is no learner or the capacity is no power of two.
+  ///
+  explicit ActorLearner(Agent& agent, int actors = 0, int learners = 1,
+                        std::uint64_t seed = Philox4x32::clockSeed(), std::size_t queue_blocks = 256);
+
+  /// Stops the threads
+  ~ActorLearner();
+
+  ActorLearner(const ActorLearner&) = delete;
+  ActorLearner& operator=(const ActorLearner&) = delete;
+
+  ///
+  /// \brief start Publishes a first snapshot and starts the actors and learners, nothing happens if already running
+  ///
+  void start();
+
+  ///
+  /// \brief stop Stops the actors, lets the learners empty the queue and publishes a last snapshot
+  ///
+  void stop();
+
+  /// \return true between start() and stop()
+  bool isRunning() const { return m_running.load(std::memory_order_relaxed); }
+
+  ///
+  /// \brief getSnapshot The latest published copy of the agent, safe while running
+  ///
+  /// The copy stays valid as long as the pointer is held, e.g. during rendering or saving.
+  ///
+  std::shared_ptr<const Agent> getSnapshot() const;
+
+  /// \return the counters since start(), safe while running
+  Statistics getStatistics() const;
+
+  /// \return the number of actor threads
+  int getActors() const { return m_actors; }
+
+  /// \return the number of learner threads
+  int getLearners() const { return m_learners; }
+
+  /// Transitions per block in the queue
+  static const int BLOCK_SIZE;
+
+  /// Learned transitions between two snapshots
+  static const std::uint64_t PUBLISH_INTERVAL;
+
+private:
+
+  ///
+  /// \brief The Block struct holds BLOCK_SIZE transitions and the features of their states
+  ///
+  /// Within an episode the successor of one transition is the state of the next one, hence every state is stored
+  /// once, transition i goes from state current(i) to state next(i).
+  ///
+  struct Block
+  {
+    Eigen::MatrixXd states;
+    typename Agent::Features features;
+    Eigen::VectorXi current, next, actions;
+    Eigen::VectorXd rewards;
+    Eigen::Matrix<bool, Eigen::Dynamic, 1> terminals;
+
+    /// The number of transitions and of states
+    int size = 0, states_size = 0;
+  };
+
+  /// The loop of actor number actor
+  void act(int actor);
+
+  /// The loop of a learner
+  void learn();
+
+  /// Copies the agent and makes the copy the current snapshot
+  void publish();
+
+private:
+
+  Agent& m_agent;
+  int m_actors, m_learners;
+  std::uint64_t m_seed;
+
+  BoundedQueue<Block> m_queue;
+
+  /// The current snapshot, read and replaced with the atomic functions of std::shared_ptr
+  std::shared_ptr<const Agent> m_snapshot;
+
+  std::vector<std::thread> m_actor_threads, m_learner_threads;
+
+  /// Set by start(), cleared by stop() for the actors, m_actors_done tells the learners that no block follows
+  std::atomic<bool> m_running, m_actors_done;
+
+  /// The counters, each stage adds once per block
+  std::atomic<std::uint64_t> m_steps, m_episodes, m_pushed, m_stalls, m_learned, m_idles, m_snapshots;
+
+  /// The steady clock at start() and at stop() in nanoseconds
+  std::atomic<std::int64_t> m_start, m_stop;
+};
+
+extern template class ActorLearner<TileCoding>;
+extern template class ActorLearner<MultilinearQ>;
+extern template class ActorLearner<RadialBasisQ>;
+
+#endif // _ACTORLEARNER_H_
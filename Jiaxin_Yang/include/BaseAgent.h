@@ -84,6 +84,76 @@ public:
   ///
   virtual Eigen::VectorXd getQfactor(const Eigen::Ref<const Eigen::VectorXd>& state) const = 0;
 
+  ///
+  /// \brief policyBatch
+  /// \param states many continuous states, one per column
+  /// \param actions receives the action for each state, one per column, the size has to match
+  ///
+  /// The same as calling policy() for every column.
+  /// The default implementation does exactly this, override it if your policy can process all states at once,
+  /// e.g. a linear policy as one matrix product A * S.
+  /// Throws std::invalid_argument if the number of columns differs.
+  ///
+  virtual void policyBatch(const Eigen::Ref<const Eigen::MatrixXd>& states,
+                           Eigen::Ref<Eigen::MatrixXd> actions) const;
+
+  ///
+  /// \brief rewardBatch
+  /// \param states many continuous states, one per column
+  /// \param actions the action executed in each state, one per column
+  /// \param states_prime the successor state of each transition, one per column
+  /// \param rewards receives r(s, a, s') for each column, the size has to match
+  ///
+  /// The same as calling reward() for every column, the default implementation loops.
+  /// Throws std::invalid_argument if the number of columns differs.
+  ///
+  virtual void rewardBatch(const Eigen::Ref<const Eigen::MatrixXd>& states,
+                           const Eigen::Ref<const Eigen::MatrixXd>& actions,
+                           const Eigen::Ref<const Eigen::MatrixXd>& states_prime,
+                           Eigen::Ref<Eigen::VectorXd> rewards) const;
+
+  ///
+  /// \brief qValuesBatch
+  /// \param states many continuous states, one per column
+  /// \param actions one action per state, one per column
+  /// \param Q receives the Q-factor of each state action tuple, the size has to match
+  ///
+  /// The same as calling getQfactor(state, action) for every column, the default implementation loops.
+  /// Throws std::invalid_argument if the number of columns differs.
+  ///
+  virtual void qValuesBatch(const Eigen::Ref<const Eigen::MatrixXd>& states,
+                            const Eigen::Ref<const Eigen::MatrixXd>& actions,
+                            Eigen::Ref<Eigen::VectorXd> Q) const;
+
+  ///
+  /// \brief qValuesBatch
+  /// \param states many continuous states, one per column
+  /// \param Q receives the Q-factors of all actions, one column per state
+  ///
+  /// The same as calling getQfactor(state) for every column.
+  /// Q gets resized to (number of actions) x (number of states) if it does not have this size yet,
+  /// reuse the same matrix to avoid allocations. The default implementation loops.
+  ///
+  /// If you override only one of the two overloads, add `using BaseAgent::qValuesBatch;` to your class,
+  /// otherwise the other one is hidden.
+  ///
+  /// \overload
+  ///
+  virtual void qValuesBatch(const Eigen::Ref<const Eigen::MatrixXd>& states,
+                            Eigen::MatrixXd& Q) const;
+
+protected:
+
+  ///
+  /// \brief checkColumns Size check for the batch functions, also for the ones of your agent
+  /// \param name the name of the checked argument, for the error message
+  /// \param cols the number of columns (or entries) of the argument
+  /// \param expected the number of states in the batch
+  ///
+  /// Throws std::invalid_argument if the numbers differ.
+  ///
+  static void checkColumns(const char* name, Eigen::Index cols, Eigen::Index expected);
+
 private:
 
 };
@@ -0,0 +1,141 @@
+#ifndef _BOUNDEDQUEUE_H_
+#define _BOUNDEDQUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+///
+/// \brief The BoundedQueue class is a lock free queue of fixed capacity for many producers and many consumers
+///
+/// A ring of cells, every cell has a sequence number which tells whether it is free for the producer of a position
+/// or filled for the consumer of a position (D. Vyukov's bounded MPMC queue). A producer or consumer claims a position
+/// with one compare and swap on the shared counter and then owns the cell, the values are moved in and out.
+///
+/// tryPush() fails instead of waiting if the queue is full, tryPop() if it is empty. The caller decides whether to
+/// retry, wait or drop, i.e. the queue gives backpressure to the producers.
+///
+template <typename T>
+class BoundedQueue
+{
+public:
+
+  ///
+  /// \brief BoundedQueue Creates an empty queue
+  /// \param capacity The number of values the queue holds, a power of two
+  ///
+  /// Throws std::invalid_argument if the capacity is no power of two.
+  ///
+  explicit BoundedQueue(std::size_t capacity) :
+    m_cells(capacity), m_mask(capacity - 1), m_head(0), m_tail(0)
+  {
+    if (capacity < 2 or (capacity & (capacity - 1)) != 0)
+    {
+      std::stringstream ss;
+      ss << "Invalid capacity of a bounded queue: " << capacity << ", must be a power of two";
+      throw std::invalid_argument(ss.str());
+    }
+
+    for (std::size_t i = 0; i < capacity; ++i)
+      m_cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  ///
+  /// \brief tryPush Moves a value into the queue
+  /// \return false if the queue is full, the value is untouched then
+  ///
+  bool tryPush(T& value)
+  {
+    std::size_t position = m_tail.load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+      Cell& cell = m_cells[position & m_mask];
+      const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      const std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+
+      if (difference == 0)
+      {
+        // The cell is free for this position, claim the position
+        if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+        {
+          cell.value = std::move(value);
+          cell.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (difference < 0)
+        return false;
+      else
+        position = m_tail.load(std::memory_order_relaxed);
+    }
+  }
+
+  ///
+  /// \brief tryPop Moves the oldest value out of the queue
+  /// \return false if the queue is empty, the value is untouched then
+  ///
+  bool tryPop(T& value)
+  {
+    std::size_t position = m_head.load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+      Cell& cell = m_cells[position & m_mask];
+      const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      const std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+
+      if (difference == 0)
+      {
+        // The cell holds the value of this position, claim the position
+        if (m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+        {
+          value = std::move(cell.value);
+          cell.sequence.store(position + m_mask + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (difference < 0)
+        return false;
+      else
+        position = m_head.load(std::memory_order_relaxed);
+    }
+  }
+
+  /// \return the number of values in the queue, only approximate while other threads push or pop
+  std::size_t getSize() const
+  {
+    const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    const std::size_t head = m_head.load(std::memory_order_relaxed);
+
+    return tail > head ? tail - head : 0;
+  }
+
+  /// \return the number of values the queue holds
+  std::size_t getCapacity() const { return m_cells.size(); }
+
+private:
+
+  /// A value and the position it is free or filled for
+  struct Cell
+  {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+
+  std::vector<Cell> m_cells;
+  std::size_t m_mask;
+
+  /// The next positions to pop and to push, on separate cache lines, consumers and producers do not share them
+  alignas(64) std::atomic<std::size_t> m_head;
+  alignas(64) std::atomic<std::size_t> m_tail;
+};
+
+#endif // _BOUNDEDQUEUE_H_
@@ -0,0 +1,230 @@
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "Eigen/Dense"
+
+///
+/// \brief The Checkpoint struct describes the binary file format of the agent checkpoints
+///
+/// A checkpoint is a header, a table of contents and the data of named sections:
+///
+///     Header | Entry 0 ... Entry N-1 | section 0 | section 1 | ...
+///
+/// Everything is stored as in memory (little endian, IEEE doubles, Eigen's column major order) and every section
+/// starts on a multiple of ALIGNMENT bytes. A reader maps the file read-only and uses the arrays in place,
+/// there is no parsing and nothing gets converted.
+///
+/// The header holds a magic number, the format version and the kind of agent (e.g. "QLearning"), hence a program
+/// can find out which agent to create before loading it. Readers reject newer versions and other byte orders.
+///
+struct Checkpoint
+{
+  /// The first eight bytes of every checkpoint
+  static constexpr char MAGIC[8] = {'H', 'A', 'X', 'C', 'K', 'P', 'T', '\0'};
+
+  /// The version of the format, increase it for every incompatible change
+  static const std::uint32_t VERSION = 1;
+
+  /// The alignment of the sections in the file and thus in the mapped memory, one cache line
+  static const std::size_t ALIGNMENT = 64;
+
+  /// The longest name of a section or of a kind, including the terminating zero
+  static const std::size_t NAME_LENGTH = 32;
+
+  /// The beginning of the file, padded to the alignment
+  struct alignas(ALIGNMENT) Header
+  {
+    char magic[8];
+    std::uint32_t version;
+
+    /// 0x01020304 as written by the machine, detects a different byte order
+    std::uint32_t byte_order;
+
+    /// The number of sections and the size of the whole file in bytes
+    std::uint64_t sections, file_size;
+
+    /// The kind of agent
+    char kind[NAME_LENGTH];
+  };
+
+  /// One section in the table of contents
+  struct Entry
+  {
+    char name[NAME_LENGTH];
+
+    /// The position in the file and the size in bytes
+    std::uint64_t offset, bytes;
+
+    /// The shape for matrices, both 0 for raw data
+    std::uint64_t rows, cols;
+  };
+
+  static_assert(sizeof(Header) == 64 and sizeof(Entry) == 64, "The checkpoint layout must not depend on the compiler");
+};
+
+///
+/// \brief The CheckpointWriter class collects sections and writes them as one checkpoint
+///
+/// The arrays of the sections (add(), addMatrix()) are not copied, they have to stay valid until write() returns.
+/// Single values (addValue()) are copied.
+///
+/// write() creates the file under a temporary name, flushes it to the disk and renames it. The rename is atomic,
+/// hence a reader (e.g. a GUI showing the agent while it trains) sees either the old or the new checkpoint,
+/// never a partially written one. A reader which mapped the old file keeps its data.
+///
+class CheckpointWriter
+{
+public:
+
+  ///
+  /// \brief CheckpointWriter Starts an empty checkpoint
+  /// \param kind The kind of agent, stored in the header
+  ///
+  explicit CheckpointWriter(const std::string& kind);
+
+  ///
+  /// \brief add Adds a section of raw bytes
+  ///
+  /// Throws std::invalid_argument for an empty or too long name or a name used twice.
+  ///
+  void add(const std::string& name, const void* data, std::size_t bytes);
+
+  ///
+  /// \brief addValue Adds a section with one trivially copyable value, e.g. a struct of settings
+  ///
+  template <typename T>
+  void addValue(const std::string& name, const T& value)
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be stored");
+    add(name, &value, sizeof(T));
+    m_sections.back().copy.assign(reinterpret_cast<const char*>(&value), reinterpret_cast<const char*>(&value) + sizeof(T));
+  }
+
+  ///
+  /// \brief addMatrix Adds a section with a matrix (or vector) of doubles and its shape
+  ///
+  void addMatrix(const std::string& name, const Eigen::Ref<const Eigen::MatrixXd>& matrix);
+
+  ///
+  /// \brief write Writes the checkpoint atomically
+  /// \param path The file name, an existing file gets replaced
+  ///
+  /// The data goes into a uniquely named temporary file next to the target, which then replaces it with rename(),
+  /// concurrent writers of the same path do not share a temporary file. The file and its directory are synced, the
+  /// new checkpoint survives a crash once write() returns.
+  ///
+  /// Throws std::runtime_error if a file operation fails, the existing file then stays untouched (unless only the
+  /// sync of the directory fails, the new file is in place then but may not be durable).
+  ///
+  void write(const std::string& path) const;
+
+private:
+
+  struct Section
+  {
+    Checkpoint::Entry entry;
+
+    /// The data of the section, or its copy if not empty
+    const void* data;
+    std::vector<char> copy;
+  };
+
+  /// The kind of agent
+  std::string m_kind;
+
+  /// The sections in the order of add()
+  std::vector<Section> m_sections;
+};
+
+///
+/// \brief The CheckpointReader class maps a checkpoint read-only into memory
+///
+/// Opening costs one mmap and a check of the header and the table of contents, independent of the size of the file.
+/// The pages of a section are only read from the disk when they are touched. The data stays valid as long as the reader
+/// exists, even if a writer replaces the file meanwhile.
+///
+class CheckpointReader
+{
+public:
+
+  ///
+  /// \brief CheckpointReader Opens and maps a checkpoint
+  ///
+  /// Throws std::runtime_error if the file cannot be mapped, is no checkpoint, has a newer version,
+  /// another byte order or sections outside of the file.
+  ///
+  explicit CheckpointReader(const std::string& path);
+  ~CheckpointReader();
+
+  CheckpointReader(const CheckpointReader&) = delete;
+  CheckpointReader& operator=(const CheckpointReader&) = delete;
+
+  ///
+  /// \brief exists
+  /// \return true, if the file exists and can be read, it is not checked whether it is a checkpoint
+  ///
+  static bool exists(const std::string& path);
+
+  /// \return the kind of agent
+  std::string getKind() const { return header().kind; }
+
+  /// \return the version of the format the file was written with
+  std::uint32_t getVersion() const { return header().version; }
+
+  /// \return true, if there is a section with this name
+  bool has(const std::string& name) const { return find(name) != nullptr; }
+
+  ///
+  /// \brief data
+  /// \param name The name of the section, throws std::runtime_error if there is none
+  /// \param bytes receives the size of the section
+  /// \return the mapped data of the section, aligned to Checkpoint::ALIGNMENT
+  ///
+  const void* data(const std::string& name, std::size_t& bytes) const;
+
+  ///
+  /// \brief value
+  /// \return the value stored with CheckpointWriter::addValue(), throws std::runtime_error if the size differs
+  ///
+  template <typename T>
+  T value(const std::string& name) const
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be stored");
+    T value;
+    copy(name, &value, sizeof(T));
+    return value;
+  }
+
+  ///
+  /// \brief matrix
+  /// \return the mapped matrix stored with CheckpointWriter::addMatrix(), without a copy
+  ///
+  Eigen::Map<const Eigen::MatrixXd> matrix(const std::string& name) const;
+
+private:
+
+  const Checkpoint::Header& header() const { return *static_cast<const Checkpoint::Header*>(m_data); }
+
+  /// \return the entry of a section, nullptr if there is none
+  const Checkpoint::Entry* find(const std::string& name) const;
+
+  /// Copies a section of exactly this size, throws std::runtime_error otherwise
+  void copy(const std::string& name, void* destination, std::size_t bytes) const;
+
+private:
+
+  /// The file name, for error messages
+  std::string m_path;
+
+  /// The mapped file
+  void* m_data;
+  std::size_t m_size;
+};
+
+#endif // _CHECKPOINT_H_
@@ -0,0 +1,173 @@
+#ifndef _DISCRETIZER_H_
+#define _DISCRETIZER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "Eigen/Dense"
+
+#include "HaxBallField.h"
+
+///
+/// \brief The Discretizer class maps continuous states to the cells of a grid
+///
+/// Each dimension of the grid is a feature of the state with its own range and resolution.
+/// A feature is a linear combination of the state components, this covers a single component (e.g. the ball velocity)
+/// as well as derived quantities like the player ball offset s(0) - s(2).
+/// The grid points are the multiples of the resolution, like std::round(value / resolution) * resolution,
+/// and values outside of the range are clipped. The range is rounded to grid points as well,
+/// hence a dimension from low to high with resolution r has round(high / r) - round(low / r) + 1 cells.
+///
+/// The cell index is the Morton code (Z-order) of the grid coordinates: the bits of all dimensions are interleaved.
+/// Cells that are close in the state space are close in memory, which keeps the Q-values of the cells along
+/// a trajectory in few cache lines and pages. Every dimension gets the bits of its next power of two,
+/// so the index range (getIndexRange()) can be larger than the number of cells.
+///
+class Discretizer
+{
+public:
+
+  /// Cell indices of many states
+  typedef Eigen::Matrix<std::uint64_t, Eigen::Dynamic, 1> IndexVector;
+
+  ///
+  /// \brief Discretizer Creates a discretizer without dimensions, add them with addDimension()
+  /// \param state_dimension The size of the state vectors
+  ///
+  explicit Discretizer(int state_dimension = HaxBallField::STATE_DIMENSION);
+
+  ///
+  /// \brief addDimension Adds a feature to the grid
+  /// \param weights The feature is the inner product of these weights and the state
+  /// \param low The smallest value on the grid, smaller values are clipped
+  /// \param high The largest value on the grid, larger values are clipped
+  /// \param resolution The distance between two grid points
+  /// \return the number of the new dimension
+  ///
+  /// Throws std::invalid_argument for an empty range, a resolution <= 0, weights of the wrong size
+  /// or if the index would not fit into 64 bits anymore.
+  ///
+  int addDimension(const Eigen::Ref<const Eigen::VectorXd>& weights, double low, double high, double resolution);
+
+  ///
+  /// \brief addDimension Adds a state component to the grid
+  /// \param component The index in the state vector
+  ///
+  /// \overload
+  ///
+  int addDimension(int component, double low, double high, double resolution);
+
+  /// \return the number of dimensions of the grid
+  int getDimensions() const { return static_cast<int>(m_dimensions.size()); }
+
+  /// \return the number of cells along a dimension
+  int getCells(int dimension) const { return m_dimensions[dimension].cells; }
+
+  /// \return the number of cells of the grid
+  std::uint64_t getCells() const;
+
+  /// \return one more than the largest cell index, the size of a table indexed by the cell index
+  std::uint64_t getIndexRange() const { return std::uint64_t(1) << m_bits_total; }
+
+  ///
+  /// \brief features
+  /// \param state a continuous state
+  /// \param features receives the features of the state, one per dimension (not rounded, not clipped)
+  ///
+  void features(const Eigen::Ref<const Eigen::VectorXd>& state, Eigen::Ref<Eigen::VectorXd> features) const;
+
+  ///
+  /// \brief snap
+  /// \param state a continuous state
+  /// \param values receives the grid point of each feature, i.e. the features rounded and clipped to the grid
+  ///
+  void snap(const Eigen::Ref<const Eigen::VectorXd>& state, Eigen::Ref<Eigen::VectorXd> values) const;
+
+  ///
+  /// \brief index
+  /// \param state a continuous state
+  /// \return the cell index of the state
+  ///
+  std::uint64_t index(const Eigen::Ref<const Eigen::VectorXd>& state) const;
+
+  ///
+  /// \brief indexOfFeatures
+  /// \param features the features of a state, e.g. the values returned by snap()
+  /// \return the cell index
+  ///
+  std::uint64_t indexOfFeatures(const Eigen::Ref<const Eigen::VectorXd>& features) const;
+
+  ///
+  /// \brief indexBatch
+  /// \param states many continuous states, one per column
+  /// \param indices receives the cell index of each state, the size has to match
+  ///
+  /// Features, rounding and clipping run dimension by dimension over all states, which vectorises.
+  ///
+  void indexBatch(const Eigen::Ref<const Eigen::MatrixXd>& states, Eigen::Ref<IndexVector> indices) const;
+
+  ///
+  /// \brief center
+  /// \param index a cell index
+  /// \param values receives the grid point of the cell, one value per dimension
+  ///
+  void center(std::uint64_t index, Eigen::Ref<Eigen::VectorXd> values) const;
+
+  /// The largest number of index bits
+  static const int MAX_BITS = 63;
+
+private:
+
+  ///
+  /// \brief gridIndex
+  /// \return the grid coordinate of a feature value along a dimension, rounded and clipped
+  ///
+  int gridIndex(int dimension, double feature) const;
+
+  ///
+  /// \brief feature
+  /// \return the value of one feature of a state, only the non zero weights are used
+  ///
+  double feature(int dimension, const Eigen::Ref<const Eigen::VectorXd>& state) const;
+
+  ///
+  /// \brief updateLayout Distributes the index bits among the dimensions and fills the lookup tables
+  ///
+  void updateLayout();
+
+private:
+
+  /// Everything the index computation needs about one dimension, in one place
+  struct Dimension
+  {
+    /// The distance between two grid points and its inverse
+    double resolution, inverse;
+
+    /// The first grid point as multiple of the resolution
+    long first;
+
+    /// The number of cells and of index bits
+    int cells, bits;
+
+    /// The non zero weights of the feature are the terms [terms_begin, terms_end)
+    int terms_begin, terms_end;
+  };
+
+  /// The size of the state vectors
+  int m_state_dimension;
+
+  /// The dimensions of the grid
+  std::vector<Dimension> m_dimensions;
+
+  /// The non zero weights of all features and their state components
+  std::vector<double> m_terms_weight;
+  std::vector<int> m_terms_component;
+
+  /// The total number of index bits
+  int m_bits_total;
+
+  /// For every dimension and grid coordinate the bits of the coordinate at their places in the Morton code
+  std::vector<std::vector<std::uint64_t>> m_spread;
+};
+
+#endif // _DISCRETIZER_H_
@@ -1,10 +1,11 @@
 #ifndef _DUMMYAGENT_H_
 #define _DUMMYAGENT_H_
 
-#include <random>
+#include <cstdint>
 
 #include "BaseAgent.h"
-#include "HaxBall.h"
+#include "HaxBallField.h"
+#include "Philox.h"
 
 #include "Eigen/Dense"
 
@@ -18,7 +19,11 @@
 class DummyAgent : public BaseAgent
 {
 public:
-  DummyAgent();
+  ///
+  /// \brief DummyAgent Creates a new agent
+  /// \param seed The seed of all random numbers in the training, taken from the clock if not specified
+  ///
+  explicit DummyAgent(std::uint64_t seed = Philox4x32::clockSeed());
   ~DummyAgent();
 
   /// Currently the policy "constant right and shoot"
@@ -53,6 +58,7 @@ private:
   ///
   /// \brief training_worker The actual place where training happens
   /// \param length The length of a trajectory in the HaxBall world
+  /// \param random_engine The private random numbers of this trajectory, e.g. for exploration and to seed the environment
   ///
   /// Put the training code and an environment instance in here, such that each thread has
   /// its private copy of the memory.
@@ -64,14 +70,12 @@ private:
   /// a huge Q-table.
   /// Values that change during reading will be corrected over time.
   ///
-  void training_worker(int length);
+  void training_worker(int length, Philox4x32& random_engine);
 
 private:
 
-  /// A passive and private game instance for getting details about the game (e.g. the goal position for the reward computation)
-  /// Do not use this single instance for multithreaded training, as this would mess up its internal state
-  /// (That is the reason why this instance is constant)
-  const HaxBall m_world;
+  /// The seed of the training and the number of calls to training(), each trajectory derives its own random stream
+  std::uint64_t m_seed, m_iteration;
 
 };
 
@@ -2,6 +2,7 @@
 #define _EVALUATIONCENTER_H_
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "HaxBall.h"
@@ -55,9 +56,24 @@ public:
   ///
   /// The code to run a rollout from a given start state.
   /// Resets the environment, sets the state and collects transitions.
+  /// evaluate() does not use it, it runs the rollouts of all probes at once with Rollout::rolloutBatch().
   ///
   double rollout(const Eigen::Ref<const Eigen::VectorXd>& start_state);
 
+  ///
+  /// \brief precisionReport Compares the single and the double precision simulation on long rollouts
+  /// \param filename The .csv file receiving the results, existing content is overwritten
+  /// \return the largest state difference over all probes
+  ///
+  /// Runs TAU steps from every probe in HaxBallCore and in HaxBallCoreF.
+  /// The actions are computed by the agent on the double precision trajectory and replayed in the float simulation,
+  /// hence all differences are caused by the precision of the simulation and not by the agent.
+  ///
+  /// Writes one row per probe: largest and final state difference (maximum norm),
+  /// the first step with a difference above DIVERGENCE (-1 if none), both discounted returns and the goals of both runs.
+  ///
+  double precisionReport(const std::string& filename = "precision.csv") const;
+
 private:
 
   ///
@@ -83,6 +99,9 @@ public:
   /// The length of rollouts, should be long enough to reflect gamma
   static const unsigned int TAU = 1000;
 
+  /// The state difference at which precisionReport() considers two trajectories as diverged
+  static constexpr double DIVERGENCE = 1e-3;
+
 private:
 
   /// This HaxBall instance is used for testing an agent and to querry the rendering details
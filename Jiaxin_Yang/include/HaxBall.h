@@ -1,13 +1,13 @@
 #ifndef _HAXBALL_H_
 #define _HAXBALL_H_
 
-#include <random>
-
 #include <QObject>
 #include <QRectF>
 
 #include "Eigen/Dense"
 
+#include "HaxBallCore.h"
+
 ///
 /// \brief The HaxBall class with the differential equations
 ///
@@ -17,6 +17,9 @@
 /// This class uses QT code, because QRectF and others are quite handy.
 /// Also the signal slot mechanism is available, let me know what you need and I add it here.
 ///
+/// The simulation itself lives in HaxBallCore, this class is a thin QObject adapter around it for the GUI.
+/// For headless training use HaxBallCore directly, it is much cheaper to create and copy.
+///
 /// Important: The game uses Qt's coordinate system
 ///   +------> x
 ///   |
@@ -72,6 +75,12 @@ public:
   ///
   qreal getMaxSpeedPlayer() const;
 
+  ///
+  /// \brief getFriction
+  /// \return the fraction of the ball velocity which survives one sub step
+  ///
+  qreal getFriction() const;
+
   ///
   /// \brief getSize
   /// \return the size of the playing ground
@@ -196,6 +205,15 @@ public:
   ///
   void step(const Eigen::Ref<const Eigen::VectorXd>& action);
 
+  ///
+  /// \brief step Executes the action in the world and reports the outcome in one call
+  /// \param action the action to execute
+  /// \param info receives successor state, goal events and the terminal flag, see HaxBallCore::StepInfo
+  ///
+  /// \overload
+  ///
+  void step(const Eigen::Ref<const Eigen::VectorXd>& action, HaxBallCore::StepInfo& info);
+
   ///
   /// \brief Returns the dimension of the state space
   /// \return the (hardcoded) number of state dimensions of the control problem
@@ -208,6 +226,14 @@ public:
   ///
   int getActionDimension() const { return 3; }
 
+  ///
+  /// \brief setStepMode
+  /// \param mode Switches the integration of step() between fixed sub steps and the event driven scheme
+  ///
+  /// See HaxBallCore::StepMode, useful to compare both schemes in the GUI.
+  ///
+  void setStepMode(HaxBallCore::StepMode mode);
+
   ///
   /// \brief reset Resets the state to some random value in the state space
   ///
@@ -219,6 +245,27 @@ public:
   ///
   void reset();
 
+  ///
+  /// \brief seed Restarts the random numbers used by reset()
+  /// \param seed The seed of the random numbers
+  /// \param stream The random stream of this environment
+  ///
+  /// See HaxBallCore::seed(), call reset() afterwards for a reproducible start state.
+  ///
+  void seed(std::uint64_t seed, std::uint64_t stream = 0);
+
+  ///
+  /// \brief snapshot
+  /// \return a copy of the complete dynamic state, see HaxBallCore::Snapshot
+  ///
+  HaxBallCore::Snapshot snapshot() const;
+
+  ///
+  /// \brief restore Continues exactly where a snapshot was taken, without checks or resets
+  /// \param snapshot A snapshot of an environment with the same opponent setting
+  ///
+  void restore(const HaxBallCore::Snapshot& snapshot);
+
   ///
   /// \brief hasOpponent
   /// \return true, if an opponent is present
@@ -243,89 +290,24 @@ public:
   ///
   int getOpponentGoals() const;
 
-private:
-
   ///
-  /// \brief step Executes the action in the world
-  /// \param action the action to execute
-  ///
-  /// This function should be fail safe, once it returns the internal state is updated.
-  /// The step is not thread safe!
+  /// \brief core
+  /// \return the simulation core, e.g. to copy it into a training thread
   ///
-  /// The substep executes a fraction of the intended time to elapse.
-  /// This mechanism is required for proper collision handling.
-  ///
-  void subStep(const Eigen::Ref<const Eigen::VectorXd>& action);
-
-  ///
-  /// \brief resets other variables outside of the state vector
-  ///
-  /// This function is responsible to reset additional variables of the environment
-  /// such as the was-in-goal indicators.
-  ///
-  void resetOthers();
+  const HaxBallCore& core() const;
 
   ///
-  /// \brief collision Handles the collision between two particles
-  /// \param p1 Position of Particle 1
-  /// \param v1 Velocity of Particle 1
-  /// \param r1 Radius of Particle 1
-  /// \param p2 Position of Particle 2
-  /// \param v2 Velocity of Particle 2
-  /// \param r2 Radius of Particle 2
-  ///
-  /// Particle 1 is infinte heavy.
-  /// Particle 2 has no mass, in bounces perfectly at the surface of particle 1.
+  /// \brief core
+  /// \return the simulation core
   ///
-  /// The method corrects penetrations between particles by projecting Particle 2 back to the surface
-  /// The vectors remain unchanged if there is no collision (distance > sum of radii)
+  /// \overload
   ///
-  void collision(Eigen::Ref<Eigen::Vector2d> p1, Eigen::Ref<Eigen::Vector2d> v1, double r1,
-                 Eigen::Ref<Eigen::Vector2d> p2, Eigen::Ref<Eigen::Vector2d> v2, double r2, const float elasticity) const;
-
-  ///
-  /// \brief random_number Produces a random number in given interval
-  /// \param low lower limit of interval
-  /// \param high higher limit of interval
-  /// \return the random number
-  ///
-  /// Attention: uses a dirty hack instead of the proper std::c++ random machanism with that distribution parameter info thing.
-  ///
-  double random_number(double low, double high);
+  HaxBallCore& core();
 
 private:
 
-  // Stuff for the random number generator, these things are not thread safe -> do not use one haxball environment in multiple threads
-  std::random_device m_random_device;
-  std::mt19937 m_random_engine;
-  std::uniform_real_distribution<> m_uniform_dist;
-
-  // Variables to describe the simulation
-  QRectF m_size, m_goal_left, m_goal_right;
-  const qreal m_radius_player, m_radius_ball, m_distance_goalkeeper;
-  const qreal m_dt, m_sub_dt, m_max_speed_player, m_max_speed_ball, m_friction, m_shoot_dist;
-
-  // Variables to make the work with an agent easier
-  bool m_wasInLeftGoal, m_wasInRightGoal;
-
-  // A true column vector with getNO() components
-  Eigen::VectorXd m_state;
-
-  // Change its value in the constructor to switch between easy mode or with oppnent
-  const bool m_has_opponent;
-
-  // The position of the opponent, it is defined directly from the state vector and can stay outside of m_state
-  // The variable must be a member for rendering.
-  Eigen::Vector2d m_position_opponent;
-
-  // The velocity of the opponent, currently it is always zero and just required to call the collision function
-  Eigen::Vector2d m_velocity_opponent;
-
-  // The right goal center as Eigen::Vector for easy computations
-  Eigen::Vector2d m_goal_right_center;
-
-  // Number of goals
-  int m_num_agent_goals, m_num_opponent_goals;
+  // The actual game, without any Qt dependency
+  HaxBallCore m_core;
 };
 
 #endif // _HAXBALL_H_
@@ -0,0 +1,193 @@
+#ifndef _HAXBALLBATCH_H_
+#define _HAXBALLBATCH_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "Eigen/Dense"
+
+#include "HaxBallField.h"
+#include "Philox.h"
+
+///
+/// \brief The HaxBallBatch class simulates many HaxBall environments at once
+///
+/// The batch holds the state of N independent environments in structure-of-arrays form:
+/// every component of the state (player x, player y, ..., ball velocity y) is a contiguous column
+/// over all environments. One call to step() advances all environments by one time step.
+///
+/// The physics is the same as in HaxBall::step(), only written over the environment axis such that
+/// the compiler can use SIMD instructions for friction, integration, collisions, clipping, shooting and goals.
+/// Branches of the scalar code are replaced by selects, hence each environment produces the same successor state
+/// as a single HaxBall instance fed with the same state and action.
+///
+/// States and actions are exchanged as matrices with one column per environment (like the particles of the CEM),
+/// i.e., getStateDimension() x size() and getActionDimension() x size().
+///
+/// The batch is not thread safe, but step() itself splits the environments into blocks and processes them with OpenMP.
+///
+class HaxBallBatch
+{
+public:
+  ///
+  /// \brief HaxBallBatch Creates a batch of new HaxBall environments
+  /// \param size The number of environments in the batch
+  /// \param has_opponent Enables or disables the opponent in all environments
+  /// \param seed The seed of the random numbers for resetting, taken from the clock if not specified
+  ///
+  /// The physical constants are taken from HaxBallField, all environments are reset randomly.
+  /// Environment i draws from random stream i, so it gets the same start states as HaxBallCore(has_opponent, seed, i).
+  ///
+  explicit HaxBallBatch(int size, bool has_opponent = true, std::uint64_t seed = Philox4x32::clockSeed());
+  ~HaxBallBatch();
+
+  ///
+  /// \brief size
+  /// \return the number of environments in the batch
+  ///
+  int size() const;
+
+  ///
+  /// \brief getState
+  /// \param i Index of the environment
+  /// \param state An eigen reference to a column vector, it receives a copy of the state vector of environment i
+  ///
+  void getState(int i, Eigen::Ref<Eigen::VectorXd> state) const;
+
+  ///
+  /// \brief getStates
+  /// \param states Receives the states of all environments, one column per environment
+  ///
+  /// The reference must have the size getStateDimension() x size()
+  ///
+  void getStates(Eigen::Ref<Eigen::MatrixXd> states) const;
+
+  ///
+  /// \brief setState
+  /// \param i Index of the environment
+  /// \param state The new state of environment i
+  ///
+  /// Same range checks as HaxBall::setState(), resets the goal indicators and counters of environment i.
+  ///
+  void setState(int i, const Eigen::Ref<const Eigen::VectorXd>& state);
+
+  ///
+  /// \brief setStates
+  /// \param states The new states of all environments, one column per environment
+  ///
+  /// \overload
+  ///
+  void setStates(const Eigen::Ref<const Eigen::MatrixXd>& states);
+
+  ///
+  /// \brief step Executes the actions in all environments
+  /// \param actions One action per column, the matrix must have the size getActionDimension() x size()
+  ///
+  /// Each environment performs exactly the same sub steps as HaxBall::step().
+  ///
+  void step(const Eigen::Ref<const Eigen::MatrixXd>& actions);
+
+  ///
+  /// \brief reset Resets all environments to random states
+  ///
+  /// Uses the same distributions as HaxBall::reset().
+  ///
+  void reset();
+
+  ///
+  /// \brief reset Resets a single environment to a random state
+  /// \param i Index of the environment
+  ///
+  /// \overload
+  ///
+  void reset(int i);
+
+  ///
+  /// \brief seed Restarts the random numbers of all environments, environment i uses stream i
+  /// \param seed The seed of the random numbers
+  ///
+  /// The states are not changed, call reset() afterwards for reproducible start states.
+  ///
+  void seed(std::uint64_t seed);
+
+  ///
+  /// \brief ballWasInLeftGoal
+  /// \return per environment, whether the ball was in the left goal at the end of the last step
+  ///
+  const Eigen::Array<bool, Eigen::Dynamic, 1>& ballWasInLeftGoal() const;
+
+  ///
+  /// \brief ballWasInRightGoal
+  /// \return per environment, whether the ball was in the right goal at the end of the last step
+  ///
+  const Eigen::Array<bool, Eigen::Dynamic, 1>& ballWasInRightGoal() const;
+
+  ///
+  /// \brief getAgentGoals
+  /// \return per environment, the number of goals of the agent since the last reset
+  ///
+  const Eigen::ArrayXi& getAgentGoals() const;
+
+  ///
+  /// \brief getOpponentGoals
+  /// \return per environment, the number of goals of the opponent since the last reset
+  ///
+  const Eigen::ArrayXi& getOpponentGoals() const;
+
+  /// The same state dimension as HaxBall::getStateDimension()
+  int getStateDimension() const { return HaxBallField::STATE_DIMENSION; }
+
+  /// The same action dimension as HaxBall::getActionDimension()
+  int getActionDimension() const { return HaxBallField::ACTION_DIMENSION; }
+
+  /// Number of environments processed together in step(), small enough to keep a block in the L1 cache
+  static const int BLOCK_SIZE = 256;
+
+private:
+
+  ///
+  /// \brief stepBlock Executes all sub steps for a contiguous range of environments
+  /// \param begin The first environment of the block
+  /// \param n The number of environments in the block
+  /// \param actions The actions of all environments
+  ///
+  /// The block is loaded once and all sub steps run on the copies in the L1 cache.
+  /// Each sub step is one loop over the environments of the block without branches, which the compiler vectorises.
+  /// The opponent is a template parameter to keep its branch out of that loop.
+  ///
+  template <bool HasOpponent>
+  void stepBlock(int begin, int n, const Eigen::Ref<const Eigen::MatrixXd>& actions);
+
+private:
+
+  // One random stream per environment, the start states do not depend on the order of resetting
+  std::vector<Philox4x32> m_random_engines;
+
+  // Physical constants, copied from HaxBallField
+  double m_left, m_right, m_top, m_bottom;
+  double m_goal_left_x0, m_goal_left_x1, m_goal_left_y0, m_goal_left_y1;
+  double m_goal_right_x0, m_goal_right_x1, m_goal_right_y0, m_goal_right_y1;
+  double m_goal_right_center_x, m_goal_right_center_y;
+  double m_radius_player, m_radius_ball, m_distance_goalkeeper;
+  double m_sub_dt, m_max_speed_player, m_max_speed_ball, m_friction, m_shoot_dist;
+
+  // How many sub steps HaxBall::step() executes
+  int m_sub_steps;
+
+  const bool m_has_opponent;
+
+  // Number of environments
+  const int m_size;
+
+  // Structure of arrays: size() x 6, column j is state component j of all environments
+  Eigen::Array<double, Eigen::Dynamic, 6> m_state;
+
+  // The opponent positions, size() x 2, only stored for rendering and debugging
+  Eigen::Array<double, Eigen::Dynamic, 2> m_position_opponent;
+
+  // Indicators and counters, one entry per environment
+  Eigen::Array<bool, Eigen::Dynamic, 1> m_wasInLeftGoal, m_wasInRightGoal;
+  Eigen::ArrayXi m_num_agent_goals, m_num_opponent_goals;
+};
+
+#endif // _HAXBALLBATCH_H_
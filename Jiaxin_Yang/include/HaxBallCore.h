@@ -0,0 +1,442 @@
+#ifndef _HAXBALLCORE_H_
+#define _HAXBALLCORE_H_
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "Eigen/Dense"
+
+#include "HaxBallField.h"
+#include "Philox.h"
+
+///
+/// \brief The BasicHaxBallCore class contains the simulation of HaxBall without any Qt dependency
+///
+/// This is the actual game: state, differential equations, collisions, goals and resetting.
+/// It is a plain value type: all members have a fixed size, there is no heap allocation, no QObject and no random device.
+/// Creating, copying and resetting an instance is cheap, so create as many as you like inside your training threads.
+///
+/// The class HaxBall wraps an instance of this core for the GUI and signal slot mechanism.
+/// Headless training code should use the core directly.
+///
+/// The coordinate system is the same as in HaxBall (Qt's convention, y points downwards).
+///
+/// The simulation is a template on the floating point type of state, constants and physics.
+/// Use HaxBallCore (double) for training and evaluation and HaxBallCoreF (float) where half the memory
+/// and twice the SIMD width matter more than the last digits, e.g. bulk data generation or screening CEM particles.
+/// Both run the same number of sub steps, the trajectories only drift apart by rounding
+/// (see EvaluationCenter::precisionReport() for the divergence on long rollouts).
+/// Only these two types are instantiated, in HaxBallCore.cpp.
+///
+template <typename Scalar>
+class BasicHaxBallCore
+{
+  static_assert(std::is_floating_point<Scalar>::value, "BasicHaxBallCore needs a floating point type");
+
+public:
+
+  /// The state vector: player position, ball position, ball velocity
+  typedef Eigen::Matrix<Scalar, HaxBallField::STATE_DIMENSION, 1> State;
+
+  /// Vectors of states and actions in the precision of the simulation
+  typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> Vector;
+
+  /// Positions and velocities in the plane
+  typedef Eigen::Matrix<Scalar, 2, 1> Vector2;
+
+  /// The rectangles of field and goals
+  typedef BasicHaxBallRect<Scalar> Rect;
+
+  ///
+  /// \brief The StepInfo struct receives everything a training loop needs after a step
+  ///
+  /// Filled by step(action, info) in one pass: the successor state for the reward and the next action,
+  /// the goal events of the step and whether the step ended an episode. Reuse one instance for all steps.
+  ///
+  struct StepInfo
+  {
+    /// The state after the step
+    State state_prime;
+
+    /// Goals scored by the agent and by the opponent during this step (all sub steps)
+    int agent_goals, opponent_goals;
+
+    /// The same as ballWasInLeftGoal() and ballWasInRightGoal() after the step
+    bool ball_was_in_left_goal, ball_was_in_right_goal;
+
+    /// True, if a goal was scored during the step, the ball has been put back to the center
+    bool terminal;
+  };
+
+  ///
+  /// \brief The Snapshot struct holds everything that changes during a simulation
+  ///
+  /// State vector, opponent position, goal indicators, goal counters and the position in the random stream.
+  /// It is a fixed size value without pointers: copying it is a plain copy of a few bytes, no allocation involved.
+  /// Planners can take a snapshot once and branch from it as often as they like.
+  ///
+  /// The configuration (opponent on or off, step mode) is not part of the snapshot,
+  /// restore a snapshot only into an environment with the same opponent setting.
+  ///
+  struct Snapshot
+  {
+    State state;
+    Vector2 position_opponent;
+    Philox4x32 random_engine;
+    int num_agent_goals, num_opponent_goals;
+    bool was_in_left_goal, was_in_right_goal;
+  };
+
+  ///
+  /// \brief The StepMode enum selects how step() integrates the time step
+  ///
+  /// FixedSubSteps is the original scheme: always the same number of sub steps with penetration correcting collisions.
+  ///
+  /// EventDriven computes analytically for how many sub steps nothing can happen (no contact between player, ball and
+  /// opponent, no wall, no goal, no shot) and jumps over them in closed form, ball friction included as friction^k.
+  /// Only the sub steps with a possible event are executed one by one like in the fixed scheme.
+  /// Since the closed form is the exact solution of the sub step recursion, both modes agree up to rounding.
+  ///
+  enum class StepMode { FixedSubSteps, EventDriven };
+
+  /// Upper limit for the number of sub steps per step, the closed form tables have this size
+  static const int MAX_SUB_STEPS = 16;
+
+  // The constants of the game, taken from HaxBallField and rounded once to the scalar type
+  static constexpr Rect SIZE = HaxBallField::SIZE.cast<Scalar>();
+  static constexpr Rect GOAL_LEFT = HaxBallField::GOAL_LEFT.cast<Scalar>();
+  static constexpr Rect GOAL_RIGHT = HaxBallField::GOAL_RIGHT.cast<Scalar>();
+  static constexpr Scalar RADIUS_PLAYER = Scalar(HaxBallField::RADIUS_PLAYER);
+  static constexpr Scalar RADIUS_BALL = Scalar(HaxBallField::RADIUS_BALL);
+  static constexpr Scalar DISTANCE_GOALKEEPER = Scalar(HaxBallField::DISTANCE_GOALKEEPER);
+  static constexpr Scalar DT = Scalar(HaxBallField::DT);
+  static constexpr Scalar SUB_DT = Scalar(HaxBallField::SUB_DT);
+  static constexpr Scalar MAX_SPEED_PLAYER = Scalar(HaxBallField::MAX_SPEED_PLAYER);
+  static constexpr Scalar MAX_SPEED_BALL = Scalar(HaxBallField::MAX_SPEED_BALL);
+  static constexpr Scalar FRICTION = Scalar(HaxBallField::FRICTION);
+  static constexpr Scalar SHOOT_DIST = Scalar(HaxBallField::SHOOT_DIST);
+
+  /// Number of sub steps per step
+  static constexpr int SUB_STEPS = HaxBallField::subSteps();
+
+  static_assert(SUB_STEPS <= MAX_SUB_STEPS, "BasicHaxBallCore: too many sub steps for the closed form tables");
+
+  ///
+  /// \brief BasicHaxBallCore Creates a new environment
+  /// \param has_opponent Enables or disables the opponent
+  /// \param seed The seed of the random numbers for resetting, taken from the clock if not specified
+  /// \param stream The random stream of this environment, e.g. the index of a trajectory or of a thread
+  ///
+  /// Contains only the initialization of all values and creates the starting state by resetting the environment.
+  /// Environments with the same seed and stream produce the same start states, on any thread.
+  ///
+  explicit BasicHaxBallCore(bool has_opponent = true, std::uint64_t seed = Philox4x32::clockSeed(), std::uint64_t stream = 0);
+
+  /// \return the elapsing time between two steps
+  Scalar getTimeDelta() const { return DT; }
+
+  /// \return the elapsing time between two sub steps
+  Scalar getSubTimeDelta() const { return SUB_DT; }
+
+  /// \return the maximum speed of the ball (per axis)
+  Scalar getMaxSpeedBall() const { return MAX_SPEED_BALL; }
+
+  /// \return the maximum speed of the player (per axis)
+  Scalar getMaxSpeedPlayer() const { return MAX_SPEED_PLAYER; }
+
+  /// \return the fraction of the ball velocity which survives one sub step
+  Scalar getFriction() const { return FRICTION; }
+
+  /// \return the size of the playing ground
+  const Rect& getSize() const { return SIZE; }
+
+  /// \return the rectangle corresponding to the left (player) goal
+  const Rect& getGoalLeft() const { return GOAL_LEFT; }
+
+  /// \return the rectangle corresponding to the right (opponent) goal
+  const Rect& getGoalRight() const { return GOAL_RIGHT; }
+
+  /// \return the distance between the goalkeeper and its goal center
+  Scalar getOpponentDistance() const { return DISTANCE_GOALKEEPER; }
+
+  /// \return the distance between the player and the ball in which shooting is possible
+  Scalar getShootingDistance() const { return SHOOT_DIST; }
+
+  /// \return the radius of the ball (not the diameter)
+  Scalar getRadiusBall() const { return RADIUS_BALL; }
+
+  /// \return the radius of the player (not the diameter)
+  Scalar getRadiusPlayer() const { return RADIUS_PLAYER; }
+
+  /// \return the position of the opponent
+  const Vector2& getOpponentPos() const { return m_position_opponent; }
+
+  /// \return true, if the ball hit the left goal area during the execution of a step. Otherwise false.
+  bool ballWasInLeftGoal() const { return m_wasInLeftGoal; }
+
+  /// \return true, if the ball hit the right goal area during the execution of a step. Otherwise false.
+  bool ballWasInRightGoal() const { return m_wasInRightGoal; }
+
+  /// \return true, if an opponent is present
+  bool hasOpponent() const { return m_has_opponent; }
+
+  /// \return The number of agent goals since last reset
+  int getAgentGoals() const { return m_num_agent_goals; }
+
+  /// \return The number of opponent goals since last reset
+  int getOpponentGoals() const { return m_num_opponent_goals; }
+
+  /// \return the (hardcoded) number of state dimensions of the control problem
+  int getStateDimension() const { return HaxBallField::STATE_DIMENSION; }
+
+  /// \return the (hardcoded) number of action dimensions of the control problem
+  int getActionDimension() const { return HaxBallField::ACTION_DIMENSION; }
+
+  ///
+  /// \brief getState
+  /// \return a constant reference to the internal state, no copy involved
+  ///
+  const State& getState() const { return m_state; }
+
+  ///
+  /// \brief getState
+  /// \param state An eigen reference to a column vector with getStateDimension() rows, it receives a copy of the state
+  ///
+  /// \overload
+  ///
+  void getState(Eigen::Ref<Vector> state) const { state = m_state; }
+
+  ///
+  /// \brief setState
+  /// \param state A constant eigen reference to a column vector describing the new environment state
+  ///
+  /// Some checks are applied, throws std::out_of_range for states outside of the field or speed limits.
+  ///
+  void setState(const Eigen::Ref<const Vector>& state);
+
+  ///
+  /// \brief setState
+  /// \param player_x Player position on x-axis
+  /// \param player_y Player position on y-axis
+  /// \param ball_x Ball position on x-axis
+  /// \param ball_y Ball position on y-axis
+  /// \param ball_vx Ball velocity on x-axis
+  /// \param ball_vy Ball velocity on y-axis
+  ///
+  /// @overload
+  ///
+  void setState(Scalar player_x, Scalar player_y, Scalar ball_x, Scalar ball_y, Scalar ball_vx, Scalar ball_vy);
+
+  ///
+  /// \brief step Executes the action in the world
+  /// \param action the action to execute
+  ///
+  /// This function should be fail safe, once it returns the internal state is updated.
+  /// The step is not thread safe!
+  ///
+  void step(const Eigen::Ref<const Vector>& action);
+
+  ///
+  /// \brief step Executes the action in the world and reports the outcome
+  /// \param action the action to execute
+  /// \param info receives successor state, goal events and the terminal flag
+  ///
+  /// Replaces the calls to step(), getState(), ballWasInLeftGoal() and ballWasInRightGoal() in rollouts.
+  ///
+  /// \overload
+  ///
+  void step(const Eigen::Ref<const Vector>& action, StepInfo& info);
+
+  ///
+  /// \brief setStepMode
+  /// \param mode Switches between the fixed sub steps (default) and the event driven integration
+  ///
+  void setStepMode(StepMode mode) { m_step_mode = mode; }
+
+  /// \return the current integration scheme of step()
+  StepMode getStepMode() const { return m_step_mode; }
+
+  ///
+  /// \brief reset Resets the state to some random value in the state space
+  ///
+  /// All distributions are uniform, see HaxBall::reset().
+  ///
+  void reset();
+
+  ///
+  /// \brief seed Restarts the random numbers used by reset()
+  /// \param seed The seed of the random numbers
+  /// \param stream The random stream of this environment
+  ///
+  /// The state is not changed, call reset() afterwards to get the first start state of the stream.
+  ///
+  void seed(std::uint64_t seed, std::uint64_t stream = 0) { m_random_engine.seed(seed, stream); }
+
+  ///
+  /// \brief snapshot Copies the complete dynamic state of the environment
+  /// \param snapshot Receives the copy, e.g. a preallocated node of a search tree
+  ///
+  void snapshot(Snapshot& snapshot) const
+  {
+    snapshot.state = m_state;
+    snapshot.position_opponent = m_position_opponent;
+    snapshot.random_engine = m_random_engine;
+    snapshot.num_agent_goals = m_num_agent_goals;
+    snapshot.num_opponent_goals = m_num_opponent_goals;
+    snapshot.was_in_left_goal = m_wasInLeftGoal;
+    snapshot.was_in_right_goal = m_wasInRightGoal;
+  }
+
+  ///
+  /// \brief snapshot
+  /// \return a copy of the complete dynamic state of the environment
+  ///
+  /// \overload
+  ///
+  Snapshot snapshot() const { Snapshot s; snapshot(s); return s; }
+
+  ///
+  /// \brief restore Continues exactly where a snapshot was taken
+  /// \param snapshot A snapshot of an environment with the same opponent setting
+  ///
+  /// Unlike setState() there is no range check and nothing gets reset: goal indicators, goal counters,
+  /// opponent position and the random numbers of future resets are the ones of the snapshot.
+  /// Stepping after a restore gives bit for bit the same results as stepping the original environment.
+  ///
+  void restore(const Snapshot& snapshot)
+  {
+    m_state = snapshot.state;
+    m_position_opponent = snapshot.position_opponent;
+    m_random_engine = snapshot.random_engine;
+    m_num_agent_goals = snapshot.num_agent_goals;
+    m_num_opponent_goals = snapshot.num_opponent_goals;
+    m_wasInLeftGoal = snapshot.was_in_left_goal;
+    m_wasInRightGoal = snapshot.was_in_right_goal;
+  }
+
+private:
+
+  ///
+  /// \brief integrate Executes all sub steps of one step in the current step mode
+  /// \param player_vel the (clipped and scaled) velocity of the player
+  /// \param shoot whether the player tries to shoot
+  ///
+  /// The opponent is a template parameter, step() decides once per step and
+  /// all sub steps run without checking m_has_opponent again.
+  ///
+  template <bool HasOpponent>
+  void integrate(const Vector2& player_vel, bool shoot);
+
+  ///
+  /// \brief subStep Executes a fraction of the intended time to elapse
+  /// \param player_vel the (clipped and scaled) velocity of the player
+  /// \param shoot whether the player tries to shoot
+  ///
+  template <bool HasOpponent>
+  void subStep(const Vector2& player_vel, bool shoot);
+
+  ///
+  /// \brief freeSubSteps Computes how many of the next sub steps are free of any event
+  /// \param player_vel the velocity of the player
+  /// \param shoot whether the player tries to shoot
+  /// \param remaining the number of sub steps left in this step
+  /// \return a number k in [0, remaining], the next k sub steps are guaranteed to change nothing but the positions
+  ///
+  /// Conservative time of impact for player-ball, opponent-ball and player-opponent contact, the walls, the goals,
+  /// the shooting range and the stuck ball reset, based on bounds of the distance travelled.
+  ///
+  template <bool HasOpponent>
+  int freeSubSteps(const Vector2& player_vel, bool shoot, int remaining) const;
+
+  ///
+  /// \brief advanceFree Jumps over k sub steps without events in closed form
+  ///
+  template <bool HasOpponent>
+  void advanceFree(const Vector2& player_vel, int k);
+
+  ///
+  /// \brief ballFreeSubSteps Number of sub steps in which the decaying ball motion stays below a distance
+  /// \param gap the distance to the next event
+  /// \param speed the initial speed of the ball
+  /// \param remaining the maximum number of sub steps
+  ///
+  /// Solves speed * sub_dt * (f + f^2 + ... + f^j) < gap for the largest j, f being the friction.
+  ///
+  int ballFreeSubSteps(Scalar gap, Scalar speed, int remaining) const;
+
+  ///
+  /// \brief linearFreeSubSteps Number of sub steps in which a linear motion stays below a distance
+  /// \param gap the distance to the next event
+  /// \param travel the (maximal) distance travelled per sub step
+  /// \param remaining the maximum number of sub steps
+  ///
+  int linearFreeSubSteps(Scalar gap, Scalar travel, int remaining) const;
+
+  ///
+  /// \brief resets other variables outside of the state vector
+  ///
+  void resetOthers();
+
+  ///
+  /// \brief collision Handles the collision between two particles
+  ///
+  /// Particle 1 is infinte heavy.
+  /// Particle 2 has no mass, in bounces perfectly at the surface of particle 1.
+  /// See HaxBall for details.
+  ///
+  void collision(const Vector2& p1, const Vector2& v1, Scalar r1,
+                 Vector2& p2, Vector2& v2, Scalar r2, const float elasticity) const;
+
+  ///
+  /// \brief random_number Produces a random number in given interval
+  ///
+  Scalar random_number(Scalar low, Scalar high);
+
+private:
+
+  // A small counter based generator (instead of the 5 KB of a std::mt19937), one stream per environment
+  // Not thread safe -> do not use one environment in multiple threads
+  Philox4x32 m_random_engine;
+
+  // Integration scheme of step()
+  StepMode m_step_mode;
+
+  // Closed form tables for the friction: f^k and f + f^2 + ... + f^k
+  std::array<Scalar, MAX_SUB_STEPS + 1> m_friction_pow, m_friction_sum;
+  Scalar m_log_friction;
+
+  // Variables to make the work with an agent easier
+  bool m_wasInLeftGoal, m_wasInRightGoal;
+
+  // Change its value in the constructor to switch between easy mode or with oppnent
+  bool m_has_opponent;
+
+  // The state with fixed size, it lives inside the instance
+  State m_state;
+
+  // The position of the opponent, it is defined directly from the state vector and can stay outside of m_state
+  Vector2 m_position_opponent;
+
+  // The velocity of the opponent, currently it is always zero and just required to call the collision function
+  Vector2 m_velocity_opponent;
+
+  // The right goal center as Eigen::Vector for easy computations
+  Vector2 m_goal_right_center;
+
+  // Number of goals
+  int m_num_agent_goals, m_num_opponent_goals;
+};
+
+// Both precisions are compiled once in HaxBallCore.cpp
+extern template class BasicHaxBallCore<float>;
+extern template class BasicHaxBallCore<double>;
+
+/// The double precision simulation, the reference used by HaxBall, the agents and the evaluation
+typedef BasicHaxBallCore<double> HaxBallCore;
+
+/// The single precision simulation, the fast path for bulk data generation
+typedef BasicHaxBallCore<float> HaxBallCoreF;
+
+#endif // _HAXBALLCORE_H_
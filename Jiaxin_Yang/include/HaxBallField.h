@@ -0,0 +1,127 @@
+#ifndef _HAXBALLFIELD_H_
+#define _HAXBALLFIELD_H_
+
+#include <type_traits>
+
+///
+/// \brief The BasicHaxBallRect struct is a plain axis aligned rectangle
+///
+/// It stores the same four numbers as QRectF (top left corner and extent) and follows its conventions,
+/// e.g. right() is x + w and contains() includes the border. Hence a QRectF built from it is identical
+/// to the rectangles the Qt version of the environment used to create.
+///
+/// Everything is constexpr, the rectangles of the field are compile time constants.
+///
+template <typename Scalar>
+struct BasicHaxBallRect
+{
+  Scalar x, y, w, h;
+
+  ///
+  /// \brief fromCorners Creates a rectangle from two corners, like QRectF(QPointF, QPointF)
+  ///
+  static constexpr BasicHaxBallRect fromCorners(Scalar x0, Scalar y0, Scalar x1, Scalar y1) { return BasicHaxBallRect{x0, y0, x1 - x0, y1 - y0}; }
+
+  ///
+  /// \brief cast
+  /// \return the same rectangle in another floating point type, each of the four numbers is rounded once
+  ///
+  template <typename Other>
+  constexpr BasicHaxBallRect<Other> cast() const { return BasicHaxBallRect<Other>{Other(x), Other(y), Other(w), Other(h)}; }
+
+  constexpr Scalar left() const { return x; }
+  constexpr Scalar right() const { return x + w; }
+  constexpr Scalar top() const { return y; }
+  constexpr Scalar bottom() const { return y + h; }
+
+  constexpr Scalar centerX() const { return x + w / Scalar(2); }
+  constexpr Scalar centerY() const { return y + h / Scalar(2); }
+
+  ///
+  /// \brief contains
+  /// \return true, if the point is inside the rectangle or on its border (the same result as QRectF::contains())
+  ///
+  constexpr bool contains(Scalar px, Scalar py) const { return px >= x and px <= x + w and py >= y and py <= y + h; }
+};
+
+/// The rectangle of the double precision simulation, the one used by HaxBall and the agents
+typedef BasicHaxBallRect<double> HaxBallRect;
+
+static_assert(std::is_trivial<HaxBallRect>::value and std::is_standard_layout<HaxBallRect>::value, "HaxBallRect must stay POD");
+
+///
+/// \brief The HaxBallField struct describes the geometry and the physics of the game at compile time
+///
+/// This is the single source of truth for all constants of HaxBall: the field, the goals, the radii,
+/// the time steps, the speed limits and the friction. The simulations (HaxBallCore, HaxBallBatch) are built from it.
+///
+/// Reward functions and agents can read the geometry as constants without creating an environment, e.g.
+/// HaxBallField::GOAL_RIGHT.contains(x, y) or HaxBallField::RADIUS_BALL.
+///
+/// The coordinate system is the same as in HaxBall (Qt's convention, y points downwards).
+///
+struct HaxBallField
+{
+  /// The playing ground, top left corner and extent
+  static constexpr HaxBallRect SIZE{-4.0, -2.0, 8.0, 4.0};
+
+  /// The left (player) goal
+  static constexpr HaxBallRect GOAL_LEFT = HaxBallRect::fromCorners(0.9 * SIZE.left() - 0.15, 0.25 * SIZE.top() - 0.0,
+                                                                    0.9 * SIZE.left() + 0.15, 0.25 * SIZE.bottom() + 0.0);
+
+  /// The right (opponent) goal
+  static constexpr HaxBallRect GOAL_RIGHT = HaxBallRect::fromCorners(0.9 * SIZE.right() - 0.15, 0.25 * SIZE.top() - 0.0,
+                                                                     0.9 * SIZE.right() + 0.15, 0.25 * SIZE.bottom() + 0.0);
+
+  /// The radius of the player and of the opponent (not the diameter)
+  static constexpr double RADIUS_PLAYER = 0.25;
+
+  /// The radius of the ball (not the diameter)
+  static constexpr double RADIUS_BALL = 0.15;
+
+  /// The distance between the goalkeeper and its goal center
+  static constexpr double DISTANCE_GOALKEEPER = 1.0;
+
+  /// The elapsing time between two steps
+  static constexpr double DT = 0.05;
+
+  /// The elapsing time between two sub steps
+  static constexpr double SUB_DT = 0.1 * DT;
+
+  /// The maximum speed of the player (per axis)
+  static constexpr double MAX_SPEED_PLAYER = 2.0;
+
+  /// The maximum speed of the ball (per axis)
+  static constexpr double MAX_SPEED_BALL = 3.0 * MAX_SPEED_PLAYER;
+
+  /// The fraction of the ball velocity which survives one sub step
+  static constexpr double FRICTION = 0.996;
+
+  /// The distance between the player and the ball in which shooting is possible
+  static constexpr double SHOOT_DIST = 2.0 * RADIUS_BALL;
+
+  /// The number of state dimensions of the control problem: player position, ball position, ball velocity
+  static constexpr int STATE_DIMENSION = 6;
+
+  /// The number of action dimensions of the control problem: player velocity and shooting
+  static constexpr int ACTION_DIMENSION = 3;
+
+  ///
+  /// \brief subSteps
+  /// \return the number of sub steps per step
+  ///
+  /// The step loop used to accumulate the sub time delta, this keeps exactly the same number of sub steps.
+  /// Always counted in double, in float the accumulated rounding would add an extra sub step.
+  ///
+  static constexpr int subSteps()
+  {
+    int n = 0;
+
+    for (double t = 0.0; t < DT; t += SUB_DT)
+      n++;
+
+    return n;
+  }
+};
+
+#endif // _HAXBALLFIELD_H_
@@ -0,0 +1,338 @@
+#ifndef _LINEARQ_H_
+#define _LINEARQ_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "ActionSpace.h"
+#include "BaseAgent.h"
+#include "Checkpoint.h"
+#include "HaxBallCore.h"
+#include "Philox.h"
+#include "RewardFunctions.h"
+
+#include "Eigen/Dense"
+
+///
+/// \brief The LinearQ class is a Q-learning agent with a Q-function linear in features of the state
+///
+/// Q(s, a) is the sum of the weights of the active features of s, each times its value, with one weight per feature
+/// and discrete action of Action::action_map(). TileCoding, MultilinearQ and RadialBasisQ differ only in the
+/// features, LinearQ holds the weights and implements everything else once: the greedy policy, the Q-factors, the
+/// training and the checkpoints. The derived class is the template argument (no virtual calls in the inner loops)
+/// and provides
+///
+///  - `void activate(state, Features&) const` and `void activateBatch(states, Features&) const`, the features of one
+///    state or of one state per column, state k of the features is number k below
+///  - `ActionValues actionValues(const Features&, int k) const` and `actionValuesAtomic(...)`, the Q-values of
+///    all actions, the latter with atomic reads of the weights
+///  - `void update(const Features&, int k, int action, double target)`, the step of Q(s, a) towards a target with
+///    atomic updates of the weights
+///  - `Eigen::MatrixXd layout() const`, the ranges and widths the features are computed with
+///  - the constants GAMMA, EPSILON, TRAJECTORIES, STEPS and CHECKPOINT_KIND
+///
+/// The weights of a feature are contiguous and padded to a multiple of eight doubles: the Q-values of all actions
+/// are a weighted sum of fixed size columns, a few SIMD instructions per active feature.
+///
+/// The training threads share the weights (Hogwild) with atomic reads and updates, like QLearning. A copy of the
+/// agent reads the weights atomically too, it can be taken while other threads train.
+///
+template <typename Derived, typename FeatureSet>
+class LinearQ : public BaseAgent
+{
+public:
+
+  /// The number of discrete actions, see Action::action_map()
+  static const int ACTIONS = 18;
+
+  /// The actions padded to a multiple of eight (three cache lines), the rows of the weight matrix
+  static const int PADDED_ACTIONS = 24;
+
+  /// The weights, one column per feature, one row per (padded) action
+  typedef Eigen::Matrix<double, PADDED_ACTIONS, Eigen::Dynamic> WeightMatrix;
+
+  /// The Q-values of all (padded) actions of one state
+  typedef Eigen::Matrix<double, PADDED_ACTIONS, 1> ActionValues;
+
+  /// The active features of one or more states
+  typedef FeatureSet Features;
+
+  /// The greedy action of the Q-function
+  void policy(const Eigen::Ref<const Eigen::VectorXd>& state,
+              Eigen::Ref<Eigen::VectorXd> action) const override
+  {
+    Features features;
+
+    derived().activate(state, features);
+    Action::action_map(argmax(derived().actionValues(features, 0)), action);
+  }
+
+  /// The greedy actions of many states, with the batched activation
+  void policyBatch(const Eigen::Ref<const Eigen::MatrixXd>& states,
+                   Eigen::Ref<Eigen::MatrixXd> actions) const override
+  {
+    checkColumns("actions", actions.cols(), states.cols());
+
+    Features features;
+    derived().activateBatch(states, features);
+
+    for (Eigen::Index i = 0; i < states.cols(); ++i)
+      Action::action_map(argmax(derived().actionValues(features, static_cast<int>(i))), actions.col(i));
+  }
+
+  /// Player ball distance and the goals
+  double reward(const Eigen::Ref<const Eigen::VectorXd>& s,
+                const Eigen::Ref<const Eigen::VectorXd>& action,
+                const Eigen::Ref<const Eigen::VectorXd>& s_prime) const override
+  {
+    return Reward::distance_player_ball_dense(s, action, s_prime) + Reward::ball_in_goal(s, action, s_prime);
+  }
+
+  /// The Q-value of the nearest discrete action
+  double getQfactor(const Eigen::Ref<const Eigen::VectorXd>& state,
+                    const Eigen::Ref<const Eigen::VectorXd>& action) const override
+  {
+    Features features;
+    derived().activate(state, features);
+
+    return derived().actionValues(features, 0)(Action::action_map(action));
+  }
+
+  /// The Q-values of the ACTIONS discrete actions
+  Eigen::VectorXd getQfactor(const Eigen::Ref<const Eigen::VectorXd>& state) const override
+  {
+    Features features;
+    derived().activate(state, features);
+
+    return derived().actionValues(features, 0).template head<ACTIONS>();
+  }
+
+  using BaseAgent::qValuesBatch;
+
+  /// The Q-values of the ACTIONS discrete actions for many states, with the batched activation
+  void qValuesBatch(const Eigen::Ref<const Eigen::MatrixXd>& states,
+                    Eigen::MatrixXd& Q) const override
+  {
+    if (Q.rows() != ACTIONS or Q.cols() != states.cols())
+      Q.resize(ACTIONS, states.cols());
+
+    Features features;
+    derived().activateBatch(states, features);
+
+    for (Eigen::Index i = 0; i < states.cols(); ++i)
+      Q.col(i) = derived().actionValues(features, static_cast<int>(i)).template head<ACTIONS>();
+  }
+
+  ///
+  /// \brief snapshot Copies the agent, safe while other threads update
+  /// \return an agent with the same features, weights and state of the training
+  ///
+  /// The weights are copied with atomic reads, the copy is no consistent cut through concurrent updates, but every
+  /// weight is a value some update wrote.
+  ///
+  Derived snapshot() const { return Derived(derived()); }
+
+  ///
+  /// \brief training
+  ///
+  /// One call runs TRAJECTORIES epsilon greedy trajectories of STEPS steps in parallel, Q-learning updates after each step.
+  ///
+  void training();
+
+  ///
+  /// \brief seed Restarts the random numbers of the training
+  ///
+  void seed(std::uint64_t seed)
+  {
+    m_seed = seed;
+    m_iteration = 0;
+  }
+
+  ///
+  /// \brief save Writes the layout of the features, the weights and the state of the training as checkpoint, atomically
+  ///
+  void save(const std::string& path) const;
+
+  ///
+  /// \brief load Replaces the weights and the state of the training with a checkpoint written by save()
+  ///
+  /// Throws std::runtime_error if the file belongs to another kind of agent, its features were computed with other
+  /// ranges or widths or the number of features differs. The agent is unchanged then.
+  ///
+  void load(const std::string& path);
+
+  /// \return the number of bytes of the weights
+  std::size_t memoryUsage() const { return sizeof(double) * m_weights.size(); }
+
+  /// \return the index of the largest of the first ACTIONS values, the first one if several are equal
+  static int argmax(const ActionValues& q)
+  {
+    int best;
+    q.template head<ACTIONS>().maxCoeff(&best);
+    return best;
+  }
+
+protected:
+
+  explicit LinearQ(std::uint64_t seed) :
+    m_seed(seed), m_iteration(0)
+  {
+
+  }
+
+  /// Copies the weights with atomic reads, see snapshot()
+  LinearQ(const LinearQ& other) :
+    BaseAgent(other), m_weights(other.m_weights.rows(), other.m_weights.cols()),
+    m_seed(other.m_seed), m_iteration(other.m_iteration)
+  {
+    const double* weights = other.m_weights.data();
+    double* copied = m_weights.data();
+
+    for (Eigen::Index i = 0; i < m_weights.size(); ++i)
+    {
+#pragma omp atomic read
+      copied[i] = weights[i];
+    }
+  }
+
+  LinearQ& operator=(const LinearQ&) = default;
+
+  ///
+  /// \brief saveSections Adds the sections of a derived class to a checkpoint, none by default
+  ///
+  /// The data of the sections has to stay valid until the writer is done, see CheckpointWriter.
+  ///
+  void saveSections(CheckpointWriter& writer) const
+  {
+
+  }
+
+  ///
+  /// \brief loadSections Restores the sections of saveSections(), before the weights are replaced
+  /// \param features The number of features of the weights in the checkpoint
+  ///
+  /// Throws std::runtime_error if the checkpoint does not fit and leaves the agent unchanged then. By default the
+  /// number of features has to be the current one.
+  ///
+  void loadSections(const CheckpointReader& reader, const std::string& path, Eigen::Index features)
+  {
+    if (features != m_weights.cols())
+      throw std::runtime_error("The checkpoint '" + path + "' has a different number of features");
+  }
+
+  const Derived& derived() const { return static_cast<const Derived&>(*this); }
+  Derived& derived() { return static_cast<Derived&>(*this); }
+
+protected:
+
+  /// The weights of the features
+  WeightMatrix m_weights;
+
+  /// The seed of the training and the number of calls to training()
+  std::uint64_t m_seed, m_iteration;
+};
+
+template <typename Derived, typename FeatureSet>
+void LinearQ<Derived, FeatureSet>::training()
+{
+  // Stream i of the first seed starts trajectory i, stream i of the second one explores in it
+  const std::uint64_t iteration_seed = Philox4x32::deriveSeed(m_seed, m_iteration++);
+  const std::uint64_t exploration_seed = Philox4x32::deriveSeed(iteration_seed, 1);
+
+  // All threads update the shared weights with atomic operations, no locks (Hogwild)
+#pragma omp parallel for
+  for (int i = 0; i < Derived::TRAJECTORIES; ++i)
+  {
+    HaxBallCore env(true, iteration_seed, i);
+    Philox4x32 random_engine(exploration_seed, i);
+    HaxBallCore::StepInfo info;
+
+    Eigen::VectorXd
+        state(env.getStateDimension()),
+        action(env.getActionDimension());
+    Features features, features_prime;
+
+    env.getState(state);
+    derived().activate(state, features);
+
+    // The Q-values of the successor are those of the next state, one activation per step
+    ActionValues q = derived().actionValuesAtomic(features, 0);
+
+    for (int j = 0; j < Derived::STEPS; ++j)
+    {
+      // Epsilon greedy on atomic reads of the weights, from before the last update
+      int a;
+
+      if (random_engine.uniform<double>() < Derived::EPSILON)
+        a = static_cast<int>(random_engine() % ACTIONS);
+      else
+        a = argmax(q);
+
+      Action::action_map(a, action);
+      env.step(action, info);
+      derived().activate(info.state_prime, features_prime);
+      q = derived().actionValuesAtomic(features_prime, 0);
+
+      // A goal ends the episode, the ball is back in the center and nothing is bootstrapped
+      double target = LinearQ::reward(state, action, info.state_prime);
+
+      if (not info.terminal)
+        target += Derived::GAMMA * q.template head<ACTIONS>().maxCoeff();
+
+      derived().update(features, 0, a, target);
+
+      state = info.state_prime;
+      std::swap(features, features_prime);
+    }
+  }
+}
+
+template <typename Derived, typename FeatureSet>
+void LinearQ<Derived, FeatureSet>::save(const std::string& path) const
+{
+  CheckpointWriter writer(Derived::CHECKPOINT_KIND);
+
+  const Eigen::MatrixXd layout = derived().layout();
+
+  writer.addMatrix("layout", layout);
+  writer.addMatrix("weights", m_weights);
+  writer.addValue("seed", m_seed);
+  writer.addValue("iteration", m_iteration);
+  derived().saveSections(writer);
+
+  writer.write(path);
+}
+
+template <typename Derived, typename FeatureSet>
+void LinearQ<Derived, FeatureSet>::load(const std::string& path)
+{
+  CheckpointReader reader(path);
+
+  if (reader.getKind() != Derived::CHECKPOINT_KIND)
+    throw std::runtime_error("The checkpoint '" + path + "' belongs to a " + reader.getKind() + " agent, not to "
+                             + Derived::CHECKPOINT_KIND);
+
+  // The same weights mean something else for other ranges or widths, a relative tolerance for the rounding of them
+  const Eigen::Map<const Eigen::MatrixXd> layout = reader.matrix("layout");
+  const Eigen::MatrixXd expected = derived().layout();
+
+  if (layout.rows() != expected.rows() or layout.cols() != expected.cols()
+      or ((layout - expected).array().abs() > 1e-12 * (1.0 + expected.array().abs())).any())
+    throw std::runtime_error("The checkpoint '" + path + "' was written with other ranges or widths of the features");
+
+  const Eigen::Map<const Eigen::MatrixXd> weights = reader.matrix("weights");
+
+  if (weights.rows() != m_weights.rows())
+    throw std::runtime_error("The checkpoint '" + path + "' has a different number of actions");
+
+  derived().loadSections(reader, path, weights.cols());
+
+  m_weights = weights;
+  m_seed = reader.value<std::uint64_t>("seed");
+  m_iteration = reader.value<std::uint64_t>("iteration");
+}
+
+#endif // _LINEARQ_H_
@@ -0,0 +1,141 @@
+#ifndef _MULTILINEARGRID_H_
+#define _MULTILINEARGRID_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "Eigen/Dense"
+
+#include "HaxBallField.h"
+
+///
+/// \brief The MultilinearGrid class maps continuous states to the corners of their grid cell and the interpolation weights
+///
+/// The grid has points at low + k * resolution along every chosen state component. A state lies in the box of 2^d
+/// neighbouring points (d dimensions), its weight for a corner is the product over the dimensions of 1 - f or f,
+/// f being the fractional position within the box along that dimension. The weights are non-negative and sum to 1,
+/// a function stored at the grid points and interpolated with them is continuous and linear along every axis,
+/// no steps at the borders of the cells as with rounding to the nearest point.
+///
+/// The grid points are numbered densely (mixed radix over the dimensions), getSize() in total. Values outside of the
+/// range of a component are clipped to the border.
+///
+class MultilinearGrid
+{
+public:
+
+  /// The corners of many states, one column per state
+  typedef Eigen::MatrixXi CornerMatrix;
+
+  /// The weights of the corners, one column per state
+  typedef Eigen::MatrixXd WeightMatrix;
+
+  /// The corners and their weights of one or more states, column k belongs to state k
+  struct Cells
+  {
+    CornerMatrix corners;
+    WeightMatrix weights;
+  };
+
+  ///
+  /// \brief MultilinearGrid Creates a grid without dimensions, add them with addDimension()
+  /// \param state_dimension The size of the state vectors
+  ///
+  explicit MultilinearGrid(int state_dimension = HaxBallField::STATE_DIMENSION);
+
+  ///
+  /// \brief addDimension Adds a state component to the grid
+  /// \param component The index in the state vector
+  /// \param low The first grid point, smaller values are clipped
+  /// \param high The largest value, larger values are clipped, the last grid point is at or above it
+  /// \param resolution The distance of two grid points along this component
+  /// \return the number of the new dimension
+  ///
+  /// Throws std::invalid_argument for an invalid component, an empty range, a resolution <= 0, more than
+  /// MAX_DIMENSIONS dimensions or more than 2^31 - 1 grid points.
+  ///
+  int addDimension(int component, double low, double high, double resolution);
+
+  /// \return the number of dimensions
+  int getDimensions() const { return static_cast<int>(m_dimensions.size()); }
+
+  /// \return the number of corners of a cell, 2^getDimensions()
+  int getCorners() const { return 1 << getDimensions(); }
+
+  /// \return the number of grid points
+  int getSize() const { return static_cast<int>(m_points); }
+
+  /// \return one column per dimension: the state component, the low and high end of its range and the resolution
+  Eigen::MatrixXd getLayout() const;
+
+  ///
+  /// \brief corners
+  /// \param state a continuous state
+  /// \param corners receives the grid points of the cell of the state, getCorners() rows
+  /// \param weights receives the interpolation weights of the corners, getCorners() rows
+  ///
+  void corners(const Eigen::Ref<const Eigen::VectorXd>& state,
+               Eigen::Ref<Eigen::VectorXi> corners, Eigen::Ref<Eigen::VectorXd> weights) const;
+
+  ///
+  /// \brief cornersBatch
+  /// \param states many continuous states, one per column
+  /// \param corners receives the corners, one column per state, getCorners() rows
+  /// \param weights receives the weights, one column per state, getCorners() rows
+  ///
+  /// Clipping, the cells and the fractions run component by component over all states, which vectorises, then the
+  /// corners of every state as in corners(). The same result as corners() for every column. Throws
+  /// std::invalid_argument if the sizes do not match.
+  ///
+  void cornersBatch(const Eigen::Ref<const Eigen::MatrixXd>& states,
+                    Eigen::Ref<CornerMatrix> corners, Eigen::Ref<WeightMatrix> weights) const;
+
+  /// The largest number of dimensions, the corners grow as 2^d
+  static const int MAX_DIMENSIONS = 10;
+
+private:
+
+  ///
+  /// \brief split Doubles the corners along one more dimension, corner c + n is corner c one point further
+  /// \param n The number of corners so far
+  /// \param offset The number of the lower point of the cell along the dimension times its stride
+  /// \param f The position within the cell along the dimension, in [0, 1]
+  ///
+  /// Two contiguous ranges of length n, the loop vectorises for the upper dimensions.
+  ///
+  static void split(int* corners, double* weights, int n, int offset, int stride, double f)
+  {
+    for (int c = 0; c < n; ++c)
+    {
+      corners[c + n] = corners[c] + offset + stride;
+      corners[c] += offset;
+      weights[c + n] = weights[c] * f;
+      weights[c] *= 1.0 - f;
+    }
+  }
+
+  /// Everything the interpolation needs about one component
+  struct Dimension
+  {
+    /// The state component, its first grid point, clipping range in grid units and the inverse resolution
+    int component;
+    double low, high, inverse;
+
+    /// The number of grid points along the component, at least 2
+    std::int64_t points;
+
+    /// The distance of two neighbouring points in the numbering
+    std::int64_t stride;
+  };
+
+  /// The size of the state vectors
+  int m_state_dimension;
+
+  /// The dimensions of the grid
+  std::vector<Dimension> m_dimensions;
+
+  /// The number of grid points
+  std::int64_t m_points;
+};
+
+#endif // _MULTILINEARGRID_H_
@@ -0,0 +1,100 @@
+#ifndef _MULTILINEARQ_H_
+#define _MULTILINEARQ_H_
+
+#include <cstdint>
+
+#include "HaxBallField.h"
+#include "LinearQ.h"
+#include "MultilinearGrid.h"
+#include "Philox.h"
+
+#include "Eigen/Dense"
+
+///
+/// \brief The MultilinearQ class is a Q-learning agent with Q-values on a grid, interpolated between the grid points
+///
+/// A table of a rounded grid (QLearning) is constant within a cell, its greedy action jumps at the borders of the
+/// cells, and a smooth policy needs a fine grid. Here every point of a MultilinearGrid over all six state components
+/// holds one value per discrete action of Action::action_map(), and Q(s, a) is the multilinear interpolation of the
+/// 2^6 = 64 corners of the cell of s. The Q-function is continuous, a coarse grid gives a smooth policy.
+///
+/// The values of a grid point are the weights of LinearQ, the Q-values of all actions are a weighted sum of fixed size
+/// columns. The batched functions compute the corners of all states with MultilinearGrid::cornersBatch().
+///
+/// An update is the normalised gradient step of the linear interpolation: the TD error goes to the corners in
+/// proportion to their weights, scaled such that the interpolated Q(s, a) moves by ALPHA * (target - Q(s, a)).
+///
+class MultilinearQ : public LinearQ<MultilinearQ, MultilinearGrid::Cells>
+{
+public:
+
+  ///
+  /// \brief MultilinearQ Creates a new agent with all values 0
+  /// \param position_resolution The distance of the grid points along the player and ball positions
+  /// \param velocity_resolution The distance of the grid points along the ball velocity
+  /// \param seed The seed of the start states and of the exploration, taken from the clock if not specified
+  ///
+  explicit MultilinearQ(double position_resolution = 2.0, double velocity_resolution = 3.0,
+                        std::uint64_t seed = Philox4x32::clockSeed());
+  ~MultilinearQ();
+
+  ///
+  /// \brief activate
+  /// \param state a continuous state
+  /// \param cells receives the corners of the cell of the state and their interpolation weights, one column
+  ///
+  void activate(const Eigen::Ref<const Eigen::VectorXd>& state, Features& cells) const;
+
+  ///
+  /// \brief activateBatch
+  /// \param states many continuous states, one per column
+  /// \param cells receives the corners and weights, one column per state
+  ///
+  void activateBatch(const Eigen::Ref<const Eigen::MatrixXd>& states, Features& cells) const;
+
+  ///
+  /// \brief actionValues
+  /// \param cells the corners and weights of one or more states
+  /// \param k the number of the state in the cells
+  /// \return the Q-values of all actions, the padding is undefined
+  ///
+  ActionValues actionValues(const Features& cells, int k = 0) const;
+
+  ///
+  /// \brief actionValuesAtomic The same as actionValues(), safe while other threads update
+  ///
+  ActionValues actionValuesAtomic(const Features& cells, int k = 0) const;
+
+  ///
+  /// \brief update Moves Q(s, a) towards a target, safe while other threads update
+  /// \param cells the corners and weights of s
+  /// \param k the number of s in the cells
+  /// \param action the discrete action
+  /// \param target the new estimate of Q(s, a)
+  ///
+  void update(const Features& cells, int k, int action, double target);
+
+  /// \return the ranges and resolutions of the grid, a checkpoint of another grid does not load
+  Eigen::MatrixXd layout() const { return m_grid.getLayout(); }
+
+  /// \return the grid of the Q-function
+  const MultilinearGrid& getGrid() const { return m_grid; }
+
+private:
+
+  /// The grid, the values at its points are the weights of LinearQ
+  MultilinearGrid m_grid;
+
+public:
+
+  /// Step size, discount and exploration
+  static const double ALPHA, GAMMA, EPSILON;
+
+  /// Trajectories per call to training() and their length
+  static const int TRAJECTORIES, STEPS;
+
+  /// The kind of agent in the checkpoints
+  static const char* const CHECKPOINT_KIND;
+};
+
+#endif // _MULTILINEARQ_H_
@@ -0,0 +1,234 @@
+#ifndef _PHILOX_H_
+#define _PHILOX_H_
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+///
+/// \brief The Philox4x32 class is a counter based random number generator (Philox 4x32-10)
+///
+/// Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC 2011.
+///
+/// The random numbers are a pure function of (seed, stream, counter): ten rounds of a cheap bijection
+/// scramble the 128 bit counter with the 64 bit seed as key. This gives some useful properties:
+/// * Independent streams: every stream id (e.g. an environment, a particle or a training iteration) has its own
+///   sequence of 2^64 blocks, no matter which thread draws it. Results are reproducible regardless of the thread count.
+/// * Random access: block(seed, stream, index) is stateless, loops over many environments can draw in parallel and vectorise.
+/// * Small state: a generator is a few bytes and can be created on the fly, e.g. once per trajectory.
+///
+/// The class satisfies the UniformRandomBitGenerator requirements, hence it also works with the std distributions.
+/// It is not thread safe, give each thread its own instance (e.g. with its own stream).
+///
+class Philox4x32
+{
+public:
+
+  /// 32 bit random numbers, as required by the standard library
+  typedef std::uint32_t result_type;
+
+  /// One output block of four 32 bit numbers
+  typedef std::array<std::uint32_t, 4> Block;
+
+  ///
+  /// \brief Philox4x32 Creates a generator at the beginning of a stream
+  /// \param seed The key of the generator, the same seed produces the same numbers
+  /// \param stream The id of the stream, different ids produce independent sequences
+  ///
+  explicit Philox4x32(std::uint64_t seed = clockSeed(), std::uint64_t stream = 0) { this->seed(seed, stream); }
+
+  ///
+  /// \brief seed Restarts the generator
+  /// \param seed The key of the generator
+  /// \param stream The id of the stream
+  ///
+  void seed(std::uint64_t seed, std::uint64_t stream = 0)
+  {
+    m_seed = seed;
+    m_stream = stream;
+    m_index = 0;
+    m_position = 4;
+  }
+
+  /// \return the seed of the generator
+  std::uint64_t getSeed() const { return m_seed; }
+
+  /// \return the stream of the generator
+  std::uint64_t getStream() const { return m_stream; }
+
+  /// \return the index of the next block, the position in the stream
+  std::uint64_t getIndex() const { return m_index; }
+
+  ///
+  /// \brief seek Jumps to a block in the stream in constant time
+  /// \param index The index of the next block to use
+  ///
+  void seek(std::uint64_t index)
+  {
+    m_index = index;
+    m_position = 4;
+  }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+  /// \return the next 32 random bits
+  result_type operator()()
+  {
+    if (m_position == 4)
+    {
+      m_buffer = block(m_seed, m_stream, m_index++);
+      m_position = 0;
+    }
+
+    return m_buffer[m_position++];
+  }
+
+  /// \return the next 64 random bits
+  std::uint64_t next64()
+  {
+    const std::uint64_t lo = (*this)();
+    const std::uint64_t hi = (*this)();
+    return (hi << 32) | lo;
+  }
+
+  ///
+  /// \brief uniform
+  /// \return a uniformly distributed number in [0, 1) with the full precision of the scalar type
+  ///
+  template <typename Scalar>
+  Scalar uniform();
+
+  ///
+  /// \brief uniform
+  /// \return a uniformly distributed number in [low, high)
+  ///
+  /// \overload
+  ///
+  template <typename Scalar>
+  Scalar uniform(Scalar low, Scalar high) { return uniform<Scalar>() * (high - low) + low; }
+
+  ///
+  /// \brief normal
+  /// \return a standard normal distributed number (Box-Muller on one block, one number per block)
+  ///
+  double normal()
+  {
+    const Block b = block(m_seed, m_stream, m_index++);
+    m_position = 4;
+    return normal(b);
+  }
+
+  ///
+  /// \brief block The core of Philox: the random block at a position of a stream
+  /// \param seed The key
+  /// \param stream The id of the stream, the upper half of the counter
+  /// \param index The index of the block in the stream, the lower half of the counter
+  /// \return four 32 bit random numbers
+  ///
+  /// Stateless and branch free, call it from any thread or inside a SIMD loop.
+  ///
+  static Block block(std::uint64_t seed, std::uint64_t stream, std::uint64_t index)
+  {
+    std::uint32_t c0 = std::uint32_t(index), c1 = std::uint32_t(index >> 32);
+    std::uint32_t c2 = std::uint32_t(stream), c3 = std::uint32_t(stream >> 32);
+    std::uint32_t k0 = std::uint32_t(seed), k1 = std::uint32_t(seed >> 32);
+
+    for (int round = 0; round < 10; ++round)
+    {
+      const std::uint64_t p0 = std::uint64_t(M0) * c0;
+      const std::uint64_t p1 = std::uint64_t(M1) * c2;
+
+      const std::uint32_t n0 = std::uint32_t(p1 >> 32) ^ c1 ^ k0;
+      const std::uint32_t n2 = std::uint32_t(p0 >> 32) ^ c3 ^ k1;
+
+      c1 = std::uint32_t(p1);
+      c3 = std::uint32_t(p0);
+      c0 = n0;
+      c2 = n2;
+
+      k0 += W0;
+      k1 += W1;
+    }
+
+    return Block{c0, c1, c2, c3};
+  }
+
+  ///
+  /// \brief uniformAt Stateless uniform number in [0, 1) with 53 bits, the first half of a block
+  ///
+  static double uniformAt(std::uint64_t seed, std::uint64_t stream, std::uint64_t index)
+  {
+    const Block b = block(seed, stream, index);
+    return toDouble(b[0], b[1]);
+  }
+
+  ///
+  /// \brief normalAt Stateless standard normal number, the same as normal() at this position of the stream
+  ///
+  static double normalAt(std::uint64_t seed, std::uint64_t stream, std::uint64_t index)
+  {
+    return normal(block(seed, stream, index));
+  }
+
+  ///
+  /// \brief deriveSeed Creates a new seed from a seed and a stream id
+  ///
+  /// Useful to give a whole subsystem (e.g. a batch of environments, which uses one stream per environment)
+  /// its own independent seed for every training iteration.
+  ///
+  static std::uint64_t deriveSeed(std::uint64_t seed, std::uint64_t stream)
+  {
+    // Counter index 2^64-1 is reserved for this purpose
+    const Block b = block(seed, stream, std::numeric_limits<std::uint64_t>::max());
+    return (std::uint64_t(b[1]) << 32) | b[0];
+  }
+
+  ///
+  /// \brief clockSeed
+  /// \return a seed from the clock, for runs which do not need to be reproducible
+  ///
+  static std::uint64_t clockSeed() { return static_cast<std::uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count()); }
+
+private:
+
+  /// 53 random bits as double in [0, 1)
+  static double toDouble(std::uint32_t lo, std::uint32_t hi) { return double(((std::uint64_t(hi) << 32) | lo) >> 11) * 0x1.0p-53; }
+
+  /// 24 random bits as float in [0, 1)
+  static float toFloat(std::uint32_t bits) { return float(bits >> 8) * 0x1.0p-24f; }
+
+  /// Box-Muller transform of the two doubles in a block, the first of the pair
+  static double normal(const Block& b)
+  {
+    // 1 - u is in (0, 1], the logarithm stays finite
+    const double u1 = 1.0 - toDouble(b[0], b[1]);
+    const double u2 = toDouble(b[2], b[3]);
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586476925 * u2);
+  }
+
+  // The multipliers and the key increments (golden ratio, sqrt(3) - 1) of Philox 4x32
+  static constexpr std::uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+  static constexpr std::uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+
+  std::uint64_t m_seed, m_stream, m_index;
+
+  // The current block and the next unused number in it
+  Block m_buffer;
+  int m_position;
+};
+
+template <>
+inline double Philox4x32::uniform<double>()
+{
+  const std::uint32_t lo = (*this)();
+  const std::uint32_t hi = (*this)();
+  return toDouble(lo, hi);
+}
+
+template <>
+inline float Philox4x32::uniform<float>() { return toFloat((*this)()); }
+
+#endif // _PHILOX_H_
@@ -0,0 +1,130 @@
+#ifndef _PRIORITIZEDSWEEPING_H_
+#define _PRIORITIZEDSWEEPING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "PriorityMultiQueue.h"
+#include "ValueIteration.h"
+
+///
+/// \brief The PrioritizedSweeping class plans on the model of ValueIteration, but only backs up where values change
+///
+/// A full sweep backs up every cell, even where nothing changed since the last one. Prioritized sweeping keeps the
+/// cells with a Bellman error |max_a Q(s, a) - V(s)| above a threshold in a priority queue, the largest error first.
+/// A backup of a cell s which changes V(s) by delta changes the Bellman error of every predecessor p (a cell with a
+/// transition into s) by at most GAMMA * max_a p(s | p, a) * delta. The predecessors and these weights are looked up
+/// in a predecessor index (the model transposed, compressed rows). Every cell sums the bounds of the changes since
+/// its last backup and enters the queue once the sum exceeds the threshold. The sum bounds the Bellman error, hence
+/// no error above the threshold remains when the queue is empty, without ever evaluating a predecessor.
+///
+/// After a change of the reward (setRewardWeights()) only the cells with a different expected reward enter the
+/// queue, the values of the last plan() are the start, and the backups follow the change as far as it spreads.
+/// The self loops of the cells are solved within the backup (ValueIteration::greedyFixedPoint()), a cell is not
+/// its own predecessor.
+///
+/// The threads of plan() share the queue, a PriorityMultiQueue, and update the values and sums with atomic
+/// operations. A cell is in the queue at most once, with the sum at the time it entered. The progress (backups,
+/// queue size, largest queued sum) is recorded every REPORT_INTERVAL backups.
+///
+class PrioritizedSweeping : public ValueIteration
+{
+public:
+
+  /// The state of plan() at some point
+  struct Progress
+  {
+    /// The time since the start of plan() and the backups so far
+    double seconds;
+    std::uint64_t backups;
+
+    /// The number of queued cells and the largest priority among them, the residual
+    std::size_t queued;
+    double residual;
+  };
+
+  ///
+  /// \brief PrioritizedSweeping Creates the grid, the model is built by the first plan()
+  ///
+  /// See ValueIteration for the parameters.
+  ///
+  explicit PrioritizedSweeping(double position_resolution = 1.0, double velocity_resolution = 2.0,
+                               int samples = 8, std::uint64_t seed = Philox4x32::clockSeed(), bool symmetric = false);
+  ~PrioritizedSweeping();
+
+  /// The weighted player ball distance and goals
+  double reward(const Eigen::Ref<const Eigen::VectorXd>& s,
+                const Eigen::Ref<const Eigen::VectorXd>& action,
+                const Eigen::Ref<const Eigen::VectorXd>& s_prime) const override;
+
+  ///
+  /// \brief setRewardWeights Changes the reward, the next plan() starts from the cells where the reward changed
+  /// \param distance The weight of Reward::distance_player_ball_dense()
+  /// \param goal The weight of Reward::ball_in_goal()
+  ///
+  /// Recomputes the rewards of the model if there is one, which simulates every sample once more.
+  ///
+  void setRewardWeights(double distance, double goal);
+
+  ///
+  /// \brief plan Backs up cells in the order of their Bellman errors until no error exceeds the threshold
+  /// \param threshold Cells with a smaller Bellman error are not queued
+  /// \param max_backups Stops after this number of backups anyway, the queue is kept for the next call
+  /// \return the number of backups
+  ///
+  /// The first call builds the model and the predecessor index and queues every cell.
+  ///
+  std::uint64_t plan(double threshold = 1e-4, std::uint64_t max_backups = std::numeric_limits<std::uint64_t>::max());
+
+  /// \return the progress of the last plan(), from its start to its end
+  const std::vector<Progress>& getProgress() const { return m_progress; }
+
+  /// \return the number of cells in the queue
+  std::size_t getQueued() const { return m_queue.getSize(); }
+
+  /// \return the number of bytes of the model, the predecessor index, the values and the policy
+  std::size_t memoryUsage() const;
+
+  /// Backups between two entries of the progress
+  static const std::uint64_t REPORT_INTERVAL;
+
+private:
+
+  /// Transposes the model into the predecessor index
+  void buildPredecessors();
+
+  ///
+  /// \brief raise Adds to the bound of the Bellman error of a cell and queues it above the threshold, thread safe
+  ///
+  void raise(std::uint32_t cell, double change, double threshold, Philox4x32& random_engine);
+
+private:
+
+  /// The predecessors of cell c are m_predecessors[m_predecessor_offsets[c] ... m_predecessor_offsets[c + 1]),
+  /// m_predecessor_weights holds GAMMA * max_a p(c | predecessor, a) for each
+  std::vector<std::uint64_t> m_predecessor_offsets;
+  std::vector<std::uint32_t> m_predecessors;
+  std::vector<float> m_predecessor_weights;
+
+  /// The cells to check at the start of the next plan()
+  std::vector<std::uint32_t> m_dirty;
+
+  /// The queue, per cell the bound of the Bellman error and 1 while the cell is queued
+  PriorityMultiQueue m_queue;
+  std::vector<double> m_bounds;
+  std::vector<std::uint8_t> m_queued;
+
+  /// The weights of the reward
+  double m_distance_weight, m_goal_weight;
+
+  /// The progress of the last plan()
+  std::vector<Progress> m_progress;
+
+  /// The number of calls to plan(), seeds the streams of the threads
+  std::uint64_t m_plans;
+};
+
+#endif // _PRIORITIZEDSWEEPING_H_
@@ -0,0 +1,96 @@
+#ifndef _PRIORITYMULTIQUEUE_H_
+#define _PRIORITYMULTIQUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Philox.h"
+
+///
+/// \brief The PriorityMultiQueue class is a concurrent priority queue of items with a priority
+///
+/// One binary heap behind one lock cannot serve many threads, every push and pop would wait for the same lock.
+/// The multi queue has several heaps, each with its own lock (Rihani, Sanders, Dementiev, 2015). push() inserts into
+/// a random heap, pop() looks at the tops of two random heaps without locking and takes the larger one.
+/// Collisions are rare with twice as many heaps as threads, and the popped item is among the largest ones with
+/// high probability, but not always the largest. This is called a relaxed priority queue, and prioritized sweeping
+/// does not need more.
+///
+/// The queue neither merges nor removes duplicates, the caller decides which items are stale.
+///
+class PriorityMultiQueue
+{
+public:
+
+  /// An item and its priority
+  struct Entry
+  {
+    double priority;
+    std::uint32_t item;
+
+    bool operator<(const Entry& other) const { return priority < other.priority; }
+  };
+
+  ///
+  /// \brief PriorityMultiQueue Creates an empty queue
+  /// \param heaps The number of heaps, e.g. twice the number of threads
+  ///
+  /// Throws std::invalid_argument if heaps < 1.
+  ///
+  explicit PriorityMultiQueue(int heaps);
+
+  PriorityMultiQueue(const PriorityMultiQueue&) = delete;
+  PriorityMultiQueue& operator=(const PriorityMultiQueue&) = delete;
+
+  ///
+  /// \brief push Inserts an item, thread safe
+  /// \param random_engine The random numbers of the calling thread, choose the heap
+  ///
+  void push(std::uint32_t item, double priority, Philox4x32& random_engine);
+
+  ///
+  /// \brief pop Removes an item with one of the largest priorities, thread safe
+  /// \param random_engine The random numbers of the calling thread, choose the heaps
+  /// \param entry receives the item and its priority
+  /// \return false if the queue is empty
+  ///
+  bool pop(Philox4x32& random_engine, Entry& entry);
+
+  /// \return the number of items in the queue, exact only without concurrent push() and pop()
+  std::size_t getSize() const { return m_size.load(std::memory_order_acquire); }
+
+  /// \return the largest priority of the tops of the heaps, 0 if empty, approximate while other threads push or pop
+  double getTopPriority() const;
+
+  /// Removes all items, not thread safe
+  void clear();
+
+private:
+
+  /// A heap and its lock on their own cache lines, the top is read without the lock
+  struct alignas(64) Heap
+  {
+    std::mutex mutex;
+    std::vector<Entry> entries;
+    std::atomic<double> top;
+  };
+
+  /// Pops from the heap if its lock is free and it is not empty
+  bool tryPop(Heap& heap, Entry& entry);
+
+  /// The top of an empty heap
+  static const double EMPTY;
+
+private:
+
+  std::vector<std::unique_ptr<Heap>> m_heaps;
+
+  /// The number of items in all heaps
+  std::atomic<std::size_t> m_size;
+};
+
+#endif // _PRIORITYMULTIQUEUE_H_
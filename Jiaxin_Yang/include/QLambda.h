@@ -0,0 +1,121 @@
+#ifndef _QLAMBDA_H_
+#define _QLAMBDA_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "QLearning.h"
+#include "Trajectory.h"
+
+///
+/// \brief The QLambda class is QLearning with eligibility traces, Watkins's Q(lambda)
+///
+/// A one-step update moves a reward back by one cell per visit. Q(lambda) keeps a trace e(s, a) of the recently
+/// visited pairs and applies the TD error of every step to all of them, Q(s, a) += ALPHA * delta * e(s, a), the
+/// reward reaches the whole path to it at once. The traces decay by discount * lambda per step, a visit replaces
+/// the trace of the pair with 1 and clears the traces of the other actions of the cell. The greedy policy is the
+/// one learned, an exploratory action ends the traces (Watkins), and so does a goal.
+///
+/// A dense trace table would cost one pass over all cells per step. Here the traces are a short list per trajectory
+/// of the pairs with a trace of at least the threshold, the rest are dropped. A step costs the length of the list,
+/// about log(threshold) / log(discount * lambda) + 1 updates. With lambda = 0 the list holds the current pair only,
+/// and the training is one-step Q-learning with the same exploration, which makes it the baseline to compare with.
+///
+/// The Q-table, the grid, the reward, the seed and the checkpoints are those of QLearning. The trajectories of
+/// training() run in parallel and update the shared Q-table with atomic operations (Hogwild), the traces are private.
+///
+class QLambda : public QLearning
+{
+public:
+
+  ///
+  /// \brief QLambda Creates a new agent
+  /// \param lambda The decay of the traces in [0, 1], 0 is one-step Q-learning
+  /// \param discount The discount in [0, 1)
+  /// \param threshold Traces below this value in (0, 1] are dropped
+  /// \param seed The seed of the start states and of the exploration in the training
+  /// \param full_state Discretizes the full state instead of the player ball offset only, see QLearning
+  /// \param symmetric Mirrored cells share their Q-values, see QLearning
+  ///
+  /// Throws std::invalid_argument if a parameter is out of its range.
+  ///
+  explicit QLambda(double lambda = 0.8, double discount = 0.9, double threshold = 0.01,
+                   std::uint64_t seed = Philox4x32::clockSeed(), bool full_state = false, bool symmetric = false);
+  ~QLambda();
+
+  ///
+  /// \brief training
+  ///
+  /// One call runs TRAJECTORIES epsilon greedy trajectories of STEPS steps in parallel, Q(lambda) updates after each step.
+  ///
+  void training();
+
+  ///
+  /// \brief trainingBatched The same trajectories as training(), but the updates are applied per trajectory
+  ///
+  /// Every step reads the Q-table once for the successor, the trajectory is recorded and its lambda-returns are
+  /// computed in one backward pass (Trajectory), then every step moves Q(s_t, a_t) towards its lambda-return. This is
+  /// the offline forward view of the traces: one update per step instead of one per trace, but the values change only
+  /// at the end of a trajectory and the lambda-returns do not cut at exploratory actions.
+  ///
+  void trainingBatched();
+
+  /// \return the number of steps in all calls to training() and trainingBatched()
+  std::uint64_t getSteps() const { return m_steps; }
+
+  /// \return the number of Q-value updates in all calls to training() and trainingBatched(), for training() the length
+  /// of the trace list summed over the steps, for trainingBatched() one per step
+  std::uint64_t getUpdates() const { return m_updates; }
+
+  /// \return the decay of the traces, the discount and the smallest trace kept
+  double getLambda() const { return m_lambda; }
+  double getDiscount() const { return m_discount; }
+  double getThreshold() const { return m_threshold; }
+
+  /// Step size and exploration
+  static const double ALPHA, EPSILON;
+
+  /// Trajectories per call to training() and their length
+  static const int TRAJECTORIES, STEPS;
+
+private:
+
+  /// A pair (cell, action) with a trace
+  struct Trace
+  {
+    std::uint64_t cell;
+    int action;
+    double trace;
+  };
+
+  ///
+  /// \brief visit Sets the trace of a pair to 1 and removes the traces of the other actions of its cell
+  ///
+  static void visit(std::vector<Trace>& traces, std::uint64_t cell, int action);
+
+  ///
+  /// \brief updateTraces Applies a TD error to the list, then decays the traces and drops the small ones
+  /// \param traces The list of the trajectory, the pair of the step is already in it with trace 1
+  /// \param delta The TD error of the step
+  /// \param decay The factor of the traces for the next step, 0 ends them
+  /// \return the number of updated Q-values
+  ///
+  template <typename TableType>
+  std::uint64_t updateTraces(TableType& qTable, std::vector<Trace>& traces, double delta, double decay);
+
+  /// The loops of training() and trainingBatched() on the table in qTable
+  template <typename TableType>
+  void training(TableType& qTable);
+  template <typename TableType>
+  void trainingBatched(TableType& qTable);
+
+private:
+
+  /// The decay of the traces, the discount and the smallest trace kept
+  double m_lambda, m_discount, m_threshold;
+
+  /// Counters over all calls to training()
+  std::uint64_t m_steps, m_updates;
+};
+
+#endif // _QLAMBDA_H_
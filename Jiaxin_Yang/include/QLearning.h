@@ -2,24 +2,50 @@
 #define _QLEARNING_H_
 
 #include "BaseAgent.h"
-#include "HaxBall.h"
-#include <map>
+#include "Discretizer.h"
+#include "HaxBallField.h"
+#include "Philox.h"
+#include "QTable.h"
+#include "SparseQTable.h"
+#include <cstdint>
 #include <utility>
+#include <variant>
 #include "Eigen/Dense"
 #include <fstream>
-
-using QTable = std::map<std::pair<double, double>, std::map<std::pair<double, double>, double>>;
+#include <string>
 
 class QLearning : public BaseAgent
 {
 private:
-  const HaxBall m_world;
   std::ofstream outfile;
+
+protected:
+  /// The seed of the training and the number of calls to training(), each trajectory gets its own random stream
+  std::uint64_t m_seed, m_iteration;
+
+  /// Whether the grid covers the full state or only the player ball offset
+  bool m_full_state;
+
+  /// Whether mirrored cells share their Q-values, see Symmetry.h
+  bool m_symmetric;
+
+  /// The grid of the Q-table: player ball offset in x and y (and the ball for the full state), Morton ordered cells
+  Discretizer m_discretizer;
 public:
-  QLearning();
+  ///
+  /// \brief QLearning Creates a new agent
+  /// \param seed The seed of the start states in the training, taken from the clock if not specified
+  /// \param full_state Discretizes the full state (player ball offset, ball position and velocity) instead of the offset only
+  /// \param symmetric Stores only one of two cells which are mirror images about the x-axis, see Symmetry.h
+  ///
+  explicit QLearning(std::uint64_t seed = Philox4x32::clockSeed(), bool full_state = false, bool symmetric = false);
   ~QLearning();
 
-  QTable qTable;
+  /// The dense table for the player ball offset, the sparse one for the full state, see createQTable()
+  typedef std::variant<QTable, SparseQTable> Table;
+
+  /// The Q-values keyed by the cell index of the discretizer
+  Table qTable;
 
   double rewardValue;
 
@@ -48,17 +74,84 @@ public:
   Eigen::VectorXd getQfactor(const Eigen::Ref<const Eigen::VectorXd>& state) const override;
 
   // Function declarations
-  QTable createQTable();
-  std::pair<int, int> getBestAction(const QTable& qTable, const std::pair<double, double>& RoundedState) const;
+  static Discretizer createDiscretizer(bool full_state = false);
+  /// The Q-table of the grid of createDiscretizer(): dense with all cells for the offset, sparse for the full state
+  static Table createQTable(bool full_state = false);
+  template <typename TableType>
+  std::pair<int, int> getBestAction(const TableType& qTable, std::uint64_t cell) const;
+  /// The same as getBestAction(), but safe while other threads update the Q-table
+  template <typename TableType>
+  std::pair<int, int> getBestActionAtomic(const TableType& qTable, std::uint64_t cell) const;
   //double reward(const std::pair<int, int>& state_distance, const Eigen::Ref<const Eigen::VectorXd>& state);
-  double reward(const std::pair<int, int>& state_distance, const Eigen::Ref<const Eigen::VectorXd>& state);
-  void updateQTable(const Eigen::Ref<const Eigen::VectorXd>& state, QTable& qTable, const std::pair<int, int>& state_distance,const std::pair<int, int>& action, const std::pair<int, int>& nextState, double learningRate, const double& discountFactor);
+  double reward(const std::pair<double, double>& state_distance, const Eigen::Ref<const Eigen::VectorXd>& state);
+  /// One Q-learning update, lock free and safe to call from many threads on the same Q-table
+  template <typename TableType>
+  void updateQTable(const Eigen::Ref<const Eigen::VectorXd>& state, TableType& qTable, const std::pair<double, double>& state_distance, std::uint64_t cell, const std::pair<int, int>& action, std::uint64_t nextCell, double learningRate, const double& discountFactor);
+  /// The player ball offset, rounded to the grid and clipped
   std::pair<double, double> roundedState(const Eigen::Ref<const Eigen::VectorXd>& state) const;
+  /// The cell of the Q-table for a state
+  std::uint64_t stateIndex(const Eigen::Ref<const Eigen::VectorXd>& state) const;
+  ///
+  /// \brief canonicalIndex The cell of the Q-table for a state, the canonical one of the mirror images if symmetric
+  /// \param mirrored receives whether the Q-values of the cell belong to the mirror image, its actions are mirrored
+  ///
+  std::uint64_t canonicalIndex(const Eigen::Ref<const Eigen::VectorXd>& state, bool& mirrored) const;
+  /// The velocity command with the y velocity flipped
+  static std::pair<int, int> mirrorAction(const std::pair<int, int>& action) { return std::make_pair(action.first, -action.second); }
+  /// The column of the Q-table for a velocity command (x, y) in {-1, 0, 1}
+  static int actionIndex(const std::pair<int, int>& action);
+  /// The velocity command for a column of the Q-table
+  static std::pair<int, int> actionPair(int index);
   float customRound(float number) const;
   void training();
+  void seed(std::uint64_t seed);
+
+  ///
+  /// \brief save Writes the Q-table and the state of the training as checkpoint, atomically
+  ///
+  /// Throws std::runtime_error if the file cannot be written.
+  ///
+  void save(const std::string& path) const;
+
+  ///
+  /// \brief load Replaces the Q-table and the state of the training with a checkpoint written by save()
+  ///
+  /// The grid (offset only or full state) and the symmetry are taken from the checkpoint. Throws std::runtime_error if the file is
+  /// no QLearning checkpoint or if it was written with a different grid resolution.
+  ///
+  void load(const std::string& path);
+
+  /// The kind of agent in the checkpoints
+  static const char* const CHECKPOINT_KIND;
   void setAction(const Eigen::Ref<const Eigen::VectorXd>& state,Eigen::Ref<Eigen::VectorXd> action, const std::pair<int, int>& Bestaction);
   void writeRewardValueToFile(double rewardValue) const;
   double calculateAverageQValue(const QTable& qTable) const;
+  double calculateAverageQValue(const SparseQTable& qTable) const;
+
+  /// The grid spacing of the player ball distance in the Q-table, 1.0 gives the 17 x 9 cells
+  static const double RESOLUTION;
+
+  /// The largest player ball distance per axis on the grid, larger distances are clipped
+  static const double MAX_DISTANCE_X, MAX_DISTANCE_Y;
+
+  /// The grid spacing of the ball position and of the ball velocity, only for the full state
+  static const double RESOLUTION_BALL, RESOLUTION_VELOCITY;
+
+  /// The number of velocity commands per axis (-1, 0, +1), the table has the square of it as actions
+  static const int ACTIONS_PER_AXIS = 3;
+
+protected:
+  ///
+  /// \brief reserveCells Makes room for this many new cells, before the training threads share the Q-table
+  ///
+  /// Only the sparse table grows, the dense one holds all cells from the start.
+  ///
+  void reserveCells(std::uint64_t cells);
+
+private:
+  /// The loop of training() on the table in qTable
+  template <typename TableType>
+  void training(TableType& qTable);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,169 @@
+#ifndef _QTABLE_H_
+#define _QTABLE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CheckpointReader;
+class CheckpointWriter;
+
+///
+/// \brief The QTable class is a dense table of Q-values on a two dimensional grid of states
+///
+/// States are cells (ix, iy) of a grid with a fixed number of cells per axis, actions are numbered 0 ... N-1.
+/// Everything is one flat array: the Q-values of a cell are contiguous, each cell starts on a cache line
+/// and is padded to whole cache lines. Reading, writing and the best action of a cell are O(1),
+/// there is no search and nothing gets inserted by a lookup.
+///
+/// The padding holds the lowest double, hence the maximum over a padded cell can run in full SIMD width
+/// and still never picks a padding entry.
+///
+/// Concurrent training (Hogwild): the table is never resized after construction, so threads can share it
+/// as long as they only use the atomic functions (atomicLoad(), atomicAdd(), bestActionAtomic(), maxValueAtomic())
+/// while others write. Updates are lock free and never lost, reads see each value either before or after an update.
+/// Since every cell has its own cache lines, threads working in different cells do not share lines (no false sharing).
+/// The other functions are for single threaded use, e.g. the policy after the training.
+///
+/// A grid with more cells than fit into memory needs the SparseQTable, which stores the visited cells only.
+///
+class QTable
+{
+public:
+
+  ///
+  /// \brief QTable Creates a table with all Q-values set to the same value
+  /// \param cells_x The number of cells along the first grid axis
+  /// \param cells_y The number of cells along the second grid axis
+  /// \param actions The number of actions per cell
+  /// \param value The initial Q-value
+  ///
+  QTable(int cells_x, int cells_y, int actions, double value = 0.0);
+
+  /// \return the number of cells along the first grid axis
+  int getCellsX() const { return m_cells_x; }
+
+  /// \return the number of cells along the second grid axis
+  int getCellsY() const { return m_cells_y; }
+
+  /// \return the total number of cells
+  int getCells() const { return m_cells_x * m_cells_y; }
+
+  /// \return the number of actions per cell
+  int getActions() const { return m_actions; }
+
+  ///
+  /// \brief cell
+  /// \return the index of grid cell (ix, iy), no range check
+  ///
+  int cell(int ix, int iy) const { return ix * m_cells_y + iy; }
+
+  /// \return the contiguous Q-values of all actions of a cell
+  const double* values(int cell) const { return m_data.data()->q + cell * m_stride; }
+
+  /// \return the contiguous Q-values of all actions of a cell
+  double* values(int cell) { return m_data.data()->q + cell * m_stride; }
+
+  /// \return the Q-value of an action in a cell, no range check
+  double operator()(int cell, int action) const { return values(cell)[action]; }
+
+  /// \return a reference to the Q-value of an action in a cell, no range check
+  double& operator()(int cell, int action) { return values(cell)[action]; }
+
+  ///
+  /// \brief bestAction
+  /// \return the action with the largest Q-value in the cell, the first one if several are equal
+  ///
+  int bestAction(int cell) const;
+
+  ///
+  /// \brief maxValue
+  /// \return the largest Q-value in the cell, i.e. the Q-value of bestAction()
+  ///
+  double maxValue(int cell) const;
+
+  ///
+  /// \brief atomicLoad
+  /// \return the Q-value of an action in a cell, safe while other threads call atomicAdd()
+  ///
+  double atomicLoad(int cell, int action) const
+  {
+    double value;
+#pragma omp atomic read
+    value = values(cell)[action];
+    return value;
+  }
+
+  ///
+  /// \brief atomicAdd Adds a value to a Q-value, safe while other threads read or add
+  ///
+  void atomicAdd(int cell, int action, double delta)
+  {
+    double* value = values(cell) + action;
+#pragma omp atomic update
+    *value += delta;
+  }
+
+  ///
+  /// \brief bestActionAtomic The same as bestAction(), safe while other threads call atomicAdd()
+  ///
+  int bestActionAtomic(int cell) const;
+
+  ///
+  /// \brief maxValueAtomic The same as maxValue(), safe while other threads call atomicAdd()
+  ///
+  double maxValueAtomic(int cell) const;
+
+  ///
+  /// \brief fill Sets all Q-values to the same value, the padding stays untouched
+  ///
+  void fill(double value);
+
+  ///
+  /// \brief sum
+  /// \return the sum of all Q-values
+  ///
+  double sum() const;
+
+  ///
+  /// \brief save Adds the table as sections "<name>.grid" and "<name>.cells" to a checkpoint
+  ///
+  /// The cells are stored as they are, the table must stay unchanged until the checkpoint is written.
+  ///
+  void save(CheckpointWriter& writer, const std::string& name) const;
+
+  ///
+  /// \brief load Replaces the table with the one stored by save()
+  ///
+  /// Throws std::runtime_error if the sections are missing or inconsistent.
+  ///
+  void load(const CheckpointReader& reader, const std::string& name);
+
+private:
+
+  /// The shape of the table in a checkpoint
+  struct Grid
+  {
+    std::int64_t cells_x, cells_y, actions, stride;
+  };
+
+  /// The size of a cache line in doubles
+  static const int LINE = 8;
+
+  /// One cache line, the vector of these gives the alignment of the whole table
+  struct alignas(LINE * sizeof(double)) Line
+  {
+    double q[LINE];
+  };
+
+  /// The grid and the number of actions
+  int m_cells_x, m_cells_y, m_actions;
+
+  /// The distance between two cells in doubles, the number of actions rounded up to whole cache lines
+  int m_stride;
+
+  /// All cells one after another
+  std::vector<Line> m_data;
+};
+
+#endif // _QTABLE_H_
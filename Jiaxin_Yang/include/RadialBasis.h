@@ -0,0 +1,192 @@
+#ifndef _RADIALBASIS_H_
+#define _RADIALBASIS_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "Eigen/Dense"
+
+#include "HaxBallField.h"
+
+///
+/// \brief The RadialBasis class maps continuous states to the Gaussian features of the nearby centres
+///
+/// Every centre i has the feature exp(-|u - c_i|^2 / 2), u being the state scaled by one width per component.
+/// The features are normalised to sum to 1 (a normalised RBF network), which keeps a linear function over them
+/// within the range of its weights. A feature is cut to 0 where the distance along any component exceeds CUTOFF
+/// widths, the remaining ones are the active centres of a state.
+///
+/// Evaluating all centres for every state would cost the number of centres. The centres are sorted into buckets
+/// of a grid with CUTOFF widths per component, the active centres of a state lie in the at most three neighbouring
+/// buckets per component. The buckets are numbered with the first component innermost and the centres stored in the
+/// order of their buckets, hence the three buckets along the first component are one contiguous range. The
+/// coordinates of the centres are stored component by component, the distances of a range of centres are a
+/// vectorised loop, and the exponentials of all active centres are one vectorised Eigen exp() over a buffer.
+///
+/// Only the leading dimensions are bucketed, as long as a bucket holds MIN_OCCUPANCY centres on average, the
+/// remaining ones are left to the distance test. With one bucket per centre, as in six dimensions with a few ten
+/// thousand centres, a state would look at hundreds of ranges of a few centres each and spend its time on the
+/// ranges instead of the centres. Add the components in the order in which they should be bucketed.
+///
+/// A box cutoff instead of a spherical one: in six dimensions a ball fills 8% of its bounding box, buckets around a
+/// ball would mostly hold centres beyond the cutoff.
+///
+class RadialBasis
+{
+public:
+
+  ///
+  /// \brief The Features struct holds the active centres and their normalised features of one or more states
+  ///
+  /// The centres of state k are centres[offsets[k] ... offsets[k + 1]), compressed rows.
+  ///
+  struct Features
+  {
+    std::vector<int> offsets;
+    std::vector<int> centres;
+    std::vector<double> weights;
+
+    /// \return the number of states
+    int getStates() const { return static_cast<int>(offsets.size()) - 1; }
+  };
+
+  /// Scaled centres, one row per dimension, each row contiguous
+  typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> CentreMatrix;
+
+  ///
+  /// \brief RadialBasis Creates a basis without dimensions and centres, add them with addDimension() and setCentres()
+  /// \param state_dimension The size of the state vectors
+  ///
+  explicit RadialBasis(int state_dimension = HaxBallField::STATE_DIMENSION);
+
+  ///
+  /// \brief addDimension Adds a state component, call before setCentres()
+  /// \param component The index in the state vector
+  /// \param low The smallest value of the centres, states are clipped to the range
+  /// \param high The largest value of the centres
+  /// \param width The width of the Gaussians along this component
+  /// \return the number of the new dimension
+  ///
+  /// Throws std::invalid_argument for an invalid component, an empty range, a width <= 0 or more than MAX_DIMENSIONS
+  /// dimensions, std::logic_error if there are centres already.
+  ///
+  int addDimension(int component, double low, double high, double width);
+
+  ///
+  /// \brief setCentres Replaces the centres, chooses the bucketed dimensions and sorts the centres into the buckets
+  /// \param centres One column per centre, one row per dimension (not per state component), clipped to the ranges
+  ///
+  /// Throws std::invalid_argument if the number of rows differs from getDimensions().
+  ///
+  void setCentres(const Eigen::Ref<const Eigen::MatrixXd>& centres);
+
+  ///
+  /// \brief restoreCentres Replaces the centres with the scaled ones of getScaledCentres(), in the same order
+  /// \param centres One column per centre, one row per dimension, scaled and in the order of their buckets
+  ///
+  /// Unlike setCentres() nothing is scaled and nothing gets sorted, a basis with the same dimensions gets exactly the
+  /// centres and the order of the one they come from. Throws std::invalid_argument if the number of rows differs from
+  /// getDimensions(), a centre lies outside of the scaled ranges or the centres are not in the order of their buckets.
+  ///
+  void restoreCentres(const Eigen::Ref<const CentreMatrix>& centres);
+
+  ///
+  /// \brief placeCentres Places centres uniformly at random within the ranges of the dimensions
+  ///
+  void placeCentres(int count, std::uint64_t seed);
+
+  /// \return the number of dimensions
+  int getDimensions() const { return static_cast<int>(m_dimensions.size()); }
+
+  /// \return the number of centres
+  int getCentres() const { return static_cast<int>(m_centres.cols()); }
+
+  /// \return the number of buckets
+  int getBuckets() const { return static_cast<int>(m_offsets.size()) - 1; }
+
+  /// \return the number of leading dimensions that are bucketed
+  int getBucketedDimensions() const { return m_bucketed; }
+
+  /// \return the position of a centre, in the order of the buckets, one row per dimension
+  Eigen::VectorXd centre(int i) const;
+
+  /// \return the centres in widths from the low end of the ranges, one column per centre in the order of the buckets
+  const CentreMatrix& getScaledCentres() const { return m_centres; }
+
+  /// \return one column per dimension: the state component, the low and high end of its range and the width
+  Eigen::MatrixXd getLayout() const;
+
+  ///
+  /// \brief activate
+  /// \param state a continuous state
+  /// \param features receives the active centres and their normalised features as one row
+  ///
+  void activate(const Eigen::Ref<const Eigen::VectorXd>& state, Features& features) const;
+
+  ///
+  /// \brief activateBatch
+  /// \param states many continuous states, one per column
+  /// \param features receives the active centres of every state, one row per state
+  ///
+  /// The same result as activate() for every state, the exponentials of all states are computed together.
+  ///
+  void activateBatch(const Eigen::Ref<const Eigen::MatrixXd>& states, Features& features) const;
+
+  /// The distance in widths along a component beyond which a feature is 0
+  static const double CUTOFF;
+
+  /// The average number of centres per bucket below which no further dimension is bucketed
+  static const int MIN_OCCUPANCY = 16;
+
+  /// The largest number of dimensions
+  static const int MAX_DIMENSIONS = 16;
+
+private:
+
+  ///
+  /// \brief sortCentres Chooses the bucketed dimensions for the number of centres and sorts the scaled centres into the buckets
+  /// \param keep_order Only checks that the centres are sorted already, throws std::invalid_argument if not
+  ///
+  void sortCentres(const Eigen::Ref<const CentreMatrix>& centres, bool keep_order);
+
+  ///
+  /// \brief gather Appends the active centres of a state and their squared distances, without normalisation
+  ///
+  void gather(const Eigen::Ref<const Eigen::VectorXd>& state, std::vector<int>& centres,
+              std::vector<double>& distances) const;
+
+  ///
+  /// \brief normalise Turns the squared distances of all rows into normalised features
+  ///
+  static void normalise(Features& features);
+
+private:
+
+  /// Everything the bucketing needs about one component
+  struct Dimension
+  {
+    /// The state component, its range and the inverse width
+    int component;
+    double low, high, inverse;
+
+    /// The number of buckets along the component and the distance of two neighbouring buckets in the numbering
+    int buckets, stride;
+  };
+
+  /// The size of the state vectors
+  int m_state_dimension;
+
+  /// The dimensions of the basis
+  std::vector<Dimension> m_dimensions;
+
+  /// The number of leading dimensions that are bucketed
+  int m_bucketed;
+
+  /// The scaled centres (position / width), one row per dimension, each row contiguous, in the order of the buckets
+  CentreMatrix m_centres;
+
+  /// The centres of bucket b are [m_offsets[b], m_offsets[b + 1])
+  std::vector<int> m_offsets;
+};
+
+#endif // _RADIALBASIS_H_
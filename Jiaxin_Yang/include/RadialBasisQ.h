@@ -0,0 +1,141 @@
+#ifndef _RADIALBASISQ_H_
+#define _RADIALBASISQ_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "Checkpoint.h"
+#include "HaxBallField.h"
+#include "LinearQ.h"
+#include "RadialBasis.h"
+#include "Philox.h"
+
+#include "Eigen/Dense"
+
+///
+/// \brief The RadialBasisQ class is a Q-learning agent with a normalised RBF network as Q-function
+///
+/// A RadialBasis puts Gaussians over all six state components, at centres placed at random. Every centre holds one
+/// weight per discrete action of Action::action_map(), Q(s, a) is the sum of the weights of the active centres of s,
+/// each times its normalised feature. With the default widths and CENTRES centres a state activates about 35 of
+/// them, found through the buckets of the basis instead of by looking at all of them. Unlike the cells of QLearning::roundedState(), neighbouring
+/// states share most of their centres, an update generalises smoothly, and the centres need no regular grid.
+///
+/// An update is the normalised gradient step, Q(s, a) moves by ALPHA * (target - Q(s, a)), as in MultilinearQ. The
+/// batched functions activate all states first, with one pass of exponentials, updateBatch() then applies the
+/// updates one after another. The checkpoints hold the scaled centres, a loaded agent has exactly the centres and
+/// the order of the saved one.
+///
+class RadialBasisQ : public LinearQ<RadialBasisQ, RadialBasis::Features>
+{
+public:
+
+  ///
+  /// \brief RadialBasisQ Creates a new agent with all weights 0
+  /// \param centres The number of centres
+  /// \param seed The seed of the centres, the start states and the exploration, taken from the clock if not specified
+  ///
+  explicit RadialBasisQ(int centres = CENTRES, std::uint64_t seed = Philox4x32::clockSeed());
+  ~RadialBasisQ();
+
+  ///
+  /// \brief activate
+  /// \param state a continuous state
+  /// \param features receives the active centres of the state and their normalised features
+  ///
+  void activate(const Eigen::Ref<const Eigen::VectorXd>& state, Features& features) const { m_basis.activate(state, features); }
+
+  ///
+  /// \brief activateBatch
+  /// \param states many continuous states, one per column
+  /// \param features receives the active centres of every state
+  ///
+  void activateBatch(const Eigen::Ref<const Eigen::MatrixXd>& states, Features& features) const
+  {
+    m_basis.activateBatch(states, features);
+  }
+
+  ///
+  /// \brief actionValues
+  /// \param features the active centres of one or more states
+  /// \param k the number of the state in the features
+  /// \return the Q-values of all actions, the padding is undefined, 0 if no centre is active
+  ///
+  ActionValues actionValues(const Features& features, int k = 0) const;
+
+  ///
+  /// \brief actionValuesAtomic The same as actionValues(), safe while other threads update
+  ///
+  ActionValues actionValuesAtomic(const Features& features, int k = 0) const;
+
+  ///
+  /// \brief update Moves Q(s, a) towards a target, safe while other threads update
+  /// \param features the active centres of s
+  /// \param k the number of s in the features
+  /// \param action the discrete action
+  /// \param target the new estimate of Q(s, a)
+  ///
+  void update(const Features& features, int k, int action, double target);
+
+  ///
+  /// \brief updateBatch Moves Q(s, a) towards the targets for many states, one after another
+  /// \param states one state per column
+  /// \param actions the discrete action of every state
+  /// \param targets the new estimate of Q(s, a) of every state
+  ///
+  /// Throws std::invalid_argument if the sizes do not match.
+  ///
+  void updateBatch(const Eigen::Ref<const Eigen::MatrixXd>& states, const Eigen::Ref<const Eigen::VectorXi>& actions,
+                   const Eigen::Ref<const Eigen::VectorXd>& targets);
+
+  /// \return the ranges and widths of the basis, a checkpoint of another basis does not load
+  Eigen::MatrixXd layout() const { return m_basis.getLayout(); }
+
+  /// \return the basis of the Q-function
+  const RadialBasis& getBasis() const { return m_basis; }
+
+  /// \return the number of bytes of the weights and the centres
+  std::size_t memoryUsage() const
+  {
+    return sizeof(double) * (m_weights.size() + std::size_t(m_basis.getCentres()) * m_basis.getDimensions());
+  }
+
+protected:
+
+  friend class LinearQ<RadialBasisQ, RadialBasis::Features>;
+
+  ///
+  /// \brief saveSections Adds the scaled centres in the order of the weights
+  ///
+  void saveSections(CheckpointWriter& writer) const;
+
+  ///
+  /// \brief loadSections Restores the centres exactly, without scaling or sorting them again
+  ///
+  /// Throws std::runtime_error if there is not one centre per feature or they do not fit into the basis.
+  ///
+  void loadSections(const CheckpointReader& reader, const std::string& path, Eigen::Index features);
+
+private:
+
+  /// The basis, the weights of its centres are those of LinearQ
+  RadialBasis m_basis;
+
+public:
+
+  /// The default number of centres and the widths of the Gaussians along the positions and the ball velocity
+  static const int CENTRES = 32768;
+  static const double POSITION_WIDTH, VELOCITY_WIDTH;
+
+  /// Step size, discount and exploration
+  static const double ALPHA, GAMMA, EPSILON;
+
+  /// Trajectories per call to training() and their length
+  static const int TRAJECTORIES, STEPS;
+
+  /// The kind of agent in the checkpoints
+  static const char* const CHECKPOINT_KIND;
+};
+
+#endif // _RADIALBASISQ_H_
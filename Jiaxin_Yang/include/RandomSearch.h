@@ -1,8 +1,12 @@
 #ifndef _RANDOMSEARCH_H_
 #define _RANDOMSEARCH_H_
 
+#include <cstdint>
+#include <string>
+
 #include "BaseAgent.h"
-#include "HaxBall.h"
+#include "HaxBallField.h"
+#include "Philox.h"
 
 #include "Eigen/Dense"
 
@@ -14,7 +18,13 @@
 class RandomSearch : public BaseAgent
 {
 public:
-  RandomSearch();
+  ///
+  /// \brief RandomSearch Creates a new agent
+  /// \param seed The seed of all random numbers in the training, taken from the clock if not specified
+  ///
+  /// A training with the same seed produces the same policy, independent of the number of threads.
+  ///
+  explicit RandomSearch(std::uint64_t seed = Philox4x32::clockSeed());
   ~RandomSearch();
 
   /// A linear policy
@@ -26,6 +36,10 @@ public:
               const Eigen::Ref<const Eigen::VectorXd>& parameters,
               Eigen::Ref<Eigen::VectorXd> action) const;
 
+  /// The linear policy for many states as one matrix product A * S, followed by the clipping
+  void policyBatch(const Eigen::Ref<const Eigen::MatrixXd>& states,
+                   Eigen::Ref<Eigen::MatrixXd> actions) const override;
+
   /// Currently hardcoded to go to zero
   double reward(const Eigen::Ref<const Eigen::VectorXd>& s,
                 const Eigen::Ref<const Eigen::VectorXd>& action,
@@ -38,6 +52,12 @@ public:
   /// Currently the constant Q-values "42 ... 42"
   Eigen::VectorXd getQfactor(const Eigen::Ref<const Eigen::VectorXd>& state) const override;
 
+  /// The reward for many transitions, without a virtual call per transition
+  void rewardBatch(const Eigen::Ref<const Eigen::MatrixXd>& states,
+                   const Eigen::Ref<const Eigen::MatrixXd>& actions,
+                   const Eigen::Ref<const Eigen::MatrixXd>& states_prime,
+                   Eigen::Ref<Eigen::VectorXd> rewards) const override;
+
   ///
   /// \brief training
   ///
@@ -45,12 +65,27 @@ public:
   ///
   void training();
 
-private:
+  ///
+  /// \brief seed Restarts the random numbers of the training
+  /// \param seed The new seed, the next call to training() starts with the first iteration of this seed
+  ///
+  void seed(std::uint64_t seed);
+
+  ///
+  /// \brief save Writes the parameters, the covariance and the state of the training as checkpoint, atomically
+  ///
+  /// Throws std::runtime_error if the file cannot be written.
+  ///
+  void save(const std::string& path) const;
+
+  ///
+  /// \brief load Replaces the parameters, the covariance and the state of the training with a checkpoint written by save()
+  ///
+  /// Throws std::runtime_error if the file is no RandomSearch checkpoint or the sizes do not match.
+  ///
+  void load(const std::string& path);
 
-  /// A passive and private game instance for getting details about the game (e.g. the goal position for the reward computation)
-  /// Do not use this single instance for multithreaded training, as this would mess up its internal state
-  /// (That is the reason why this instance is constant)
-  const HaxBall m_world;
+private:
 
   /// The parameters to represent a linear policy, also the mean of the Gaussian used in CEM
   Eigen::VectorXd m_parameters;
@@ -58,6 +93,9 @@ private:
   /// The covariance matrix used to define the gaussian in Eigen
   Eigen::MatrixXd m_covariance;
 
+  /// The seed of the training and the number of iterations so far, each iteration derives its own random streams
+  std::uint64_t m_seed, m_iteration;
+
 public:
 
   /// Total number of particles for CEM
@@ -72,6 +110,9 @@ public:
   /// Discounting for rollouts
   static const double GAMMA;
 
+  /// The kind of agent in the checkpoints
+  static const char* const CHECKPOINT_KIND;
+
 };
 
 
@@ -0,0 +1,211 @@
+#ifndef _REPLAYBUFFER_H_
+#define _REPLAYBUFFER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Eigen/Dense"
+
+#include "HaxBallField.h"
+#include "Philox.h"
+
+///
+/// \brief The ReplayBuffer class stores transitions (s, a, r, s', done) for prioritized experience replay
+///
+/// The buffer has a fixed capacity and overwrites the oldest transitions once it is full. Every quantity is one array
+/// (structure of arrays): the states are the columns of one matrix, the same for the actions and the successor states,
+/// rewards and done flags are vectors. A sampled batch can be gathered into matrices and processed with the batch
+/// functions of the agents.
+///
+/// Sampling is proportional to a priority per transition, P(i) = p_i / sum p. The priorities live in a sum tree
+/// (a complete binary tree, every node holds the sum of its children), sampling and priority updates are O(log n).
+/// New transitions get the largest priority so far, hence every transition is sampled at least once with high
+/// probability. Learners update the priority with the TD error, p = (|delta| + PRIORITY_EPSILON)^alpha.
+///
+/// Concurrency: any number of actor threads can append() while learner threads sample(), gather() and
+/// updatePriority(), without locks. A slot is claimed with one atomic increment, an actor only waits if the actor
+/// a full buffer of appends earlier is still writing the same slot. All values are read and written with
+/// atomic operations and every slot has a sequence stamp (seqlock): a reader who meets a slot while it gets overwritten
+/// notices it and gets that transition with weight 0 instead of a torn one. The sums of the tree are updated with
+/// atomic additions, concurrent updates add up, only the order of the rounding differs. rebuild() recomputes all sums
+/// exactly, call it from one thread now and then.
+///
+/// sample() returns the stamp of every slot with it. gather() and updatePriority() take the stamps back and ignore
+/// a slot that was overwritten since it was sampled, the TD error of an old transition never sets the priority of
+/// the new one in its slot.
+///
+/// The buffer is standalone infrastructure, none of the learners uses it yet.
+///
+class ReplayBuffer
+{
+public:
+
+  /// Slots of sampled transitions
+  typedef Eigen::Matrix<std::int64_t, Eigen::Dynamic, 1> SlotVector;
+
+  /// The stamps of the slots when they were sampled, they identify the transitions
+  typedef Eigen::Matrix<std::uint64_t, Eigen::Dynamic, 1> StampVector;
+
+  ///
+  /// \brief ReplayBuffer Creates an empty buffer
+  /// \param capacity The number of transitions the buffer holds
+  /// \param alpha The exponent of the priorities, 0 samples uniformly
+  /// \param state_dimension The size of the state vectors
+  /// \param action_dimension The size of the action vectors
+  ///
+  /// Throws std::invalid_argument for a capacity of 0, alpha < 0 or dimensions < 1.
+  ///
+  explicit ReplayBuffer(std::size_t capacity, double alpha = 0.6,
+                        int state_dimension = HaxBallField::STATE_DIMENSION,
+                        int action_dimension = HaxBallField::ACTION_DIMENSION);
+
+  ReplayBuffer(const ReplayBuffer&) = delete;
+  ReplayBuffer& operator=(const ReplayBuffer&) = delete;
+
+  /// \return the number of transitions the buffer holds
+  std::size_t getCapacity() const { return m_capacity; }
+
+  /// \return the number of stored transitions, at most getCapacity()
+  std::size_t getSize() const;
+
+  /// \return the number of append() calls so far
+  std::uint64_t getAppended() const { return m_next.load(std::memory_order_relaxed); }
+
+  ///
+  /// \brief append Stores a transition, overwrites the oldest one if the buffer is full, lock free
+  /// \return the slot of the transition, getCapacity() if it was dropped
+  ///
+  /// A transition is dropped if a later append() claimed its slot first, it is older than everything in the buffer.
+  ///
+  std::size_t append(const Eigen::Ref<const Eigen::VectorXd>& state,
+                     const Eigen::Ref<const Eigen::VectorXd>& action,
+                     double reward,
+                     const Eigen::Ref<const Eigen::VectorXd>& state_prime,
+                     bool done);
+
+  ///
+  /// \brief sample Draws transitions proportional to their priorities, safe while other threads append or update
+  /// \param random_engine The random numbers, e.g. the private stream of the learner
+  /// \param beta The exponent of the importance sampling correction, 1 corrects fully
+  /// \param slots receives the slots of the transitions, one per row
+  /// \param stamps receives the stamps of the slots, pass them to gather() and updatePriority()
+  /// \param weights receives the importance sampling weights (getSize() * P(i))^-beta / max, the same size as slots
+  ///
+  /// Stratified: the total priority is split into slots.rows() equal parts and one transition is drawn from each.
+  /// Throws std::invalid_argument if the sizes do not match, std::logic_error if the buffer is empty.
+  ///
+  void sample(Philox4x32& random_engine, double beta, Eigen::Ref<SlotVector> slots, Eigen::Ref<StampVector> stamps,
+              Eigen::Ref<Eigen::VectorXd> weights) const;
+
+  ///
+  /// \brief gather Copies transitions into matrices, one column per slot, safe while other threads append
+  /// \param slots the slots from sample()
+  /// \param stamps the stamps from sample()
+  /// \param states receives the states, getStateDimension() x slots
+  /// \param actions receives the actions, getActionDimension() x slots
+  /// \param rewards receives the rewards
+  /// \param states_prime receives the successor states
+  /// \param dones receives 1 for a transition which ended an episode, 0 else
+  /// \param weights the weights of the transitions, set to 0 for transitions that were overwritten since sample()
+  /// \return the number of transitions that were overwritten since sample()
+  ///
+  /// Throws std::invalid_argument if the sizes do not match.
+  ///
+  std::size_t gather(const Eigen::Ref<const SlotVector>& slots,
+                     const Eigen::Ref<const StampVector>& stamps,
+                     Eigen::Ref<Eigen::MatrixXd> states,
+                     Eigen::Ref<Eigen::MatrixXd> actions,
+                     Eigen::Ref<Eigen::VectorXd> rewards,
+                     Eigen::Ref<Eigen::MatrixXd> states_prime,
+                     Eigen::Ref<Eigen::VectorXd> dones,
+                     Eigen::Ref<Eigen::VectorXd> weights) const;
+
+  ///
+  /// \brief updatePriority Sets the priority of a transition from its TD error, safe while other threads sample or append
+  /// \param slot the slot from sample()
+  /// \param stamp the stamp of the slot from sample()
+  /// \param td_error the TD error of the transition
+  /// \return false if the slot was overwritten since sample() and the update ignored
+  ///
+  /// An append that overwrites the slot while the priority is set restores the priority of new transitions.
+  ///
+  bool updatePriority(std::size_t slot, std::uint64_t stamp, double td_error);
+
+  /// \return the priority of a transition, 0 for an empty slot
+  double getPriority(std::size_t slot) const;
+
+  /// \return the sum of all priorities
+  double getTotalPriority() const;
+
+  ///
+  /// \brief rebuild Recomputes all sums of the tree from the priorities, removes the rounding of the atomic updates
+  ///
+  /// Not thread safe.
+  ///
+  void rebuild();
+
+  /// \return the size of the state vectors
+  int getStateDimension() const { return m_state_dimension; }
+
+  /// \return the size of the action vectors
+  int getActionDimension() const { return m_action_dimension; }
+
+  /// Added to the absolute TD error, such that no transition gets priority 0
+  static const double PRIORITY_EPSILON;
+
+private:
+
+  ///
+  /// \brief setPriority Sets a leaf of the tree and adds the difference to all its ancestors
+  ///
+  void setPriority(std::size_t slot, double priority);
+
+  ///
+  /// \brief find
+  /// \return the slot of the leaf where the prefix sum of the priorities exceeds the value
+  ///
+  std::size_t find(double value) const;
+
+  /// Atomic access to the values, plain loads and stores on common hardware
+  static double load(const double& value)
+  {
+    double v;
+#pragma omp atomic read
+    v = value;
+    return v;
+  }
+
+  static void store(double& value, double v)
+  {
+#pragma omp atomic write
+    value = v;
+  }
+
+private:
+
+  /// The capacity, the sizes of the vectors and the priority exponent
+  std::size_t m_capacity;
+  int m_state_dimension, m_action_dimension;
+  double m_alpha;
+
+  /// The number of append() calls, the next slot is this modulo the capacity
+  std::atomic<std::uint64_t> m_next;
+
+  /// Per slot: 0 if never written, odd while writing, even when the transition is complete
+  std::vector<std::atomic<std::uint64_t>> m_stamps;
+
+  /// The transitions, one column (entry) per slot
+  Eigen::MatrixXd m_states, m_actions, m_states_prime;
+  Eigen::VectorXd m_rewards, m_dones;
+
+  /// The number of leaves (a power of two >= capacity), the sum tree with the root at 1 and the leaves at m_leaves + slot
+  std::size_t m_leaves;
+  std::vector<double> m_tree;
+
+  /// The largest priority so far, the priority of new transitions
+  std::atomic<double> m_max_priority;
+};
+
+#endif // _REPLAYBUFFER_H_
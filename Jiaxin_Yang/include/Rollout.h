@@ -0,0 +1,130 @@
+#ifndef _ROLLOUT_H_
+#define _ROLLOUT_H_
+
+#include <stdexcept>
+
+#include "Eigen/Dense"
+
+#include "HaxBallBatch.h"
+#include "HaxBallCore.h"
+
+///
+/// Rollouts as a header only template, for use in the inner loops of training and evaluation.
+///
+/// Policy and reward are template parameters instead of virtual functions, hence the compiler sees the complete loop
+/// and can inline a linear policy or the reward functions of RewardFunctions.h into the step.
+/// Lambdas, function objects and plain functions work, as long as they can be called as
+///
+///     policy(state, action);                  // writes the action for the state
+///     double r = reward(state, action, state_prime);
+///
+/// with state and state_prime of type BasicHaxBallCore<Scalar>::State and action of type Rollout::Action<Scalar>.
+/// Both are fixed size vectors, which also bind to the Eigen::Ref arguments of BaseAgent and RewardFunctions.h.
+///
+namespace Rollout
+{
+  /// The action vector used in a rollout, fixed size: player velocity and shooting
+  template <typename Scalar>
+  using Action = Eigen::Matrix<Scalar, HaxBallField::ACTION_DIMENSION, 1>;
+
+  ///
+  /// \brief rollout Runs a policy from a start state and accumulates the discounted return
+  /// \param env The environment to use, its state gets overwritten (use one environment per thread)
+  /// \param start The start state
+  /// \param horizon The maximum number of steps
+  /// \param gamma The discount factor
+  /// \param policy The policy, see above
+  /// \param reward The reward function, see above
+  /// \param tolerance The rollout stops early once gamma^j drops below this value, zero runs the full horizon
+  /// \return the discounted return sum_j gamma^j r_j
+  ///
+  /// The discount is kept as a running product instead of calling std::pow(gamma, j) in every step.
+  /// With a tolerance the truncation error is at most tolerance * max|r| / (1 - gamma).
+  ///
+  template <typename Policy, typename Reward, typename Scalar>
+  double rollout(BasicHaxBallCore<Scalar>& env,
+                 const Eigen::Ref<const typename BasicHaxBallCore<Scalar>::Vector>& start,
+                 int horizon, double gamma,
+                 Policy&& policy, Reward&& reward,
+                 double tolerance = 0.0)
+  {
+    typename BasicHaxBallCore<Scalar>::StepInfo info;
+    typename BasicHaxBallCore<Scalar>::State state;
+    Action<Scalar> action;
+
+    env.setState(start);
+    state = env.getState();
+
+    double R = 0.0, discount = 1.0;
+
+    for (int j = 0; j < horizon and discount >= tolerance; ++j)
+    {
+      policy(state, action);
+
+      env.step(action, info);
+
+      R += discount * reward(state, action, info.state_prime);
+      discount *= gamma;
+
+      state = info.state_prime;
+    }
+
+    return R;
+  }
+
+  ///
+  /// \brief rolloutBatch Runs a policy from many start states at once and accumulates the discounted returns
+  /// \param envs The environments to use, one per start state, their states get overwritten
+  /// \param starts The start states, one per column
+  /// \param horizon The maximum number of steps
+  /// \param gamma The discount factor
+  /// \param policy The batched policy, called as policy(states, actions) with one column per environment
+  /// \param reward The batched reward, called as reward(states, actions, states_prime, rewards)
+  /// \param returns Receives the discounted return of every start state
+  /// \param tolerance The rollout stops early once gamma^j drops below this value, zero runs the full horizon
+  ///
+  /// The same returns as rollout() for every column, but the policy and the reward are called once per step for all
+  /// environments, e.g. BaseAgent::policyBatch() and BaseAgent::rewardBatch(). For an agent that is only known as
+  /// BaseAgent this is one virtual call per step instead of one per step and environment.
+  /// Throws std::invalid_argument if the number of start states or returns differs from the number of environments.
+  ///
+  template <typename PolicyBatch, typename RewardBatch>
+  void rolloutBatch(HaxBallBatch& envs,
+                    const Eigen::Ref<const Eigen::MatrixXd>& starts,
+                    int horizon, double gamma,
+                    PolicyBatch&& policy, RewardBatch&& reward,
+                    Eigen::Ref<Eigen::VectorXd> returns,
+                    double tolerance = 0.0)
+  {
+    if (starts.cols() != envs.size() or returns.size() != envs.size())
+      throw std::invalid_argument("Rollout::rolloutBatch needs one start state and one return per environment");
+
+    Eigen::MatrixXd
+        states(envs.getStateDimension(), envs.size()),
+        actions(envs.getActionDimension(), envs.size()),
+        states_prime(envs.getStateDimension(), envs.size());
+    Eigen::VectorXd rewards(envs.size());
+
+    envs.setStates(starts);
+    envs.getStates(states);
+    returns.setZero();
+
+    double discount = 1.0;
+
+    for (int j = 0; j < horizon and discount >= tolerance; ++j)
+    {
+      policy(states, actions);
+
+      envs.step(actions);
+      envs.getStates(states_prime);
+
+      reward(states, actions, states_prime, rewards);
+      returns += discount * rewards;
+      discount *= gamma;
+
+      states.swap(states_prime);
+    }
+  }
+}
+
+#endif // _ROLLOUT_H_
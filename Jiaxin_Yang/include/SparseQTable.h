@@ -0,0 +1,228 @@
+#ifndef _SPARSEQTABLE_H_
+#define _SPARSEQTABLE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CheckpointReader;
+class CheckpointWriter;
+
+///
+/// \brief The SparseQTable class stores Q-values only for the cells that were visited
+///
+/// Cells are identified by a 64 bit key, usually the cell index of a Discretizer. A fine grid over the full state
+/// has far more cells than fit into memory, but a training only ever visits a small fraction of them.
+/// The table is an open addressing hash map with linear probing, made of two flat arrays: the keys and,
+/// slot by slot, the Q-values of all actions. There is no allocation per cell.
+///
+/// A cell which was never inserted has the initial value for all actions. Reading never inserts,
+/// only insert() and the functions writing a value do. Like QTable, the Q-values of a slot start on a cache line
+/// and are padded to whole cache lines, which keeps maxValue() vectorised and a cell in its own lines.
+///
+/// Concurrent training (Hogwild): while the capacity is large enough, threads can share the table as long as
+/// they only use the atomic functions (insert(), atomicLoad(), atomicAdd(), bestActionAtomic(), maxValueAtomic()).
+/// A new cell claims its slot with one compare and swap on the key, the Q-values of every free slot already hold
+/// the initial value, hence a cell is complete the moment it is visible. reserve() and the growth of the table
+/// move the slots and are single threaded, call reserve() with the largest possible number of new cells before
+/// the threads start. insert() throws std::length_error if the table is full.
+///
+class SparseQTable
+{
+public:
+
+  /// The key of a free slot, never a valid cell index (the Discretizer uses at most 63 bits)
+  static const std::uint64_t EMPTY = ~std::uint64_t(0);
+
+  ///
+  /// \brief SparseQTable Creates an empty table
+  /// \param actions The number of actions per cell
+  /// \param capacity The number of cells the table can hold before it grows, at least 1
+  /// \param value The initial Q-value of every cell
+  ///
+  explicit SparseQTable(int actions, std::size_t capacity = 1024, double value = 0.0);
+
+  SparseQTable(const SparseQTable& other);
+  SparseQTable& operator=(const SparseQTable& other);
+
+  /// \return the number of actions per cell
+  int getActions() const { return m_actions; }
+
+  /// \return the number of cells in the table
+  std::size_t getSize() const { return m_size.load(std::memory_order_relaxed); }
+
+  /// \return the number of cells the table holds without growing
+  std::size_t getCapacity() const { return m_slots / LOAD_FACTOR; }
+
+  /// \return the initial Q-value of the cells
+  double getInitialValue() const { return m_value; }
+
+  ///
+  /// \brief memoryUsage
+  /// \return the number of bytes of the keys and the Q-values, the storage which grows with the table
+  ///
+  std::size_t memoryUsage() const;
+
+  ///
+  /// \brief find
+  /// \return the slot of a cell, -1 if the cell is not in the table
+  ///
+  std::ptrdiff_t find(std::uint64_t key) const;
+
+  ///
+  /// \brief insert Adds a cell with the initial Q-values, safe while other threads insert or update
+  /// \return the slot of the cell, the existing one if the cell is already in the table
+  ///
+  /// The table does not grow here, throws std::length_error if it already holds getCapacity() cells.
+  ///
+  std::ptrdiff_t insert(std::uint64_t key);
+
+  /// \return the key stored in a slot, EMPTY for a free slot
+  std::uint64_t key(std::size_t slot) const { return m_keys[slot].load(std::memory_order_acquire); }
+
+  /// \return the number of slots, for iterating over all of them with key() and values()
+  std::size_t getSlots() const { return m_slots; }
+
+  /// \return the contiguous Q-values of all actions of a slot
+  const double* values(std::size_t slot) const { return m_data.data()->q + slot * m_stride; }
+
+  /// \return the contiguous Q-values of all actions of a slot
+  double* values(std::size_t slot) { return m_data.data()->q + slot * m_stride; }
+
+  ///
+  /// \brief operator()
+  /// \return the Q-value of an action in a cell, the initial value if the cell is not in the table
+  ///
+  double operator()(std::uint64_t key, int action) const;
+
+  ///
+  /// \brief operator()
+  /// \return a reference to the Q-value of an action in a cell, the cell is inserted and the table grows if needed
+  ///
+  /// Not thread safe, use atomicAdd() while other threads access the table.
+  ///
+  double& operator()(std::uint64_t key, int action);
+
+  ///
+  /// \brief bestAction
+  /// \return the action with the largest Q-value in the cell, the first one if several are equal
+  ///
+  int bestAction(std::uint64_t key) const;
+
+  ///
+  /// \brief maxValue
+  /// \return the largest Q-value in the cell, i.e. the Q-value of bestAction()
+  ///
+  double maxValue(std::uint64_t key) const;
+
+  ///
+  /// \brief atomicLoad
+  /// \return the Q-value of an action in a cell, safe while other threads insert or update
+  ///
+  double atomicLoad(std::uint64_t key, int action) const;
+
+  ///
+  /// \brief atomicAdd Adds a value to a Q-value, the cell is inserted if needed, safe while other threads read or add
+  ///
+  void atomicAdd(std::uint64_t key, int action, double delta);
+
+  ///
+  /// \brief bestActionAtomic The same as bestAction(), safe while other threads insert or update
+  ///
+  int bestActionAtomic(std::uint64_t key) const;
+
+  ///
+  /// \brief maxValueAtomic The same as maxValue(), safe while other threads insert or update
+  ///
+  double maxValueAtomic(std::uint64_t key) const;
+
+  ///
+  /// \brief reserve Grows the table, such that it holds at least this many cells without growing again
+  ///
+  /// Not thread safe, the slots move.
+  ///
+  void reserve(std::size_t cells);
+
+  ///
+  /// \brief clear Removes all cells, the capacity stays
+  ///
+  void clear();
+
+  ///
+  /// \brief sum
+  /// \return the sum of all Q-values of the cells in the table
+  ///
+  double sum() const;
+
+  ///
+  /// \brief save Adds the table as sections "<name>.meta", "<name>.keys" and "<name>.values" to a checkpoint
+  ///
+  /// The slots are stored as they are, the table must stay unchanged until the checkpoint is written.
+  ///
+  void save(CheckpointWriter& writer, const std::string& name) const;
+
+  ///
+  /// \brief load Replaces the table with the one stored by save(), the slots are copied without rehashing
+  ///
+  /// Throws std::runtime_error if the sections are missing or inconsistent.
+  ///
+  void load(const CheckpointReader& reader, const std::string& name);
+
+private:
+
+  /// The shape of the table in a checkpoint
+  struct Meta
+  {
+    std::int64_t actions, stride, slots, size;
+    double value;
+  };
+
+  ///
+  /// \brief home
+  /// \return the first slot to probe for a key (Fibonacci hashing, the Morton codes of neighbours differ in the low bits)
+  ///
+  std::size_t home(std::uint64_t key) const { return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ull) >> m_shift); }
+
+  ///
+  /// \brief allocate Creates free slots for this many cells, the old content is lost
+  ///
+  void allocate(std::size_t cells);
+
+private:
+
+  /// The size of a cache line in doubles
+  static const int LINE = 8;
+
+  /// The table holds at most one cell per LOAD_FACTOR slots, short probe sequences
+  static const std::size_t LOAD_FACTOR = 2;
+
+  /// One cache line, the vector of these gives the alignment of the Q-values
+  struct alignas(LINE * sizeof(double)) Line
+  {
+    double q[LINE];
+  };
+
+  /// The number of actions and the initial Q-value
+  int m_actions;
+  double m_value;
+
+  /// The distance between two slots in doubles, the number of actions rounded up to whole cache lines
+  int m_stride;
+
+  /// The number of slots (a power of two) and the shift of the hash to the slot bits
+  std::size_t m_slots;
+  int m_shift;
+
+  /// The number of cells in the table
+  std::atomic<std::size_t> m_size;
+
+  /// The key of every slot, EMPTY if free
+  std::vector<std::atomic<std::uint64_t>> m_keys;
+
+  /// The Q-values of every slot one after another, free slots hold the initial value
+  std::vector<Line> m_data;
+};
+
+#endif // _SPARSEQTABLE_H_
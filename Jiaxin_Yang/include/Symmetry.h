@@ -0,0 +1,69 @@
+#ifndef _SYMMETRY_H_
+#define _SYMMETRY_H_
+
+#include <cstdint>
+
+#include "Eigen/Dense"
+
+#include "Discretizer.h"
+#include "HaxBallField.h"
+
+///
+/// The mirror symmetry of HaxBall about the x-axis, header only.
+///
+/// The field, both goals and the circle of the goalkeeper are centred on y = 0, and the goalkeeper follows the player
+/// along the ray from the goal center. Flipping the sign of every y component (player y, ball y, ball velocity y)
+/// and of the y velocity of the action maps a transition onto another valid transition with the same reward.
+/// A table needs to store only one of two mirrored cells, the canonical one: canonicalIndex() returns the smaller
+/// of the two cell indices and whether the state was mirrored to get it. An agent looks up and updates the canonical
+/// cell with the mirrored action, both halves of the field then learn from every transition, and a symmetric grid
+/// (lower bounds -upper bounds on the y components) visits about half the cells.
+///
+/// Cells on the axis are their own mirror images and stay as they are.
+///
+namespace Symmetry
+{
+  ///
+  /// \brief mirrorState Flips the y components of a state
+  /// \param state The state
+  /// \param mirrored receives the mirror image, may not be the same vector as the state
+  ///
+  inline void mirrorState(const Eigen::Ref<const Eigen::VectorXd>& state, Eigen::Ref<Eigen::VectorXd> mirrored)
+  {
+    mirrored << state(0), -state(1), state(2), -state(3), state(4), -state(5);
+  }
+
+  ///
+  /// \brief mirrorAction
+  /// \return the discrete action of Action::action_map() with the y velocity flipped, north <-> south
+  ///
+  inline int mirrorAction(int action)
+  {
+    // No op, shoot, N, NW, W, SW, S, SE, E, NE, each without and with shooting
+    static const int MIRRORED[18] = { 0, 1, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 16, 17, 14, 15, 12, 13 };
+
+    return MIRRORED[action];
+  }
+
+  ///
+  /// \brief canonicalIndex
+  /// \param discretizer The grid, symmetric about the x-axis
+  /// \param mirrored receives whether the cell is the one of the mirror image of the state
+  /// \return the smaller of the cell indices of the state and of its mirror image
+  ///
+  inline std::uint64_t canonicalIndex(const Discretizer& discretizer, const Eigen::Ref<const Eigen::VectorXd>& state,
+                                      bool& mirrored)
+  {
+    Eigen::Matrix<double, HaxBallField::STATE_DIMENSION, 1> image;
+
+    mirrorState(state, image);
+
+    const std::uint64_t cell = discretizer.index(state), cell_image = discretizer.index(image);
+
+    mirrored = cell_image < cell;
+
+    return mirrored ? cell_image : cell;
+  }
+}
+
+#endif // _SYMMETRY_H_
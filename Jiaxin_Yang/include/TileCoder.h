@@ -0,0 +1,115 @@
+#ifndef _TILECODER_H_
+#define _TILECODER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "Eigen/Dense"
+
+#include "HaxBallField.h"
+
+///
+/// \brief The TileCoder class maps continuous states to the active tiles of several offset tilings
+///
+/// Every tiling is a grid over the chosen state components with one tile width per component. The tilings are shifted
+/// against each other by fractions of a tile, tiling t moves component d by t * (2d + 1) / tilings tile widths
+/// (asymmetric displacements, the tilings do not line up along the diagonal). A state activates exactly one tile
+/// per tiling, hence a linear function over the tiles is a sum of getTilings() weights.
+///
+/// The tiles of all tilings are hashed into a table of fixed size (getSize(), a power of two). The memory does not
+/// depend on the number of components or the widths, distant tiles can share a row of the table.
+/// Values outside of the range of a component are clipped.
+///
+class TileCoder
+{
+public:
+
+  /// The active tiles of many states, one column per state
+  typedef Eigen::MatrixXi TileMatrix;
+
+  ///
+  /// \brief TileCoder Creates a tile coder without components, add them with addDimension()
+  /// \param tilings The number of tilings, the number of active tiles per state
+  /// \param size_bits The table has 2^size_bits rows
+  /// \param state_dimension The size of the state vectors
+  ///
+  /// Throws std::invalid_argument for less than one tiling or a table size outside of [2, 2^30].
+  ///
+  TileCoder(int tilings, int size_bits, int state_dimension = HaxBallField::STATE_DIMENSION);
+
+  ///
+  /// \brief addDimension Adds a state component to the tilings
+  /// \param component The index in the state vector
+  /// \param low The smallest value, smaller values are clipped
+  /// \param high The largest value, larger values are clipped
+  /// \param width The width of a tile along this component
+  /// \return the number of the new dimension
+  ///
+  /// Throws std::invalid_argument for an invalid component, an empty range, a width <= 0 or too many tiles.
+  ///
+  int addDimension(int component, double low, double high, double width);
+
+  /// \return the number of tilings
+  int getTilings() const { return m_tilings; }
+
+  /// \return the number of rows of the table, one more than the largest tile index
+  int getSize() const { return 1 << m_size_bits; }
+
+  /// \return the number of dimensions of the tilings
+  int getDimensions() const { return static_cast<int>(m_dimensions.size()); }
+
+  /// \return one column per dimension: the state component, the low and high end of its range and the tile width
+  Eigen::MatrixXd getLayout() const;
+
+  ///
+  /// \brief activeTiles
+  /// \param state a continuous state
+  /// \param tiles receives the tile index of every tiling, getTilings() rows
+  ///
+  void activeTiles(const Eigen::Ref<const Eigen::VectorXd>& state, Eigen::Ref<Eigen::VectorXi> tiles) const;
+
+  ///
+  /// \brief activeTilesBatch
+  /// \param states many continuous states, one per column
+  /// \param tiles receives the active tiles, one column per state, getTilings() rows
+  ///
+  /// Clipping, the tile coordinates and the hashing run component by component over all states, which vectorises.
+  /// The same result as activeTiles() for every column. Throws std::invalid_argument if the sizes do not match.
+  ///
+  void activeTilesBatch(const Eigen::Ref<const Eigen::MatrixXd>& states, Eigen::Ref<TileMatrix> tiles) const;
+
+private:
+
+  /// \return the row of the table for the tile with this number
+  int hash(std::uint64_t tile) const { return static_cast<int>((tile * 0x9E3779B97F4A7C15ull) >> (64 - m_size_bits)); }
+
+private:
+
+  /// Everything the tile computation needs about one component
+  struct Dimension
+  {
+    /// The state component, its range and the inverse tile width
+    int component;
+    double low, high, inverse;
+
+    /// The number of tiles along the component (one more than the range needs, for the shifts)
+    std::int64_t tiles;
+
+    /// The distance of two neighbouring tiles in the numbering of a tiling
+    std::int64_t stride;
+  };
+
+  /// The number of tilings, the table size and the size of the state vectors
+  int m_tilings, m_size_bits, m_state_dimension;
+
+  /// The dimensions of the tilings
+  std::vector<Dimension> m_dimensions;
+
+  /// The number of tiles of one tiling
+  std::int64_t m_tiles_per_tiling;
+
+  /// The largest number of tiles of all tilings together
+  static const std::int64_t MAX_TILES = std::int64_t(1) << 62;
+};
+
+#endif // _TILECODER_H_
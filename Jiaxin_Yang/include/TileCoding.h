@@ -0,0 +1,98 @@
+#ifndef _TILECODING_H_
+#define _TILECODING_H_
+
+#include <cstdint>
+
+#include "HaxBallField.h"
+#include "LinearQ.h"
+#include "Philox.h"
+#include "TileCoder.h"
+
+#include "Eigen/Dense"
+
+///
+/// \brief The TileCoding class is a Q-learning agent with a linear Q-function over tile coded states
+///
+/// The state goes through a TileCoder (several offset tilings over all six state components, hashed into a table of
+/// fixed size). Every row of the table holds one weight per discrete action of Action::action_map(),
+/// Q(s, a) is the sum of the weights of the active tiles. Neighbouring states share tiles, hence an update generalises,
+/// while the offset tilings still resolve finer than a single grid of the same tile width.
+///
+/// The Q-values of all actions are the sum of getTilings() fixed size columns of LinearQ, which compiles to a few
+/// SIMD additions. An update touches getTilings() weights, independent of the size of the state space. The whole
+/// table has a fixed size of a few megabytes.
+///
+class TileCoding : public LinearQ<TileCoding, TileCoder::TileMatrix>
+{
+public:
+
+  ///
+  /// \brief TileCoding Creates a new agent with all weights 0
+  /// \param seed The seed of the start states and of the exploration, taken from the clock if not specified
+  ///
+  explicit TileCoding(std::uint64_t seed = Philox4x32::clockSeed());
+  ~TileCoding();
+
+  ///
+  /// \brief activate
+  /// \param state a continuous state
+  /// \param tiles receives the active tiles of the state, one column
+  ///
+  void activate(const Eigen::Ref<const Eigen::VectorXd>& state, Features& tiles) const;
+
+  ///
+  /// \brief activateBatch
+  /// \param states many continuous states, one per column
+  /// \param tiles receives the active tiles, one column per state
+  ///
+  void activateBatch(const Eigen::Ref<const Eigen::MatrixXd>& states, Features& tiles) const;
+
+  ///
+  /// \brief actionValues
+  /// \param tiles the active tiles of one or more states
+  /// \param k the number of the state in the tiles
+  /// \return the Q-values of all actions, the padding is undefined
+  ///
+  ActionValues actionValues(const Features& tiles, int k = 0) const;
+
+  ///
+  /// \brief actionValuesAtomic The same as actionValues(), safe while other threads update
+  ///
+  ActionValues actionValuesAtomic(const Features& tiles, int k = 0) const;
+
+  ///
+  /// \brief update Moves Q(s, a) towards a target, safe while other threads update
+  /// \param tiles the active tiles of s
+  /// \param k the number of s in the tiles
+  /// \param action the discrete action
+  /// \param target the new estimate of Q(s, a)
+  ///
+  void update(const Features& tiles, int k, int action, double target);
+
+  /// \return the ranges and tile widths of the tile coder
+  Eigen::MatrixXd layout() const { return m_coder.getLayout(); }
+
+  /// \return the tile coder of the Q-function
+  const TileCoder& getTileCoder() const { return m_coder; }
+
+private:
+
+  /// The active tiles of the Q-function
+  TileCoder m_coder;
+
+public:
+
+  /// The number of tilings and the table has 2^SIZE_BITS tiles
+  static const int TILINGS, SIZE_BITS;
+
+  /// Step size (divided by the number of tilings), discount and exploration
+  static const double ALPHA, GAMMA, EPSILON;
+
+  /// Trajectories per call to training() and their length
+  static const int TRAJECTORIES, STEPS;
+
+  /// The kind of agent in the checkpoints
+  static const char* const CHECKPOINT_KIND;
+};
+
+#endif // _TILECODING_H_
@@ -0,0 +1,88 @@
+#ifndef _TRAJECTORY_H_
+#define _TRAJECTORY_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "Eigen/Dense"
+
+///
+/// \brief The Trajectory class records the rewards of an episode and computes the learning targets of all steps
+///
+/// A learner which updates step by step reads the table for every target and computes each discount anew. Recorded
+/// per episode, the targets of all steps follow from one backward pass over the rewards: step t stores the reward
+/// r_t, the estimate V(s_t+1) of the successor (max_a Q(s_t+1, a) for Q-learning, read once when the step is taken)
+/// and whether the step ended the episode. compute() then gives for every step
+///
+///  - the discounted return G_t = r_t + gamma * G_t+1, Monte Carlo up to the end of the episode,
+///  - the n-step target r_t + ... + gamma^(n-1) r_t+n-1 + gamma^n V(s_t+n),
+///  - the lambda-return r_t + gamma * ((1 - lambda) V(s_t+1) + lambda * G^lambda_t+1).
+///
+/// A terminal step (a goal) ends the sums, nothing is bootstrapped across it, and the next step starts a new episode.
+/// A trajectory which stops without a terminal step is truncated, its last step bootstraps from V(s_T) in all three.
+/// The return and the lambda-return are recurrences, the n-step targets are the difference of two returns,
+/// G_t - gamma^n G_t+n + gamma^n V(s_t+n), computed with vector operations where no episode ends within n steps.
+///
+/// The targets are the on-policy ones, no importance weights and no cut at exploratory actions.
+///
+class Trajectory
+{
+public:
+
+  ///
+  /// \brief Trajectory Creates an empty trajectory
+  /// \param capacity The number of steps to reserve memory for
+  ///
+  explicit Trajectory(std::size_t capacity = 0);
+
+  ///
+  /// \brief append Records a step
+  /// \param reward The reward r_t
+  /// \param value_prime The estimate V(s_t+1) of the successor, ignored for a terminal step
+  /// \param terminal Whether the step ended the episode
+  ///
+  void append(double reward, double value_prime, bool terminal)
+  {
+    m_rewards.push_back(reward);
+    m_values.push_back(terminal ? 0.0 : value_prime);
+    m_continues.push_back(terminal ? 0.0 : 1.0);
+  }
+
+  /// Removes all steps and targets, the memory stays
+  void clear();
+
+  /// \return the number of steps
+  std::size_t getSize() const { return m_rewards.size(); }
+
+  ///
+  /// \brief compute Computes the three targets of all steps
+  /// \param gamma The discount in [0, 1]
+  /// \param n The number of rewards of the n-step targets, at least 1
+  /// \param lambda The weight of the lambda-returns in [0, 1], 0 gives the one-step targets and 1 the returns
+  ///
+  /// Throws std::invalid_argument if a parameter is out of its range.
+  ///
+  void compute(double gamma, int n, double lambda);
+
+  /// \return the discounted returns of the last compute(), one per step
+  const Eigen::ArrayXd& getReturns() const { return m_returns; }
+
+  /// \return the n-step targets of the last compute()
+  const Eigen::ArrayXd& getNStepTargets() const { return m_n_step; }
+
+  /// \return the lambda-returns of the last compute()
+  const Eigen::ArrayXd& getLambdaReturns() const { return m_lambda_returns; }
+
+private:
+
+  /// Per step the reward, V(s_t+1) (0 if terminal) and 0 for a terminal step, 1 otherwise
+  std::vector<double> m_rewards, m_values, m_continues;
+
+  /// The targets of the last compute()
+  Eigen::ArrayXd m_returns, m_n_step, m_lambda_returns;
+
+  /// Per step the number of steps to the last step of its episode
+  Eigen::ArrayXi m_remaining;
+};
+
+#endif // _TRAJECTORY_H_
@@ -0,0 +1,215 @@
+#ifndef _VALUEITERATION_H_
+#define _VALUEITERATION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "BaseAgent.h"
+#include "Discretizer.h"
+#include "Philox.h"
+
+#include "Eigen/Dense"
+
+///
+/// \brief The ValueIteration class plans on a discretized model of HaxBall instead of learning from trajectories
+///
+/// A Discretizer puts a grid over all six state components. buildModel() uses the simulation as generative model:
+/// for every cell and every discrete action of Action::action_map() it steps from the grid point (and, with more
+/// than one sample, from random points within the cell) and records the successor cells, their probabilities and
+/// the expected reward. A step which scores a goal is terminal and has no successor. The environment has no
+/// opponent here, its position is not part of the state and the model would not be a function of the state.
+///
+/// The model is compact and sparse (compressed rows): cells are numbered in Morton order of the Discretizer, the
+/// successors of (cell, action) are a contiguous range of cell numbers and probabilities, the successors of
+/// neighbouring cells are neighbours in memory as well.
+///
+/// solve() runs value iteration V(s) = max_a r(s, a) + GAMMA * sum_s' p(s' | s, a) V(s') over all cells in parallel,
+/// either Jacobi (all cells from the values of the last sweep, reproducible) or Gauss-Seidel: every thread sweeps
+/// its own contiguous shard of cells in place and sees the new values of its shard at once, the values of the
+/// other shards with atomic reads, the result differs in the last digits between runs. A step moves the player by a
+/// fraction of a cell, most of the probability stays in the own cell, hence both need about the same number of sweeps.
+///
+/// The grid point alone is a poor sample: from the center of a cell a step rarely leaves it and the model would
+/// hardly move. Several samples spread over the cell give the probabilities to drift into the neighbours.
+///
+/// The policy is a table of the greedy action per cell, policy() is a cell lookup.
+///
+/// The grid is symmetric about the x-axis. With the symmetry (Symmetry.h) the model holds only the canonical one of
+/// two mirrored cells, about half of them: the successors are canonical cells, since mirrored cells have the same
+/// value, and the greedy action of a mirrored state is the mirror image of the action of its canonical cell.
+/// Both cells of a pair share the samples of one, for the time of the full model it affords twice the samples.
+///
+class ValueIteration : public BaseAgent
+{
+public:
+
+  /// The update of the values
+  enum Sweep { JACOBI, GAUSS_SEIDEL };
+
+  ///
+  /// \brief ValueIteration Creates the grid, the model is built by buildModel() or the first solve()
+  /// \param position_resolution The cell size of the player and ball positions
+  /// \param velocity_resolution The cell size of the ball velocity
+  /// \param samples The number of sampled steps per cell and action, the first from the grid point
+  /// \param seed The seed of the sample points within the cells
+  /// \param symmetric Models only one of two cells which are mirror images about the x-axis, see Symmetry.h
+  ///
+  /// Throws std::invalid_argument if samples < 1 or the grid has more than 2^32 - 1 cells.
+  ///
+  explicit ValueIteration(double position_resolution = 1.0, double velocity_resolution = 2.0,
+                          int samples = 8, std::uint64_t seed = Philox4x32::clockSeed(), bool symmetric = false);
+  ~ValueIteration();
+
+  /// The greedy action of the cell of the state
+  void policy(const Eigen::Ref<const Eigen::VectorXd>& state,
+              Eigen::Ref<Eigen::VectorXd> action) const override;
+
+  /// Player ball distance and the goals, the reward of the model
+  double reward(const Eigen::Ref<const Eigen::VectorXd>& s,
+                const Eigen::Ref<const Eigen::VectorXd>& action,
+                const Eigen::Ref<const Eigen::VectorXd>& s_prime) const override;
+
+  /// The Q-value of the nearest discrete action, from the model and the values
+  double getQfactor(const Eigen::Ref<const Eigen::VectorXd>& state,
+                    const Eigen::Ref<const Eigen::VectorXd>& action) const override;
+
+  /// The Q-values of the ACTIONS discrete actions, from the model and the values
+  Eigen::VectorXd getQfactor(const Eigen::Ref<const Eigen::VectorXd>& state) const override;
+
+  ///
+  /// \brief buildModel Samples the transitions of all cells and actions, in parallel
+  ///
+  void buildModel();
+
+  ///
+  /// \brief solve Runs value iteration until the largest change of a value is below the tolerance
+  /// \param tolerance The largest change of a value in the last sweep
+  /// \param max_sweeps Stops after this number of sweeps anyway
+  /// \param sweep Jacobi or Gauss-Seidel
+  /// \return the number of sweeps
+  ///
+  /// Builds the model first if necessary. Starts from the values of the last call, a solve() with a different
+  /// tolerance continues where the last one stopped.
+  ///
+  int solve(double tolerance = 1e-6, int max_sweeps = 10000, Sweep sweep = JACOBI);
+
+  /// \return the largest change of a value in the last sweep
+  double getResidual() const { return m_residual; }
+
+  /// \return the value of the cell of the state
+  double getValue(const Eigen::Ref<const Eigen::VectorXd>& state) const;
+
+  /// \return the grid of the model
+  const Discretizer& getDiscretizer() const { return m_discretizer; }
+
+  /// \return the number of cells, only the canonical ones if symmetric
+  std::size_t getCells() const { return m_cells.size(); }
+
+  /// \return whether mirrored cells share one cell of the model
+  bool isSymmetric() const { return m_symmetric; }
+
+  /// \return the number of stored transitions (cell, action, successor)
+  std::size_t getTransitions() const { return m_successors.size(); }
+
+  /// \return true after buildModel()
+  bool hasModel() const { return not m_offsets.empty(); }
+
+  /// \return the number of bytes of the model, the values and the policy
+  std::size_t memoryUsage() const;
+
+  ///
+  /// \brief updateRewards Recomputes the expected rewards of the model with the current reward()
+  /// \return the numbers of the cells where the reward of at least one action changed
+  ///
+  /// For subclasses with a configurable reward. Steps from the same points as buildModel(), the successors stay.
+  /// The values and the policy are not updated, call solve() afterwards.
+  ///
+  std::vector<std::uint32_t> updateRewards();
+
+  /// The number of discrete actions, see Action::action_map()
+  static const int ACTIONS = 18;
+
+  /// The cell number of the successor of a terminal step
+  static const std::uint32_t TERMINAL = ~std::uint32_t(0);
+
+  /// The discount
+  static const double GAMMA;
+
+protected:
+
+  ///
+  /// \brief cellOf
+  /// \param mirrored receives whether the cell is the one of the mirror image of the state, its actions are mirrored
+  /// \return the number of the cell of a state, the canonical one if symmetric
+  ///
+  std::uint32_t cellOf(const Eigen::Ref<const Eigen::VectorXd>& state, bool& mirrored) const;
+
+  ///
+  /// \brief actionValue
+  /// \return r(s, a) + GAMMA * sum p(s' | s, a) V(s') for the cell number and the action
+  ///
+  template <bool atomic>
+  double actionValue(std::uint32_t cell, int action, const std::vector<double>& values) const;
+
+  ///
+  /// \brief greedy
+  /// \param best_action receives the action with the largest Q-value, the first one if several are equal
+  /// \return max_a of actionValue() of the cell with the current values
+  ///
+  template <bool atomic>
+  double greedy(std::uint32_t cell, int& best_action) const;
+
+  ///
+  /// \brief greedyFixedPoint The value of the cell if the values of all other cells were final, safe while other threads write values
+  /// \param best_action receives the maximising action
+  ///
+  /// The transitions back into the cell make V(s) = max_a c_a + k_a V(s), with k_a = GAMMA * p(s | s, a) < 1.
+  /// The fixed point is max_a c_a / (1 - k_a), one backup does what the self loop would take many backups for.
+  /// Values are read atomically.
+  ///
+  double greedyFixedPoint(std::uint32_t cell, int& best_action) const;
+
+  ///
+  /// \brief sampleState
+  /// \param center the grid point of the cell
+  /// \param state receives the start state of a sample, the grid point for sample 0
+  ///
+  void sampleState(std::uint32_t cell, int action, int sample, const Eigen::VectorXd& center,
+                   Eigen::Ref<Eigen::VectorXd> state) const;
+
+  /// One sweep over all cells, returns the largest change of a value
+  double sweepJacobi();
+  double sweepGaussSeidel();
+
+protected:
+
+  /// The grid, the cell size of every state component and the samples per cell and action
+  Discretizer m_discretizer;
+  std::vector<double> m_resolution;
+  int m_samples;
+  std::uint64_t m_seed;
+
+  /// Whether only the canonical one of two mirrored cells is in the model
+  bool m_symmetric;
+
+  /// The Morton index of every cell (canonical if symmetric), sorted, the position is the cell number
+  std::vector<std::uint64_t> m_cells;
+
+  /// The model: the successors of (cell, action) are [m_offsets[cell * ACTIONS + action], m_offsets[... + 1])
+  std::vector<std::uint64_t> m_offsets;
+  std::vector<std::uint32_t> m_successors;
+  std::vector<float> m_probabilities;
+
+  /// The expected reward of (cell, action)
+  std::vector<float> m_rewards;
+
+  /// The values of the cells, the buffer of the Jacobi sweeps and the greedy action per cell
+  std::vector<double> m_values, m_next_values;
+  std::vector<std::uint8_t> m_policy;
+
+  /// The largest change of a value in the last sweep
+  double m_residual;
+};
+
+#endif // _VALUEITERATION_H_
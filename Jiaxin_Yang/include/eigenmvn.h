@@ -11,6 +11,10 @@
  * - fixed Cholesky by using LLT decomposition instead of LDLT that was not yielding
  *   a correctly rotated variance 
  *   (see this http://stats.stackexchange.com/questions/48749/how-to-sample-from-a-multivariate-normal-given-the-pt-ldlt-p-decomposition-o )
+ *
+ * Local modification for HaxBall:
+ * - the static std::mt19937 shared by all instances is replaced by a counter based
+ *   Philox generator per instance (seed, stream), sampling is thread safe and reproducible.
  */
 
 /**
@@ -34,36 +38,36 @@
 #define __EIGENMULTIVARIATENORMAL_HPP
 
 #include <Eigen/Dense>
-#include <random>
+#include <cstdint>
+
+#include "Philox.h"
 
 /*
-  We need a functor that can pretend it's const,
-  but to be a good random number generator 
-  it needs mutable state.  The standard Eigen function 
-  Random() just calls rand(), which changes a global
-  variable.
+  The functor is const and has no mutable state: with a counter
+  based generator each coefficient is a pure function of
+  (seed, stream, offset + position in the matrix).
+  Hence it does not matter in which order or on which thread
+  Eigen evaluates the coefficients.
 */
 namespace Eigen {
   namespace internal {
     template<typename Scalar>
       struct scalar_normal_dist_op
       {
-	static std::mt19937 rng;                        // The uniform pseudo-random algorithm
-	mutable std::normal_distribution<Scalar> norm; // gaussian combinator
-	
-	EIGEN_EMPTY_STRUCT_CTOR(scalar_normal_dist_op)
+	uint64_t key = 0;       // The seed of the generator
+	uint64_t stream = 0;    // The stream of the generator
+	uint64_t offset = 0;    // Number of normals drawn before the current matrix
+	uint64_t rows = 1;      // Rows of the current matrix, to linearise the position
 
 	template<typename Index>
-	inline const Scalar operator() (Index, Index = 0) const { return norm(rng); }
-	inline void seed(const uint64_t &s) { rng.seed(s); }
+	inline const Scalar operator() (Index i, Index j = 0) const
+	{ return Scalar(Philox4x32::normalAt(key, stream, offset + uint64_t(j) * rows + uint64_t(i))); }
+	inline void seed(const uint64_t &s, const uint64_t &st = 0) { key = s; stream = st; offset = 0; }
       };
 
-    template<typename Scalar>
-      std::mt19937 scalar_normal_dist_op<Scalar>::rng;
-      
     template<typename Scalar>
       struct functor_traits<scalar_normal_dist_op<Scalar> >
-      { enum { Cost = 50 * NumTraits<Scalar>::MulCost, PacketAccess = false, IsRepeatable = false }; };
+      { enum { Cost = 50 * NumTraits<Scalar>::MulCost, PacketAccess = false, IsRepeatable = true }; };
 
   } // end namespace internal
 
@@ -83,14 +87,17 @@ namespace Eigen {
     
   public:
   EigenMultivariateNormal(const Matrix<Scalar,Dynamic,1>& mean,const Matrix<Scalar,Dynamic,Dynamic>& covar,
-			  const bool use_cholesky=false,const uint64_t &seed=std::mt19937::default_seed)
+			  const bool use_cholesky=false,const uint64_t &seed=Philox4x32::clockSeed(),const uint64_t &stream=0)
       :_use_cholesky(use_cholesky)
      {
-        randN.seed(seed);
+        randN.seed(seed, stream);
 	setMean(mean);
 	setCovar(covar);
       }
 
+    /// Restart the random numbers, the same seed and stream produce the same samples
+    void seed(const uint64_t &seed, const uint64_t &stream=0) { randN.seed(seed, stream); }
+
     void setMean(const Matrix<Scalar,Dynamic,1>& mean) { _mean = mean; }
     void setCovar(const Matrix<Scalar,Dynamic,Dynamic>& covar)
     {
@@ -128,7 +135,10 @@ namespace Eigen {
     /// as columns in a Dynamic by nn matrix
     Matrix<Scalar,Dynamic,-1> samples(int nn)
       {
-	return (_transform * Matrix<Scalar,Dynamic,-1>::NullaryExpr(_covar.rows(),nn,randN)).colwise() + _mean;
+	randN.rows = _covar.rows();
+	const Matrix<Scalar,Dynamic,-1> normals = Matrix<Scalar,Dynamic,-1>::NullaryExpr(_covar.rows(),nn,randN);
+	randN.offset += uint64_t(_covar.rows()) * nn;
+	return (_transform * normals).colwise() + _mean;
       }
   }; // end class EigenMultivariateNormal
 } // end namespace Eigen
@@ -8,6 +8,7 @@
 #include "EvaluationCenter.h"
 #include "RandomSearch.h"
 #include "DummyAgent.h"
+#include "Checkpoint.h"
 
 
 void playing(const BaseAgent& agent, int argc, char** argv)
@@ -32,6 +33,12 @@ int main(int argc, char** argv)
 {
   std::cout << "Hello Group Group-2!" << std::endl;
   QLearning agent;
+
+  // Continue the training of the last run, HaxBallViewer shows the checkpoint without training
+  const std::string checkpoint = "qlearning.ckpt";
+
+  if (CheckpointReader::exists(checkpoint))
+    agent.load(checkpoint);
   // Use the dummy agent to compile the code (= minimal working example)
   // DummyAgent agent;
   // playing(agent, argc, argv);
@@ -47,6 +54,9 @@ int main(int argc, char** argv)
   // Results in a .csv files next to the executable
   EvaluationCenter eval(agent, RandomSearch::GAMMA);
 
+  // Divergence between the float and the double simulation on the probes, results in precision.csv
+  // eval.precisionReport();
+
   // This could be a learning loop, extend it as required and make sure, that your
   // agent stores everything on the disk
   // The code below is only a proposal and demonstration, do whatever you need!
@@ -55,6 +65,7 @@ int main(int argc, char** argv)
     std::cout << i << std::endl;
 
     agent.training();
+    agent.save(checkpoint);
     //printf("--------------------training %d one-----------------------", i);
     
     if(i % 3 == 1)
@@ -0,0 +1,100 @@
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+#include "HaxBallCore.h"
+#include "QLambda.h"
+
+namespace
+{
+  /// The seed of the training, the same for all values of lambda
+  const std::uint64_t SEED = 42;
+
+  /// The fixed episodes of the greedy return: start states from this seed, stream i for episode i
+  const std::uint64_t EVALUATION_SEED = 12345;
+  const int EPISODES = 200, HORIZON = 200;
+
+  ///
+  /// \brief greedyReturn
+  /// \return the discounted return of the greedy policy with the training reward, averaged over the fixed episodes
+  ///
+  double greedyReturn(QLambda& agent)
+  {
+    Eigen::VectorXd state(HaxBallField::STATE_DIMENSION), action(HaxBallField::ACTION_DIMENSION);
+    HaxBallCore::StepInfo info;
+    double total = 0.0;
+
+    for (int i = 0; i < EPISODES; ++i)
+    {
+      HaxBallCore env(true, EVALUATION_SEED, i);
+      double discount = 1.0;
+
+      env.getState(state);
+
+      for (int j = 0; j < HORIZON; ++j)
+      {
+        agent.policy(state, action);
+        env.step(action, info);
+
+        total += discount * agent.reward(agent.roundedState(state), state);
+        discount *= agent.getDiscount();
+        state = info.state_prime;
+      }
+    }
+
+    return total / EPISODES;
+  }
+
+  ///
+  /// \brief train Calls training() until the greedy return reaches the threshold, prints the cost of getting there
+  /// \return whether the threshold was reached within the calls
+  ///
+  bool train(double lambda, double threshold, int calls)
+  {
+    QLambda agent(lambda, 0.9, 0.01, SEED, true);
+
+    for (int i = 1; i <= calls; ++i)
+    {
+      agent.training();
+
+      const double R = greedyReturn(agent);
+
+      if (R >= threshold)
+      {
+        std::cout << "lambda " << lambda << ": return " << R << " after " << i << " calls, "
+                  << agent.getSteps() << " steps, " << agent.getUpdates() << " updates" << std::endl;
+        return true;
+      }
+    }
+
+    std::cout << "lambda " << lambda << ": return " << threshold << " not reached in " << calls << " calls, "
+              << agent.getSteps() << " steps, " << agent.getUpdates() << " updates" << std::endl;
+    return false;
+  }
+}
+
+// Compares one-step Q-learning (QLambda with lambda = 0) with Q(lambda) on the full-state grid: both train from the
+// same seed until the greedy return reaches a threshold, the number of Q-value updates up to there is the cost
+// Usage: QLambdaBenchmark [lambda] [threshold] [calls of training()]
+// The training threads share the Q-table (Hogwild), use OMP_NUM_THREADS=1 for runs that repeat exactly
+int main(int argc, char** argv)
+{
+  const double lambda = argc > 1 ? std::atof(argv[1]) : 0.8;
+  const double threshold = argc > 2 ? std::atof(argv[2]) : -31.4;
+  const int calls = argc > 3 ? std::atoi(argv[3]) : 50;
+
+  if (not (lambda > 0.0 and lambda <= 1.0) or calls <= 0)
+  {
+    std::cerr << "Usage: " << argv[0] << " [lambda in (0, 1]] [threshold] [calls of training()]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Greedy return threshold " << threshold << ", " << EPISODES << " episodes of " << HORIZON
+            << " steps, at most " << calls << " calls of " << QLambda::TRAJECTORIES << " x " << QLambda::STEPS
+            << " steps" << std::endl;
+
+  const bool baseline = train(0.0, threshold, calls);
+  const bool traces = train(lambda, threshold, calls);
+
+  return baseline and traces ? EXIT_SUCCESS : EXIT_FAILURE;
+}
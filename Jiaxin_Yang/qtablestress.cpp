@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Philox.h"
+#include "QTable.h"
+#include "SparseQTable.h"
+
+namespace
+{
+  /// The actions per cell, the same as QLearning
+  const int ACTIONS = 9;
+
+  /// The problems found by one thread
+  struct Errors
+  {
+    std::uint64_t reads = 0, lost = 0;
+  };
+
+  ///
+  /// \brief stress Lets many threads update and read the same table with the atomic functions only
+  /// \param cells The keys of the cells to use
+  /// \return the problems found, all zero if the table passed
+  ///
+  /// First every thread adds 1 to random Q-values and reads the best action and the maximum of random cells.
+  /// Since all increments are 1, no update may get lost: every Q-value ends as the number of additions to it.
+  /// Then every thread adds 1 to the best action of every cell only. The best action of a cell must not change
+  /// and the maximum a thread reads must never decrease.
+  ///
+  template <typename Table, typename Key>
+  Errors stress(Table& table, const std::vector<Key>& cells, int threads, int updates)
+  {
+    const std::size_t n = cells.size();
+    std::vector<std::vector<std::uint64_t>> counts(threads, std::vector<std::uint64_t>(n * ACTIONS, 0));
+    std::vector<Errors> errors(threads);
+    std::vector<std::thread> workers;
+
+    for (int t = 0; t < threads; ++t)
+    {
+      workers.emplace_back([&, t]()
+      {
+        Philox4x32 random_engine(1, t);
+
+        for (int i = 0; i < updates; ++i)
+        {
+          const std::size_t c = random_engine() % n;
+          const int a = static_cast<int>(random_engine() % ACTIONS);
+
+          table.atomicAdd(cells[c], a, 1.0);
+          counts[t][c * ACTIONS + a]++;
+
+          const Key read = cells[random_engine() % n];
+          const int best = table.bestActionAtomic(read);
+          const double max = table.maxValueAtomic(read);
+
+          if (best < 0 or best >= ACTIONS or not (max >= 0.0 and max <= static_cast<double>(threads) * updates))
+            errors[t].reads++;
+        }
+      });
+    }
+
+    for (std::thread& worker : workers)
+      worker.join();
+
+    workers.clear();
+
+    const Table& result = table;
+    std::vector<int> best(n);
+    std::vector<double> before(n);
+
+    for (std::size_t c = 0; c < n; ++c)
+    {
+      for (int a = 0; a < ACTIONS; ++a)
+      {
+        std::uint64_t expected = 0;
+
+        for (int t = 0; t < threads; ++t)
+          expected += counts[t][c * ACTIONS + a];
+
+        if (result(cells[c], a) != static_cast<double>(expected))
+          errors[0].lost++;
+      }
+
+      best[c] = result.bestAction(cells[c]);
+      before[c] = result(cells[c], best[c]);
+    }
+
+    const int rounds = std::max(1, updates / static_cast<int>(n));
+
+    for (int t = 0; t < threads; ++t)
+    {
+      workers.emplace_back([&, t]()
+      {
+        std::vector<double> seen(before);
+
+        for (int r = 0; r < rounds; ++r)
+        {
+          for (std::size_t c = 0; c < n; ++c)
+          {
+            table.atomicAdd(cells[c], best[c], 1.0);
+
+            // Another thread's cell, the reads race with its updates
+            const std::size_t other = (c + t * n / threads) % n;
+            const double max = table.maxValueAtomic(cells[other]);
+
+            if (table.bestActionAtomic(cells[other]) != best[other] or max < seen[other])
+              errors[t].reads++;
+
+            seen[other] = max;
+          }
+        }
+      });
+    }
+
+    for (std::thread& worker : workers)
+      worker.join();
+
+    for (std::size_t c = 0; c < n; ++c)
+    {
+      if (result(cells[c], best[c]) != before[c] + static_cast<double>(threads) * rounds)
+        errors[0].lost++;
+    }
+
+    Errors total;
+
+    for (const Errors& e : errors)
+    {
+      total.reads += e.reads;
+      total.lost += e.lost;
+    }
+
+    return total;
+  }
+
+  /// Prints the result of one table, returns whether it passed
+  bool report(const std::string& name, const Errors& errors)
+  {
+    std::cout << name << ": " << errors.lost << " lost updates, " << errors.reads << " inconsistent reads, "
+              << (errors.lost == 0 and errors.reads == 0 ? "passed" : "FAILED") << std::endl;
+
+    return errors.lost == 0 and errors.reads == 0;
+  }
+}
+
+// Stress test of the lock free functions of QTable and SparseQTable, the ones the Hogwild training uses
+// Usage: QTableStress [threads] [updates per thread]
+// Build it with -DSANITIZE_THREAD=ON to let ThreadSanitizer check for data races as well
+int main(int argc, char** argv)
+{
+  const int threads = argc > 1 ? std::atoi(argv[1]) : std::max(4, static_cast<int>(std::thread::hardware_concurrency()));
+  const int updates = argc > 2 ? std::atoi(argv[2]) : 200000;
+
+  if (threads <= 0 or updates <= 0)
+  {
+    std::cerr << "Usage: " << argv[0] << " [threads] [updates per thread]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << threads << " threads, " << updates << " updates per thread" << std::endl;
+
+  // The dense table of the QLearning offset grid, all threads meet in few cells
+  QTable dense(512, 1, ACTIONS);
+  std::vector<int> dense_cells(dense.getCells());
+
+  for (int c = 0; c < dense.getCells(); ++c)
+    dense_cells[c] = c;
+
+  // The sparse table with keys spread over 63 bits, the threads insert the same cells concurrently
+  const std::size_t sparse_size = 1 << 14;
+  SparseQTable sparse(ACTIONS, 16);
+  std::vector<std::uint64_t> sparse_cells(sparse_size);
+  Philox4x32 random_engine(2);
+
+  for (std::uint64_t& key : sparse_cells)
+    key = ((static_cast<std::uint64_t>(random_engine()) << 32) | random_engine()) >> 1;
+
+  // The table must not grow while the threads share it
+  sparse.reserve(sparse_size);
+
+  const bool dense_passed = report("QTable", stress(dense, dense_cells, threads, updates));
+  bool sparse_passed = report("SparseQTable", stress(sparse, sparse_cells, threads, updates));
+
+  // The second phase updates every key, each one has to be in the table exactly once
+  std::sort(sparse_cells.begin(), sparse_cells.end());
+  const std::size_t keys = std::unique(sparse_cells.begin(), sparse_cells.end()) - sparse_cells.begin();
+
+  if (sparse.getSize() != keys)
+  {
+    std::cout << "SparseQTable: " << sparse.getSize() << " cells instead of " << keys << ", FAILED" << std::endl;
+    sparse_passed = false;
+  }
+
+  return dense_passed and sparse_passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,278 @@
+#include "ActorLearner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+
+#include "ActionSpace.h"
+#include "HaxBallCore.h"
+
+template <typename Agent>
+const int ActorLearner<Agent>::BLOCK_SIZE = 64;
+
+template <typename Agent>
+const std::uint64_t ActorLearner<Agent>::PUBLISH_INTERVAL = 100000;
+
+namespace
+{
+  /// The steady clock in nanoseconds
+  std::int64_t now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+}
+
+template <typename Agent>
+ActorLearner<Agent>::ActorLearner(Agent& agent, int actors, int learners, std::uint64_t seed, std::size_t queue_blocks) :
+  m_agent(agent), m_actors(actors), m_learners(learners), m_seed(seed), m_queue(queue_blocks),
+  m_running(false), m_actors_done(true),
+  m_steps(0), m_episodes(0), m_pushed(0), m_stalls(0), m_learned(0), m_idles(0), m_snapshots(0),
+  m_start(0), m_stop(0)
+{
+  if (learners < 1 or actors < 0)
+  {
+    std::stringstream ss;
+    ss << "Invalid actor learner pipeline: " << actors << " actors, " << learners << " learners";
+    throw std::invalid_argument(ss.str());
+  }
+
+  if (m_actors == 0)
+    m_actors = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - learners);
+}
+
+template <typename Agent>
+ActorLearner<Agent>::~ActorLearner()
+{
+  stop();
+}
+
+template <typename Agent>
+void ActorLearner<Agent>::start()
+{
+  if (isRunning())
+    return;
+
+  m_steps = m_episodes = m_pushed = m_stalls = m_learned = m_idles = m_snapshots = 0;
+
+  publish();
+
+  m_actors_done.store(false, std::memory_order_relaxed);
+  m_running.store(true, std::memory_order_relaxed);
+  m_start = m_stop = now();
+
+  for (int i = 0; i < m_learners; ++i)
+    m_learner_threads.emplace_back(&ActorLearner<Agent>::learn, this);
+
+  for (int i = 0; i < m_actors; ++i)
+    m_actor_threads.emplace_back(&ActorLearner<Agent>::act, this, i);
+}
+
+template <typename Agent>
+void ActorLearner<Agent>::stop()
+{
+  if (not isRunning())
+    return;
+
+  m_running.store(false, std::memory_order_relaxed);
+
+  for (auto& thread : m_actor_threads)
+    thread.join();
+
+  // All blocks are in the queue, the learners finish them
+  m_actors_done.store(true, std::memory_order_release);
+
+  for (auto& thread : m_learner_threads)
+    thread.join();
+
+  m_actor_threads.clear();
+  m_learner_threads.clear();
+  m_stop = now();
+
+  publish();
+}
+
+template <typename Agent>
+std::shared_ptr<const Agent> ActorLearner<Agent>::getSnapshot() const
+{
+  return std::atomic_load(&m_snapshot);
+}
+
+template <typename Agent>
+typename ActorLearner<Agent>::Statistics ActorLearner<Agent>::getStatistics() const
+{
+  Statistics statistics;
+
+  statistics.steps = m_steps.load(std::memory_order_relaxed);
+  statistics.episodes = m_episodes.load(std::memory_order_relaxed);
+  statistics.pushed = m_pushed.load(std::memory_order_relaxed);
+  statistics.stalls = m_stalls.load(std::memory_order_relaxed);
+  statistics.learned = m_learned.load(std::memory_order_relaxed);
+  statistics.idles = m_idles.load(std::memory_order_relaxed);
+  statistics.snapshots = m_snapshots.load(std::memory_order_relaxed);
+  statistics.queued = m_queue.getSize();
+  statistics.seconds = 1e-9 * ((isRunning() ? now() : m_stop.load()) - m_start.load());
+
+  return statistics;
+}
+
+template <typename Agent>
+void ActorLearner<Agent>::publish()
+{
+  std::atomic_store(&m_snapshot, std::shared_ptr<const Agent>(std::make_shared<Agent>(m_agent.snapshot())));
+  m_snapshots.fetch_add(1, std::memory_order_relaxed);
+}
+
+template <typename Agent>
+void ActorLearner<Agent>::act(int actor)
+{
+  // Every actor has its own start states and exploration
+  const std::uint64_t actor_seed = Philox4x32::deriveSeed(m_seed, actor);
+
+  HaxBallCore env(true, actor_seed, 0);
+  Philox4x32 random_engine(actor_seed, 1);
+  HaxBallCore::StepInfo info;
+
+  Eigen::VectorXd
+      state(env.getStateDimension()),
+      action(env.getActionDimension());
+  typename Agent::Features features;
+
+  Block block;
+  std::uint64_t steps = 0, episodes = 0;
+
+  while (isRunning())
+  {
+    // The latest policy, kept for the whole episode
+    const std::shared_ptr<const Agent> snapshot = getSnapshot();
+
+    env.reset();
+    env.getState(state);
+    snapshot->activate(state, features);
+
+    // The number of the state in the block, -1 until it is stored
+    int current = -1;
+
+    for (int j = 0; j < Agent::STEPS and isRunning(); ++j)
+    {
+      if (block.size == 0)
+      {
+        // A pushed block was moved into the queue, at most one state more than transitions per episode
+        block.states.resize(env.getStateDimension(), 2 * BLOCK_SIZE);
+        block.current.resize(BLOCK_SIZE);
+        block.next.resize(BLOCK_SIZE);
+        block.actions.resize(BLOCK_SIZE);
+        block.rewards.resize(BLOCK_SIZE);
+        block.terminals.resize(BLOCK_SIZE);
+        block.states_size = 0;
+        current = -1;
+      }
+
+      if (current < 0)
+      {
+        current = block.states_size++;
+        block.states.col(current) = state;
+      }
+
+      // Epsilon greedy, like LinearQ::training()
+      int a;
+
+      if (random_engine.uniform<double>() < Agent::EPSILON)
+        a = static_cast<int>(random_engine() % Agent::ACTIONS);
+      else
+        a = Agent::argmax(snapshot->actionValues(features, 0));
+
+      Action::action_map(a, action);
+      env.step(action, info);
+
+      const int i = block.size++;
+
+      block.current(i) = current;
+      block.next(i) = current = block.states_size++;
+      block.states.col(current) = info.state_prime;
+      block.actions(i) = a;
+      block.rewards(i) = snapshot->reward(state, action, info.state_prime);
+      block.terminals(i) = info.terminal;
+
+      state = info.state_prime;
+      snapshot->activate(state, features);
+      steps++;
+
+      if (block.size < BLOCK_SIZE)
+        continue;
+
+      // The actors compute the features of all states of the block at once, the learners only update the weights
+      snapshot->activateBatch(block.states.leftCols(block.states_size), block.features);
+
+      // Backpressure: wait while the learners are behind, drop the block when stopping
+      bool pushed = m_queue.tryPush(block);
+
+      if (not pushed)
+      {
+        m_stalls.fetch_add(1, std::memory_order_relaxed);
+
+        while (not (pushed = m_queue.tryPush(block)) and isRunning())
+          std::this_thread::yield();
+      }
+
+      block.size = 0;
+      m_pushed.fetch_add(pushed ? 1 : 0, std::memory_order_relaxed);
+      m_steps.fetch_add(steps, std::memory_order_relaxed);
+      m_episodes.fetch_add(episodes, std::memory_order_relaxed);
+      steps = episodes = 0;
+    }
+
+    episodes++;
+  }
+
+  m_steps.fetch_add(steps, std::memory_order_relaxed);
+  m_episodes.fetch_add(episodes, std::memory_order_relaxed);
+}
+
+template <typename Agent>
+void ActorLearner<Agent>::learn()
+{
+  Block block;
+  bool waiting = false;
+
+  for (;;)
+  {
+    // Read before the pop: if the actors were done and the pop fails, the queue is empty for good
+    const bool actors_done = m_actors_done.load(std::memory_order_acquire);
+
+    if (not m_queue.tryPop(block))
+    {
+      if (actors_done)
+        break;
+
+      if (not waiting)
+        m_idles.fetch_add(1, std::memory_order_relaxed);
+
+      waiting = true;
+      std::this_thread::yield();
+      continue;
+    }
+
+    waiting = false;
+
+    // Q-learning on the shared weights, the same update as LinearQ::training()
+    for (int i = 0; i < block.size; ++i)
+    {
+      double target = block.rewards(i);
+
+      if (not block.terminals(i))
+        target += Agent::GAMMA * m_agent.actionValuesAtomic(block.features, block.next(i)).template head<Agent::ACTIONS>().maxCoeff();
+
+      m_agent.update(block.features, block.current(i), block.actions(i), target);
+    }
+
+    const std::uint64_t learned = m_learned.fetch_add(block.size, std::memory_order_relaxed);
+
+    if (learned / PUBLISH_INTERVAL != (learned + block.size) / PUBLISH_INTERVAL)
+      publish();
+  }
+}
+
+template class ActorLearner<TileCoding>;
+template class ActorLearner<MultilinearQ>;
+template class ActorLearner<RadialBasisQ>;
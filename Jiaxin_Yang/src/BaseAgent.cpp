@@ -1,3 +1,65 @@
 #include "BaseAgent.h"
 
-// Maybe I should remove this file, nothing required in here
+#include <sstream>
+#include <stdexcept>
+
+void BaseAgent::checkColumns(const char* name, Eigen::Index cols, Eigen::Index expected)
+{
+  if (cols != expected)
+  {
+    std::stringstream ss;
+    ss << "Invalid batch for the agent: " << name << " has " << cols << " columns, expected " << expected;
+    throw std::invalid_argument(ss.str());
+  }
+}
+
+void BaseAgent::policyBatch(const Eigen::Ref<const Eigen::MatrixXd>& states,
+                            Eigen::Ref<Eigen::MatrixXd> actions) const
+{
+  checkColumns("actions", actions.cols(), states.cols());
+
+  for (Eigen::Index i = 0; i < states.cols(); ++i)
+    policy(states.col(i), actions.col(i));
+}
+
+void BaseAgent::rewardBatch(const Eigen::Ref<const Eigen::MatrixXd>& states,
+                            const Eigen::Ref<const Eigen::MatrixXd>& actions,
+                            const Eigen::Ref<const Eigen::MatrixXd>& states_prime,
+                            Eigen::Ref<Eigen::VectorXd> rewards) const
+{
+  checkColumns("actions", actions.cols(), states.cols());
+  checkColumns("states_prime", states_prime.cols(), states.cols());
+  checkColumns("rewards", rewards.rows(), states.cols());
+
+  for (Eigen::Index i = 0; i < states.cols(); ++i)
+    rewards(i) = reward(states.col(i), actions.col(i), states_prime.col(i));
+}
+
+void BaseAgent::qValuesBatch(const Eigen::Ref<const Eigen::MatrixXd>& states,
+                             const Eigen::Ref<const Eigen::MatrixXd>& actions,
+                             Eigen::Ref<Eigen::VectorXd> Q) const
+{
+  checkColumns("actions", actions.cols(), states.cols());
+  checkColumns("Q", Q.rows(), states.cols());
+
+  for (Eigen::Index i = 0; i < states.cols(); ++i)
+    Q(i) = getQfactor(states.col(i), actions.col(i));
+}
+
+void BaseAgent::qValuesBatch(const Eigen::Ref<const Eigen::MatrixXd>& states,
+                             Eigen::MatrixXd& Q) const
+{
+  for (Eigen::Index i = 0; i < states.cols(); ++i)
+  {
+    const Eigen::VectorXd q = getQfactor(states.col(i));
+
+    // The number of actions is only known after the first call
+    if (Q.rows() != q.rows() or Q.cols() != states.cols())
+      Q.resize(q.rows(), states.cols());
+
+    Q.col(i) = q;
+  }
+
+  if (states.cols() == 0)
+    Q.resize(Q.rows(), 0);
+}
@@ -0,0 +1,319 @@
+#include "Checkpoint.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+  const std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+  std::size_t alignUp(std::size_t bytes)
+  {
+    return (bytes + Checkpoint::ALIGNMENT - 1) / Checkpoint::ALIGNMENT * Checkpoint::ALIGNMENT;
+  }
+
+  void copyName(char* destination, const std::string& name, const char* what)
+  {
+    if (name.empty() or name.size() >= Checkpoint::NAME_LENGTH)
+    {
+      std::stringstream ss;
+      ss << "Invalid " << what << " for a checkpoint: '" << name << "', 1 to " << Checkpoint::NAME_LENGTH - 1 << " characters";
+      throw std::invalid_argument(ss.str());
+    }
+
+    std::memset(destination, 0, Checkpoint::NAME_LENGTH);
+    std::memcpy(destination, name.data(), name.size());
+  }
+
+  [[noreturn]] void fail(const std::string& message, const std::string& path)
+  {
+    std::stringstream ss;
+    ss << message << " '" << path << "': " << std::strerror(errno);
+    throw std::runtime_error(ss.str());
+  }
+
+  /// Writes everything, write() may return early
+  bool writeAll(int fd, const void* data, std::size_t bytes)
+  {
+    const char* p = static_cast<const char*>(data);
+
+    while (bytes > 0)
+    {
+      const ssize_t n = ::write(fd, p, bytes);
+
+      if (n < 0 and errno == EINTR)
+        continue;
+
+      if (n <= 0)
+        return false;
+
+      p += n;
+      bytes -= static_cast<std::size_t>(n);
+    }
+
+    return true;
+  }
+}
+
+CheckpointWriter::CheckpointWriter(const std::string& kind) : m_kind(kind)
+{
+  char buffer[Checkpoint::NAME_LENGTH];
+  copyName(buffer, kind, "kind");
+}
+
+void CheckpointWriter::add(const std::string& name, const void* data, std::size_t bytes)
+{
+  for (const Section& section : m_sections)
+  {
+    if (name == section.entry.name)
+      throw std::invalid_argument("The checkpoint has already a section '" + name + "'");
+  }
+
+  Section section;
+  std::memset(&section.entry, 0, sizeof(section.entry));
+  copyName(section.entry.name, name, "section name");
+  section.entry.bytes = bytes;
+  section.data = data;
+
+  m_sections.push_back(section);
+}
+
+void CheckpointWriter::addMatrix(const std::string& name, const Eigen::Ref<const Eigen::MatrixXd>& matrix)
+{
+  // A Ref of a MatrixXd has an outer stride, only contiguous matrices can be written in one piece
+  if (matrix.outerStride() != matrix.rows())
+    throw std::invalid_argument("The matrix of the checkpoint section '" + name + "' is not contiguous");
+
+  add(name, matrix.data(), sizeof(double) * matrix.size());
+
+  m_sections.back().entry.rows = matrix.rows();
+  m_sections.back().entry.cols = matrix.cols();
+}
+
+void CheckpointWriter::write(const std::string& path) const
+{
+  // Layout: header, table of contents, then the sections on aligned offsets
+  Checkpoint::Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, Checkpoint::MAGIC, sizeof(header.magic));
+  header.version = Checkpoint::VERSION;
+  header.byte_order = BYTE_ORDER_MARK;
+  header.sections = m_sections.size();
+  copyName(header.kind, m_kind, "kind");
+
+  std::vector<Checkpoint::Entry> entries;
+  std::size_t offset = alignUp(sizeof(header) + m_sections.size() * sizeof(Checkpoint::Entry));
+
+  for (const Section& section : m_sections)
+  {
+    entries.push_back(section.entry);
+    entries.back().offset = offset;
+    offset = alignUp(offset + section.entry.bytes);
+  }
+
+  header.file_size = offset;
+
+  // Everything goes into a temporary file next to the target, the rename below replaces the target atomically.
+  // A unique name per writer, two processes saving the same checkpoint must not write into the same file.
+  std::vector<char> name(path.begin(), path.end());
+  const char suffix[] = ".tmp.XXXXXX";
+  name.insert(name.end(), suffix, suffix + sizeof(suffix));
+
+  const int fd = ::mkstemp(name.data());
+  const std::string temporary(name.data());
+
+  if (fd < 0)
+    fail("Cannot create the checkpoint", temporary);
+
+  // mkstemp() creates the file for the owner only, a checkpoint is readable like any other file
+  ::fchmod(fd, 0644);
+
+  static const char zeros[Checkpoint::ALIGNMENT] = {};
+  bool ok = writeAll(fd, &header, sizeof(header))
+      and writeAll(fd, entries.data(), entries.size() * sizeof(Checkpoint::Entry));
+
+  std::size_t position = sizeof(header) + entries.size() * sizeof(Checkpoint::Entry);
+
+  for (std::size_t s = 0; ok and s < m_sections.size(); ++s)
+  {
+    const Section& section = m_sections[s];
+    ok = writeAll(fd, zeros, entries[s].offset - position)
+        and writeAll(fd, section.copy.empty() ? section.data : section.copy.data(), entries[s].bytes);
+    position = entries[s].offset + entries[s].bytes;
+  }
+
+  ok = ok and writeAll(fd, zeros, header.file_size - position);
+
+  // The data has to be on the disk before the rename, otherwise a crash could leave an empty file under the old name
+  ok = ok and ::fsync(fd) == 0;
+
+  if (::close(fd) != 0 or not ok)
+  {
+    const int error = errno;
+    ::unlink(temporary.c_str());
+    errno = error;
+    fail("Cannot write the checkpoint", temporary);
+  }
+
+  if (::rename(temporary.c_str(), path.c_str()) != 0)
+  {
+    const int error = errno;
+    ::unlink(temporary.c_str());
+    errno = error;
+    fail("Cannot replace the checkpoint", path);
+  }
+
+  // The rename is an update of the directory, it is durable only once the directory is on the disk as well
+  const std::string::size_type slash = path.rfind('/');
+  const std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+  const int directory_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+
+  if (directory_fd < 0)
+    fail("Cannot open the directory of the checkpoint", directory);
+
+  const bool synced = ::fsync(directory_fd) == 0;
+  const int error = errno;
+  ::close(directory_fd);
+
+  if (not synced)
+  {
+    errno = error;
+    fail("Cannot sync the directory of the checkpoint", directory);
+  }
+}
+
+CheckpointReader::CheckpointReader(const std::string& path) :
+  m_path(path), m_data(nullptr), m_size(0)
+{
+  const int fd = ::open(path.c_str(), O_RDONLY);
+
+  if (fd < 0)
+    fail("Cannot open the checkpoint", path);
+
+  struct stat status;
+
+  if (::fstat(fd, &status) != 0)
+  {
+    ::close(fd);
+    fail("Cannot read the size of the checkpoint", path);
+  }
+
+  m_size = static_cast<std::size_t>(status.st_size);
+
+  if (m_size < sizeof(Checkpoint::Header))
+  {
+    ::close(fd);
+    throw std::runtime_error("The file '" + path + "' is too small for a checkpoint");
+  }
+
+  // The mapping stays valid after closing the file and after the file got replaced
+  void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+
+  if (data == MAP_FAILED)
+    fail("Cannot map the checkpoint", path);
+
+  m_data = data;
+
+  // Validate everything once, the accessors can rely on it
+  const Checkpoint::Header& h = header();
+  std::string error;
+
+  if (std::memcmp(h.magic, Checkpoint::MAGIC, sizeof(h.magic)) != 0)
+    error = "is no checkpoint";
+  else if (h.byte_order != BYTE_ORDER_MARK)
+    error = "has a different byte order";
+  else if (h.version > Checkpoint::VERSION)
+    error = "has the newer version " + std::to_string(h.version) + ", this program reads up to " + std::to_string(Checkpoint::VERSION);
+  else if (h.file_size != m_size or h.kind[Checkpoint::NAME_LENGTH - 1] != '\0'
+           or h.sections > (m_size - sizeof(h)) / sizeof(Checkpoint::Entry))
+    error = "is truncated or corrupt";
+  else
+  {
+    const Checkpoint::Entry* entries = reinterpret_cast<const Checkpoint::Entry*>(&h + 1);
+
+    for (std::uint64_t s = 0; s < h.sections and error.empty(); ++s)
+    {
+      const Checkpoint::Entry& e = entries[s];
+
+      if (e.name[Checkpoint::NAME_LENGTH - 1] != '\0' or e.offset % Checkpoint::ALIGNMENT != 0
+          or e.offset > m_size or e.bytes > m_size - e.offset)
+        error = "has a corrupt section";
+    }
+  }
+
+  if (not error.empty())
+  {
+    ::munmap(m_data, m_size);
+    throw std::runtime_error("The file '" + path + "' " + error);
+  }
+}
+
+CheckpointReader::~CheckpointReader()
+{
+  ::munmap(m_data, m_size);
+}
+
+bool CheckpointReader::exists(const std::string& path)
+{
+  return ::access(path.c_str(), R_OK) == 0;
+}
+
+const Checkpoint::Entry* CheckpointReader::find(const std::string& name) const
+{
+  const Checkpoint::Entry* entries = reinterpret_cast<const Checkpoint::Entry*>(&header() + 1);
+
+  for (std::uint64_t s = 0; s < header().sections; ++s)
+  {
+    if (name == entries[s].name)
+      return entries + s;
+  }
+
+  return nullptr;
+}
+
+const void* CheckpointReader::data(const std::string& name, std::size_t& bytes) const
+{
+  const Checkpoint::Entry* entry = find(name);
+
+  if (entry == nullptr)
+    throw std::runtime_error("The checkpoint '" + m_path + "' has no section '" + name + "'");
+
+  bytes = entry->bytes;
+
+  return static_cast<const char*>(m_data) + entry->offset;
+}
+
+void CheckpointReader::copy(const std::string& name, void* destination, std::size_t bytes) const
+{
+  std::size_t stored;
+  const void* source = data(name, stored);
+
+  if (stored != bytes)
+  {
+    std::stringstream ss;
+    ss << "The section '" << name << "' of the checkpoint '" << m_path << "' has " << stored << " bytes, expected " << bytes;
+    throw std::runtime_error(ss.str());
+  }
+
+  std::memcpy(destination, source, bytes);
+}
+
+Eigen::Map<const Eigen::MatrixXd> CheckpointReader::matrix(const std::string& name) const
+{
+  std::size_t bytes;
+  const double* values = static_cast<const double*>(data(name, bytes));
+  const Checkpoint::Entry* entry = find(name);
+
+  if (entry->rows * entry->cols * sizeof(double) != bytes)
+    throw std::runtime_error("The section '" + name + "' of the checkpoint '" + m_path + "' is no matrix");
+
+  return Eigen::Map<const Eigen::MatrixXd>(values, entry->rows, entry->cols);
+}
@@ -0,0 +1,220 @@
+#include "Discretizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+Discretizer::Discretizer(int state_dimension) :
+  m_state_dimension(state_dimension), m_bits_total(0)
+{
+
+}
+
+int Discretizer::addDimension(const Eigen::Ref<const Eigen::VectorXd>& weights, double low, double high, double resolution)
+{
+  if (weights.rows() != m_state_dimension or not (high >= low) or not (resolution > 0.0))
+  {
+    std::stringstream ss;
+    ss << "Invalid dimension for the discretizer: " << weights.rows() << " weights, range [" << low << ", " << high
+       << "], resolution " << resolution;
+    throw std::invalid_argument(ss.str());
+  }
+
+  const long first = std::lround(low / resolution);
+  const int cells = static_cast<int>(std::lround(high / resolution) - first) + 1;
+
+  // Bits for the next power of two
+  int bits = 0;
+
+  while ((1 << bits) < cells)
+    bits++;
+
+  if (m_bits_total + bits > MAX_BITS)
+  {
+    std::stringstream ss;
+    ss << "Too many cells for the discretizer: " << m_bits_total + bits << " index bits";
+    throw std::invalid_argument(ss.str());
+  }
+
+  Dimension dimension;
+
+  dimension.resolution = resolution;
+  dimension.inverse = 1.0 / resolution;
+  dimension.first = first;
+  dimension.cells = cells;
+  dimension.bits = bits;
+  dimension.terms_begin = static_cast<int>(m_terms_weight.size());
+
+  // Features are usually a single component or a difference, single states only use the non zero weights
+  for (int i = 0; i < m_state_dimension; ++i)
+  {
+    if (weights(i) != 0.0)
+    {
+      m_terms_weight.push_back(weights(i));
+      m_terms_component.push_back(i);
+    }
+  }
+
+  dimension.terms_end = static_cast<int>(m_terms_weight.size());
+
+  m_dimensions.push_back(dimension);
+
+  updateLayout();
+
+  return getDimensions() - 1;
+}
+
+int Discretizer::addDimension(int component, double low, double high, double resolution)
+{
+  return addDimension(Eigen::VectorXd::Unit(m_state_dimension, component), low, high, resolution);
+}
+
+std::uint64_t Discretizer::getCells() const
+{
+  std::uint64_t cells = 1;
+
+  for (const Dimension& dimension : m_dimensions)
+    cells *= dimension.cells;
+
+  return cells;
+}
+
+void Discretizer::features(const Eigen::Ref<const Eigen::VectorXd>& state, Eigen::Ref<Eigen::VectorXd> features) const
+{
+  for (int d = 0; d < getDimensions(); ++d)
+    features(d) = feature(d, state);
+}
+
+void Discretizer::snap(const Eigen::Ref<const Eigen::VectorXd>& state, Eigen::Ref<Eigen::VectorXd> values) const
+{
+  for (int d = 0; d < getDimensions(); ++d)
+    values(d) = (m_dimensions[d].first + gridIndex(d, feature(d, state))) * m_dimensions[d].resolution;
+}
+
+std::uint64_t Discretizer::index(const Eigen::Ref<const Eigen::VectorXd>& state) const
+{
+  std::uint64_t index = 0;
+
+  for (int d = 0; d < getDimensions(); ++d)
+    index |= m_spread[d][gridIndex(d, feature(d, state))];
+
+  return index;
+}
+
+std::uint64_t Discretizer::indexOfFeatures(const Eigen::Ref<const Eigen::VectorXd>& features) const
+{
+  std::uint64_t index = 0;
+
+  for (int d = 0; d < getDimensions(); ++d)
+    index |= m_spread[d][gridIndex(d, features(d))];
+
+  return index;
+}
+
+void Discretizer::indexBatch(const Eigen::Ref<const Eigen::MatrixXd>& states, Eigen::Ref<IndexVector> indices) const
+{
+  if (indices.rows() != states.cols())
+  {
+    std::stringstream ss;
+    ss << "Invalid batch for the discretizer: " << indices.rows() << " indices for " << states.cols() << " states";
+    throw std::invalid_argument(ss.str());
+  }
+
+  Eigen::ArrayXd features(states.cols());
+  Eigen::ArrayXi grid(states.cols());
+
+  indices.setZero();
+
+  // Dimension by dimension, feature, rounding and clipping vectorise over the states
+  for (int d = 0; d < getDimensions(); ++d)
+  {
+    const Dimension& dimension = m_dimensions[d];
+
+    // Only the non zero weights, cheaper than a general matrix product with a few rows
+    features.setZero();
+
+    for (int t = dimension.terms_begin; t < dimension.terms_end; ++t)
+      features += m_terms_weight[t] * states.row(m_terms_component[t]).transpose().array();
+
+    grid = ((features * dimension.inverse).round() - double(dimension.first))
+           .max(0.0).min(double(dimension.cells - 1)).cast<int>();
+
+    for (Eigen::Index i = 0; i < states.cols(); ++i)
+      indices(i) |= m_spread[d][grid(i)];
+  }
+}
+
+void Discretizer::center(std::uint64_t index, Eigen::Ref<Eigen::VectorXd> values) const
+{
+  // Collect the bits of every dimension in the same order as updateLayout() placed them
+  std::vector<int> grid(getDimensions(), 0);
+  int position = 0;
+
+  for (int bit = 0; position < m_bits_total; ++bit)
+  {
+    for (int d = 0; d < getDimensions(); ++d)
+    {
+      if (bit < m_dimensions[d].bits)
+      {
+        grid[d] |= static_cast<int>((index >> position) & 1) << bit;
+        position++;
+      }
+    }
+  }
+
+  for (int d = 0; d < getDimensions(); ++d)
+    values(d) = (m_dimensions[d].first + std::min(grid[d], m_dimensions[d].cells - 1)) * m_dimensions[d].resolution;
+}
+
+double Discretizer::feature(int dimension, const Eigen::Ref<const Eigen::VectorXd>& state) const
+{
+  double value = 0.0;
+
+  for (int t = m_dimensions[dimension].terms_begin; t < m_dimensions[dimension].terms_end; ++t)
+    value += m_terms_weight[t] * state(m_terms_component[t]);
+
+  return value;
+}
+
+int Discretizer::gridIndex(int dimension, double feature) const
+{
+  const Dimension& d = m_dimensions[dimension];
+
+  // Rounded before the shift to the first grid point, no rounding error from subtracting the lower bound
+  // Multiplied with the inverse resolution, exactly the same as the division for powers of two like 1, 0.5 or 0.25
+  const long cell = static_cast<long>(std::round(feature * d.inverse)) - d.first;
+
+  return static_cast<int>(std::max(0L, std::min(cell, static_cast<long>(d.cells - 1))));
+}
+
+void Discretizer::updateLayout()
+{
+  m_bits_total = 0;
+
+  for (const Dimension& dimension : m_dimensions)
+    m_bits_total += dimension.bits;
+
+  m_spread.assign(getDimensions(), std::vector<std::uint64_t>());
+
+  for (int d = 0; d < getDimensions(); ++d)
+    m_spread[d].assign(m_dimensions[d].cells, 0);
+
+  // Round robin over the dimensions, bit by bit, dimensions with fewer bits drop out early
+  int position = 0;
+
+  for (int bit = 0; position < m_bits_total; ++bit)
+  {
+    for (int d = 0; d < getDimensions(); ++d)
+    {
+      if (bit < m_dimensions[d].bits)
+      {
+        for (int cell = 0; cell < m_dimensions[d].cells; ++cell)
+          if ((cell >> bit) & 1)
+            m_spread[d][cell] |= std::uint64_t(1) << position;
+
+        position++;
+      }
+    }
+  }
+}
@@ -3,11 +3,10 @@
 #include <cmath>
 #include <iostream>
 
-#include <QDebug>
-
 #include <omp.h>
 
-DummyAgent::DummyAgent()
+DummyAgent::DummyAgent(std::uint64_t seed) :
+  m_seed(seed), m_iteration(0)
 {
 
 }
@@ -41,8 +40,8 @@ double DummyAgent::reward(const Eigen::Ref<const Eigen::VectorXd>& state,
   // Put your reward signal in here (or call some other function in the directory with shared code)
 
   // Only rely on information, which is part of s, a and s', and which is still included after your conversion from continuous vectors to something else
-  // You can make use of m_world, but only to get constant stuff: the goal position or size of the field.
-  // The const-modifer protects you from race conditions
+  // Constant stuff like the goal position or the size of the field is available in HaxBallField.
+  // These are compile time constants, so there are no race conditions
 
   // Pay attention to not create a non-stationary reward function on accident. In particular for grid based agents:
   //  - the continuous state changes within the same cell, because the grid aggregates information
@@ -78,14 +77,18 @@ void DummyAgent::training(int length, int trajectories, int threads)
 
   omp_set_num_threads(threads);
 
+  // One random stream per trajectory (not per thread), so the result does not depend on the number of threads
+  const std::uint64_t iteration_seed = Philox4x32::deriveSeed(m_seed, m_iteration++);
+
 #pragma omp parallel for
   for (int i = 0; i < trajectories; ++i)
   {
-    training_worker(length);
+    Philox4x32 random_engine(iteration_seed, i);
+    training_worker(length, random_engine);
   }
 }
 
-void DummyAgent::training_worker(int length)
+void DummyAgent::training_worker(int length, Philox4x32& random_engine)
 {
   // Training code goes here, be aware that multiple threads are active in here
   // The existing code for training is only a proposal, implement whatever you need and do not hesitate to restructure this part
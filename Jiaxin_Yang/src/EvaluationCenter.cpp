@@ -2,8 +2,13 @@
 
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #include <cmath>
 
+#include "HaxBallBatch.h"
+#include "HaxBallCore.h"
+#include "Rollout.h"
+
 EvaluationCenter::EvaluationCenter(const BaseAgent& agent, std::shared_ptr<HaxBall> world, double gamma) :
   m_world(world), m_agent(agent), m_gamma(gamma)
 {
@@ -25,32 +30,40 @@ EvaluationCenter::~EvaluationCenter()
 
 void EvaluationCenter::evaluate()
 {
-  Eigen::VectorXd
-      state(m_world->getStateDimension()),
-      action(m_world->getActionDimension());
+  // All probes at once, one column per probe
+  Eigen::MatrixXd
+      states(m_world->getStateDimension(), EvaluationCenter::N),
+      actions(m_world->getActionDimension(), EvaluationCenter::N);
 
-  double V, R;
+  Eigen::VectorXd V(EvaluationCenter::N), R(EvaluationCenter::N);
+
+  for (unsigned int i = 0; i < EvaluationCenter::N; ++i)
+    states.col(i) = m_probes[i];
 
   std::ofstream file;
   file.open("eval.csv", std::ios::out | std::ios::app);
 
   // Expected reward for all probes according to agent
-  for (int i = 0; i < EvaluationCenter::N; ++i)
-  {
-    state = m_probes[i];
-    m_agent.policy(state, action);
+  m_agent.policyBatch(states, actions);
 
-    V = m_agent.getQfactor(state, action); // This is not Q but V, since the action is selected according to the policy
+  m_agent.qValuesBatch(states, actions, V); // This is not Q but V, since the action is selected according to the policy
 
-    file << V << ",";
-  }
+  for (unsigned int i = 0; i < EvaluationCenter::N; ++i)
+    file << V(i) << ",";
 
-  // True Discounted Returns according to rollouts
-  for (int i = 0; i < EvaluationCenter::N; ++i)
-  {
-    R = rollout(m_probes[i]);
+  // True Discounted Returns according to rollouts, all probes step together: one policy and one reward call per step
+  HaxBallBatch envs(EvaluationCenter::N, m_world->hasOpponent());
 
-    file << R;
+  Rollout::rolloutBatch(envs, states, EvaluationCenter::TAU, m_gamma,
+                        [this](const Eigen::MatrixXd& s, Eigen::MatrixXd& a)
+                        { m_agent.policyBatch(s, a); },
+                        [this](const Eigen::MatrixXd& s, const Eigen::MatrixXd& a, const Eigen::MatrixXd& s_prime, Eigen::VectorXd& r)
+                        { m_agent.rewardBatch(s, a, s_prime, r); },
+                        R);
+
+  for (unsigned int i = 0; i < EvaluationCenter::N; ++i)
+  {
+    file << R(i);
 
     // The last , must be omitted for .csv format
     if(i < EvaluationCenter::N-1)
@@ -64,35 +77,80 @@ void EvaluationCenter::evaluate()
 
 double EvaluationCenter::rollout(const Eigen::Ref<const Eigen::VectorXd>& start_state)
 {
+  // Prepare environment, the rollout kernel sets the start state
+  m_world->reset();
+
+  // The agent is only known as BaseAgent, so policy and reward stay virtual calls
+  return Rollout::rollout(m_world->core(), start_state, EvaluationCenter::TAU, m_gamma,
+                          [this](const HaxBallCore::State& s, Rollout::Action<double>& a)
+                          { m_agent.policy(s, a); },
+                          [this](const HaxBallCore::State& s, const Rollout::Action<double>& a, const HaxBallCore::State& s_prime)
+                          { return m_agent.reward(s, a, s_prime); });
+}
+
+double EvaluationCenter::precisionReport(const std::string& filename) const
+{
+  HaxBallCore world(m_world->hasOpponent());
+  HaxBallCoreF world_f(m_world->hasOpponent());
+
   Eigen::VectorXd
-      state(m_world->getStateDimension()),
-      action(m_world->getActionDimension()),
-      state_prime(m_world->getStateDimension());
+      state(world.getStateDimension()),
+      action(world.getActionDimension()),
+      state_f(world.getStateDimension()),
+      state_prime_f(world.getStateDimension());
 
-  // Prepare environment
-  m_world->reset();
-  m_world->setState(start_state);
+  HaxBallCore::StepInfo info;
+  HaxBallCoreF::StepInfo info_f;
 
-  // Accumulator for the discounted return
-  double R = 0.0, r;
+  double max_error_all = 0.0;
+
+  std::ofstream file;
+  file.open(filename, std::ios::out);
 
-  // Create rollout
-  for(int j = 0; j < EvaluationCenter::TAU; ++j)
+  file << "probe,max_error,final_error,diverged_at,R_double,R_float,"
+          "agent_goals_double,opponent_goals_double,agent_goals_float,opponent_goals_float" << std::endl;
+
+  for (unsigned int i = 0; i < EvaluationCenter::N; ++i)
   {
-    m_world->getState(state);
+    world.setState(m_probes[i]);
+    world_f.setState(m_probes[i].cast<float>());
+
+    double R = 0.0, R_f = 0.0, max_error = 0.0, error = 0.0, discount = 1.0;
+    int diverged_at = -1;
+
+    for (unsigned int j = 0; j < EvaluationCenter::TAU; ++j)
+    {
+      state = world.getState();
+      state_f = world_f.getState().cast<double>();
+
+      m_agent.policy(state, action);
 
-    m_agent.policy(state, action);
+      world.step(action, info);
+      world_f.step(action.cast<float>(), info_f);
 
-    m_world->step(action);
+      state_prime_f = info_f.state_prime.cast<double>();
 
-    m_world->getState(state_prime);
+      R += discount * m_agent.reward(state, action, info.state_prime);
+      R_f += discount * m_agent.reward(state_f, action, state_prime_f);
+      discount *= m_gamma;
 
-    r = m_agent.reward(state, action, state_prime);
+      error = (info.state_prime - state_prime_f).lpNorm<Eigen::Infinity>();
+      max_error = std::max(max_error, error);
+
+      if (diverged_at < 0 and error > DIVERGENCE)
+        diverged_at = j;
+    }
 
-    R += std::pow(m_gamma, j) * r;
+    max_error_all = std::max(max_error_all, max_error);
+
+    file << i << "," << max_error << "," << error << "," << diverged_at << "," << R << "," << R_f << ","
+         << world.getAgentGoals() << "," << world.getOpponentGoals() << ","
+         << world_f.getAgentGoals() << "," << world_f.getOpponentGoals() << std::endl;
   }
 
-  return R;
+  file.close();
+
+  return max_error_all;
 }
 
 void EvaluationCenter::writeHeader() const
@@ -0,0 +1,363 @@
+#include "HaxBallBatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+#include "HaxBallField.h"
+
+namespace
+{
+  ///
+  /// \brief collision Branch free version of HaxBall::collision() for one lane of the batch
+  ///
+  /// Particle 1 is infinitely heavy and unaffected, particle 2 is projected to the surface and reflected.
+  /// Without contact (or with a zero division) p2 and v2 keep their values.
+  ///
+  inline void collision(double p1x, double p1y, double v1x, double v1y, double r1,
+                        double& p2x, double& p2y, double& v2x, double& v2y, double r2, const float elasticity)
+  {
+    // Particle 1's coordinate frame
+    const double rel_px = p2x - p1x, rel_py = p2y - p1y;
+    const double rel_vx = v2x - v1x, rel_vy = v2y - v1y;
+
+    const double distance = std::sqrt(rel_px * rel_px + rel_py * rel_py);
+    const bool untouched = (distance > r1 + r2) | (distance < 1e-5);
+
+    // Rotated coordinate system, perpendicular direction is (-normal_y, normal_x)
+    const double normal_x = rel_px / distance, normal_y = rel_py / distance;
+
+    const double v_normal = normal_x * rel_vx + normal_y * rel_vy;
+    const double v_perpen = -normal_y * rel_vx + normal_x * rel_vy;
+
+    // Flipped and damped normal velocity plus unchanged perpendicular velocity, back in the world frame
+    const double new_vx = (-v_normal * normal_x * elasticity + v_perpen * -normal_y) + v1x;
+    const double new_vy = (-v_normal * normal_y * elasticity + v_perpen * normal_x) + v1y;
+
+    v2x = untouched ? v2x : new_vx;
+    v2y = untouched ? v2y : new_vy;
+
+    // Teleport particle 2 to the surface
+    p2x = untouched ? p2x : p1x + (r1 + r2) * normal_x;
+    p2y = untouched ? p2y : p1y + (r1 + r2) * normal_y;
+  }
+}
+
+HaxBallBatch::HaxBallBatch(int size, bool has_opponent, std::uint64_t seed) :
+  m_has_opponent(has_opponent), m_size(size)
+{
+  // The constants of the game, no environment is required to read them
+  m_left = HaxBallField::SIZE.left();
+  m_right = HaxBallField::SIZE.right();
+  m_top = HaxBallField::SIZE.top();
+  m_bottom = HaxBallField::SIZE.bottom();
+
+  m_goal_left_x0 = HaxBallField::GOAL_LEFT.left();
+  m_goal_left_x1 = HaxBallField::GOAL_LEFT.right();
+  m_goal_left_y0 = HaxBallField::GOAL_LEFT.top();
+  m_goal_left_y1 = HaxBallField::GOAL_LEFT.bottom();
+
+  m_goal_right_x0 = HaxBallField::GOAL_RIGHT.left();
+  m_goal_right_x1 = HaxBallField::GOAL_RIGHT.right();
+  m_goal_right_y0 = HaxBallField::GOAL_RIGHT.top();
+  m_goal_right_y1 = HaxBallField::GOAL_RIGHT.bottom();
+
+  m_goal_right_center_x = HaxBallField::GOAL_RIGHT.centerX();
+  m_goal_right_center_y = HaxBallField::GOAL_RIGHT.centerY();
+
+  m_radius_player = HaxBallField::RADIUS_PLAYER;
+  m_radius_ball = HaxBallField::RADIUS_BALL;
+  m_distance_goalkeeper = HaxBallField::DISTANCE_GOALKEEPER;
+
+  m_sub_dt = HaxBallField::SUB_DT;
+  m_max_speed_player = HaxBallField::MAX_SPEED_PLAYER;
+  m_max_speed_ball = HaxBallField::MAX_SPEED_BALL;
+  m_friction = HaxBallField::FRICTION;
+  m_shoot_dist = HaxBallField::SHOOT_DIST;
+
+  // Exactly the same number of sub steps as HaxBall::step()
+  m_sub_steps = HaxBallField::subSteps();
+
+  m_state.resize(m_size, Eigen::NoChange);
+  m_position_opponent.setZero(m_size, Eigen::NoChange);
+
+  m_wasInLeftGoal.setConstant(m_size, false);
+  m_wasInRightGoal.setConstant(m_size, false);
+  m_num_agent_goals.setZero(m_size);
+  m_num_opponent_goals.setZero(m_size);
+
+  m_random_engines.resize(m_size);
+  this->seed(seed);
+
+  reset();
+}
+HaxBallBatch::~HaxBallBatch(){}
+
+int HaxBallBatch::size() const { return m_size; }
+
+const Eigen::Array<bool, Eigen::Dynamic, 1>& HaxBallBatch::ballWasInLeftGoal() const { return m_wasInLeftGoal; }
+const Eigen::Array<bool, Eigen::Dynamic, 1>& HaxBallBatch::ballWasInRightGoal() const { return m_wasInRightGoal; }
+
+const Eigen::ArrayXi& HaxBallBatch::getAgentGoals() const { return m_num_agent_goals; }
+const Eigen::ArrayXi& HaxBallBatch::getOpponentGoals() const { return m_num_opponent_goals; }
+
+void HaxBallBatch::getState(int i, Eigen::Ref<Eigen::VectorXd> state) const { state = m_state.row(i).transpose(); }
+void HaxBallBatch::getStates(Eigen::Ref<Eigen::MatrixXd> states) const { states = m_state.matrix().transpose(); }
+
+void HaxBallBatch::setState(int i, const Eigen::Ref<const Eigen::VectorXd>& state)
+{
+  if( state(0) < m_left or state(0) > m_right or
+      state(1) < m_top or state(1) > m_bottom or
+      state(2) < m_left or state(2) > m_right or
+      state(3) < m_top or state(3) > m_bottom or
+      state(4) < -m_max_speed_ball or state(4) > +m_max_speed_ball or
+      state(5) < -m_max_speed_ball or state(5) > +m_max_speed_ball )
+  {
+    std::stringstream ss;
+    ss << "Invalid state for haxball: " << state.transpose();
+    throw std::out_of_range(ss.str());
+  }
+
+  m_state.row(i) = state.transpose().array();
+
+  m_wasInLeftGoal(i) = false;
+  m_wasInRightGoal(i) = false;
+  m_num_agent_goals(i) = 0;
+  m_num_opponent_goals(i) = 0;
+}
+
+void HaxBallBatch::setStates(const Eigen::Ref<const Eigen::MatrixXd>& states)
+{
+  for (int i = 0; i < m_size; ++i)
+    setState(i, states.col(i));
+}
+
+void HaxBallBatch::seed(std::uint64_t seed)
+{
+  for (int i = 0; i < m_size; ++i)
+    m_random_engines[i].seed(seed, i);
+}
+
+void HaxBallBatch::reset()
+{
+  // Every environment has its own stream, the result does not depend on the number of threads
+#pragma omp parallel for
+  for (int i = 0; i < m_size; ++i)
+    reset(i);
+}
+
+void HaxBallBatch::reset(int i)
+{
+  Philox4x32& random_engine = m_random_engines[i];
+
+  // Same order of random numbers as in HaxBall::reset()
+  m_state(i, 0) = random_engine.uniform(m_left, m_right);
+  m_state(i, 1) = random_engine.uniform(m_top, m_bottom);
+
+  m_state(i, 2) = random_engine.uniform(m_left, m_right);
+  m_state(i, 3) = random_engine.uniform(m_top, m_bottom);
+
+  m_state(i, 4) = random_engine.uniform(-m_max_speed_ball, +m_max_speed_ball);
+  m_state(i, 5) = random_engine.uniform(-m_max_speed_ball, +m_max_speed_ball);
+
+  // Reset again if player is stuck behind goal keeper
+  const double dx = m_goal_right_center_x - m_state(i, 0), dy = m_goal_right_center_y - m_state(i, 1);
+  if(std::sqrt(dx * dx + dy * dy) < m_distance_goalkeeper)
+    reset(i);
+
+  m_wasInLeftGoal(i) = false;
+  m_wasInRightGoal(i) = false;
+  m_num_agent_goals(i) = 0;
+  m_num_opponent_goals(i) = 0;
+}
+
+void HaxBallBatch::step(const Eigen::Ref<const Eigen::MatrixXd>& actions)
+{
+  if (actions.rows() != getActionDimension() or actions.cols() != m_size)
+  {
+    std::stringstream ss;
+    ss << "Invalid action batch for haxball: " << actions.rows() << " x " << actions.cols();
+    throw std::invalid_argument(ss.str());
+  }
+
+  const int blocks = (m_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+  // Blocks are independent, each thread writes only into its own rows of the structure of arrays
+#pragma omp parallel for
+  for (int b = 0; b < blocks; ++b)
+  {
+    const int begin = b * BLOCK_SIZE;
+    const int n = std::min(BLOCK_SIZE, m_size - begin);
+
+    if(m_has_opponent)
+      stepBlock<true>(begin, n, actions);
+    else
+      stepBlock<false>(begin, n, actions);
+  }
+}
+
+template <bool HasOpponent>
+void HaxBallBatch::stepBlock(int begin, int n, const Eigen::Ref<const Eigen::MatrixXd>& actions)
+{
+  // Local copies of the block, aligned for the vector units
+  alignas(64) double player_x[BLOCK_SIZE], player_y[BLOCK_SIZE], ball_x[BLOCK_SIZE], ball_y[BLOCK_SIZE];
+  alignas(64) double ball_vx[BLOCK_SIZE], ball_vy[BLOCK_SIZE], opponent_x[BLOCK_SIZE], opponent_y[BLOCK_SIZE];
+  alignas(64) double player_vx[BLOCK_SIZE], player_vy[BLOCK_SIZE];
+  alignas(64) int agent_goals[BLOCK_SIZE], opponent_goals[BLOCK_SIZE];
+  alignas(64) int shoot[BLOCK_SIZE], in_left_goal[BLOCK_SIZE], in_right_goal[BLOCK_SIZE];  // int instead of bool, the vectoriser cannot handle bool lanes
+
+  // Determines the size of the action space
+  const double bound = 1.0;
+
+  for (int i = 0; i < n; ++i)
+  {
+    const int e = begin + i;
+
+    player_x[i] = m_state(e, 0);
+    player_y[i] = m_state(e, 1);
+    ball_x[i] = m_state(e, 2);
+    ball_y[i] = m_state(e, 3);
+    ball_vx[i] = m_state(e, 4);
+    ball_vy[i] = m_state(e, 5);
+
+    opponent_x[i] = m_position_opponent(e, 0);
+    opponent_y[i] = m_position_opponent(e, 1);
+
+    agent_goals[i] = m_num_agent_goals(e);
+    opponent_goals[i] = m_num_opponent_goals(e);
+
+    // Parse actions: The action is constant during all sub steps, so it is parsed only once
+    player_vx[i] = m_max_speed_player * std::max(std::min(actions(0, e), bound), -bound);
+    player_vy[i] = m_max_speed_player * std::max(std::min(actions(1, e), bound), -bound);
+    shoot[i] = actions(2, e) > 0.5;
+
+    in_left_goal[i] = false;
+    in_right_goal[i] = false;
+  }
+
+  // Copies of the members, such that the compiler knows that they stay constant in the loop
+  const double friction = m_friction, sub_dt = m_sub_dt;
+  const double left = m_left, right = m_right, top = m_top, bottom = m_bottom;
+  const double goal_x = m_goal_right_center_x, goal_y = m_goal_right_center_y, keeper = m_distance_goalkeeper;
+  const double radius_player = m_radius_player, radius_ball = m_radius_ball;
+  const double max_speed_ball = m_max_speed_ball, shoot_dist = m_shoot_dist;
+  const double gl_x0 = m_goal_left_x0, gl_x1 = m_goal_left_x1, gl_y0 = m_goal_left_y0, gl_y1 = m_goal_left_y1;
+  const double gr_x0 = m_goal_right_x0, gr_x1 = m_goal_right_x1, gr_y0 = m_goal_right_y0, gr_y1 = m_goal_right_y1;
+
+  for (int k = 0; k < m_sub_steps; ++k)
+  {
+#pragma omp simd
+    for (int i = 0; i < n; ++i)
+    {
+      // Same sequence of operations as in HaxBall::subStep(), branches are replaced by selects
+      // and the logical operators do not short circuit, such that there is no control flow in the loop
+      double bvx = ball_vx[i] * friction;
+      double bvy = ball_vy[i] * friction;
+
+      double bx = ball_x[i] + sub_dt * bvx;
+      double by = ball_y[i] + sub_dt * bvy;
+      double px = player_x[i] + sub_dt * player_vx[i];
+      double py = player_y[i] + sub_dt * player_vy[i];
+
+      double ox = opponent_x[i], oy = opponent_y[i];
+
+      if (HasOpponent)
+      {
+        const double dx = px - goal_x, dy = py - goal_y;
+        const double distance = std::sqrt(dx * dx + dy * dy);
+
+        ox = goal_x + keeper * dx / distance;
+        oy = goal_y + keeper * dy / distance;
+      }
+
+      // player-ball
+      collision(px, py, player_vx[i], player_vy[i], radius_player, bx, by, bvx, bvy, radius_ball, 0.33f);
+
+      if (HasOpponent)
+      {
+        // opponent-ball and player-opponent, the velocity of the player is parsed in every sub step, so a change gets lost
+        double pvx = player_vx[i], pvy = player_vy[i];
+        collision(ox, oy, 0.0, 0.0, radius_player, bx, by, bvx, bvy, radius_ball, 1.0f);
+        collision(ox, oy, 0.0, 0.0, radius_player, px, py, pvx, pvy, radius_player, 1.0f);
+      }
+
+      // Reflection at the borders
+      bvx = ((bx < left) | (bx > right)) ? -bvx : bvx;
+      bvy = ((by < top) | (by > bottom)) ? -bvy : bvy;
+
+      // Clipping
+      px = (px < left) ? left : px;
+      px = (px > right) ? right : px;
+      py = (py < top) ? top : py;
+      py = (py > bottom) ? bottom : py;
+
+      bx = (bx < left) ? left : bx;
+      bx = (bx > right) ? right : bx;
+      by = (by < top) ? top : by;
+      by = (by > bottom) ? bottom : by;
+
+      bvx = (bvx < -max_speed_ball) ? -max_speed_ball : bvx;
+      bvx = (bvx > +max_speed_ball) ? +max_speed_ball : bvx;
+      bvy = (bvy < -max_speed_ball) ? -max_speed_ball : bvy;
+      bvy = (bvy > +max_speed_ball) ? +max_speed_ball : bvy;
+
+      // Shooting
+      const double sx = bx - px, sy = by - py;
+      const double distance = std::sqrt(sx * sx + sy * sy);
+      const bool shot = (shoot[i] != 0) & ((distance - radius_player - radius_ball) < shoot_dist) & (distance > 1e-5);
+
+      bvx = shot ? max_speed_ball * sx / distance : bvx;
+      bvy = shot ? max_speed_ball * sy / distance : bvy;
+
+      // Reset ball if stuck with no velocity behind goal keeper
+      const double gx = goal_x - bx, gy = goal_y - by;
+      const bool stuck = (std::sqrt(bvx * bvx + bvy * bvy) < 1e-5) & (std::sqrt(gx * gx + gy * gy) < keeper);
+
+      bx = stuck ? 0.0 : bx;
+      by = stuck ? 0.0 : by;
+
+      // Goals, the rectangles are closed as in QRectF::contains()
+      const bool goal_left = (bx >= gl_x0) & (bx <= gl_x1) & (by >= gl_y0) & (by <= gl_y1);
+      const bool goal_right = (bx >= gr_x0) & (bx <= gr_x1) & (by >= gr_y0) & (by <= gr_y1);
+
+      opponent_goals[i] += goal_left;
+      agent_goals[i] += goal_right;
+
+      in_left_goal[i] = goal_left;
+      in_right_goal[i] = goal_right;
+
+      const bool goal = goal_left | goal_right;
+
+      ball_x[i] = goal ? 0.0 : bx;
+      ball_y[i] = goal ? 0.0 : by;
+      ball_vx[i] = goal ? 0.0 : bvx;
+      ball_vy[i] = goal ? 0.0 : bvy;
+      player_x[i] = px;
+      player_y[i] = py;
+      opponent_x[i] = ox;
+      opponent_y[i] = oy;
+    }
+  }
+
+  // Store the block
+  for (int i = 0; i < n; ++i)
+  {
+    const int e = begin + i;
+
+    m_state(e, 0) = player_x[i];
+    m_state(e, 1) = player_y[i];
+    m_state(e, 2) = ball_x[i];
+    m_state(e, 3) = ball_y[i];
+    m_state(e, 4) = ball_vx[i];
+    m_state(e, 5) = ball_vy[i];
+
+    m_position_opponent(e, 0) = opponent_x[i];
+    m_position_opponent(e, 1) = opponent_y[i];
+
+    m_wasInLeftGoal(e) = in_left_goal[i];
+    m_wasInRightGoal(e) = in_right_goal[i];
+    m_num_agent_goals(e) = agent_goals[i];
+    m_num_opponent_goals(e) = opponent_goals[i];
+  }
+}
@@ -0,0 +1,469 @@
+#include "HaxBallCore.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+template <typename Scalar>
+BasicHaxBallCore<Scalar>::BasicHaxBallCore(bool has_opponent, std::uint64_t seed, std::uint64_t stream) :
+  m_random_engine(seed, stream),
+  m_step_mode(StepMode::FixedSubSteps),
+  m_wasInLeftGoal(false), m_wasInRightGoal(false),
+  m_has_opponent(has_opponent), m_num_agent_goals(0), m_num_opponent_goals(0)
+{
+  m_position_opponent << 0.0, 0.0;
+  m_velocity_opponent << 0.0, 0.0;
+  m_goal_right_center << GOAL_RIGHT.centerX(), GOAL_RIGHT.centerY();
+
+  // Tables in double, rounded once to the scalar type
+  double friction_pow = 1.0, friction_sum = 0.0;
+
+  m_friction_pow[0] = Scalar(friction_pow);
+  m_friction_sum[0] = Scalar(friction_sum);
+
+  for (int k = 1; k <= MAX_SUB_STEPS; ++k)
+  {
+    friction_pow *= HaxBallField::FRICTION;
+    friction_sum += friction_pow;
+
+    m_friction_pow[k] = Scalar(friction_pow);
+    m_friction_sum[k] = Scalar(friction_sum);
+  }
+
+  m_log_friction = std::log(FRICTION);
+
+  reset();
+}
+
+template <typename Scalar>
+void BasicHaxBallCore<Scalar>::setState(const Eigen::Ref<const Vector>& state)
+{
+  if( state(0) < SIZE.left() or state(0) > SIZE.right() or
+      state(1) < SIZE.top() or state(1) > SIZE.bottom() or
+      state(2) < SIZE.left() or state(2) > SIZE.right() or
+      state(3) < SIZE.top() or state(3) > SIZE.bottom() or
+      state(4) < -MAX_SPEED_BALL or state(4) > +MAX_SPEED_BALL or
+      state(5) < -MAX_SPEED_BALL or state(5) > +MAX_SPEED_BALL )
+  {
+    std::stringstream ss;
+    ss << "Invalid state for haxball: " << state.transpose();
+    throw std::out_of_range(ss.str());
+  }
+
+  // Setting the state from the outside invalidates the remaining internal state of the environment
+  resetOthers();
+
+  m_state = state;
+}
+
+template <typename Scalar>
+void BasicHaxBallCore<Scalar>::setState(Scalar player_x, Scalar player_y, Scalar ball_x, Scalar ball_y, Scalar ball_vx, Scalar ball_vy)
+{
+  // Fixed size, lives on the stack
+  State state;
+  state << player_x, player_y, ball_x, ball_y, ball_vx, ball_vy;
+  setState(state);
+}
+
+template <typename Scalar>
+void BasicHaxBallCore<Scalar>::step(const Eigen::Ref<const Vector>& action)
+{
+  // Determines the size of the action space
+  const Scalar bound = 1.0;
+
+  // Parse actions once: Get player velocity in first 2 components and shooting indicator in last component
+  // Also applies clipping to intended action space
+  const Vector2 player_vel = MAX_SPEED_PLAYER * action.segment(0, 2).array().min(bound).max(-bound);
+  const bool shoot = action(2) > 0.5;
+
+  // The only check of the opponent flag, everything below is specialised at compile time
+  if (m_has_opponent)
+    integrate<true>(player_vel, shoot);
+  else
+    integrate<false>(player_vel, shoot);
+}
+
+template <typename Scalar>
+void BasicHaxBallCore<Scalar>::step(const Eigen::Ref<const Vector>& action, StepInfo& info)
+{
+  const int agent_goals = m_num_agent_goals;
+  const int opponent_goals = m_num_opponent_goals;
+
+  step(action);
+
+  info.state_prime = m_state;
+  info.agent_goals = m_num_agent_goals - agent_goals;
+  info.opponent_goals = m_num_opponent_goals - opponent_goals;
+  info.ball_was_in_left_goal = m_wasInLeftGoal;
+  info.ball_was_in_right_goal = m_wasInRightGoal;
+  info.terminal = info.agent_goals > 0 or info.opponent_goals > 0;
+}
+
+template <typename Scalar>
+template <bool HasOpponent>
+void BasicHaxBallCore<Scalar>::integrate(const Vector2& player_vel, bool shoot)
+{
+  if (m_step_mode == StepMode::FixedSubSteps)
+  {
+    for (int k = 0; k < SUB_STEPS; ++k)
+    {
+      subStep<HasOpponent>(player_vel, shoot);
+    }
+
+    return;
+  }
+
+  // Event driven: jump over the quiet parts, resolve the sub steps with a possible event like the fixed scheme
+  int remaining = SUB_STEPS;
+
+  while (remaining > 0)
+  {
+    const int k = freeSubSteps<HasOpponent>(player_vel, shoot, remaining);
+
+    if (k > 0)
+    {
+      advanceFree<HasOpponent>(player_vel, k);
+      remaining -= k;
+    }
+
+    if (remaining > 0)
+    {
+      subStep<HasOpponent>(player_vel, shoot);
+      remaining--;
+    }
+  }
+}
+
+template <typename Scalar>
+template <bool HasOpponent>
+int BasicHaxBallCore<Scalar>::freeSubSteps(const Vector2& player_vel, bool shoot, int remaining) const
+{
+  // Safety margin against rounding in the closed forms, coarser in single precision
+  const Scalar eps = std::max<Scalar>(1e-9, 1000 * std::numeric_limits<Scalar>::epsilon());
+
+  const Vector2 player_pos = m_state.template segment<2>(0);
+  const Vector2 ball_pos = m_state.template segment<2>(2);
+  const Vector2 ball_vel = m_state.template segment<2>(4);
+
+  const Scalar ball_speed = ball_vel.norm();
+  const Scalar player_travel = SUB_DT * player_vel.norm();
+
+  // Velocity clipping is an event (only possible after setting such a state from the outside)
+  if (std::abs(ball_vel(0)) > MAX_SPEED_BALL or std::abs(ball_vel(1)) > MAX_SPEED_BALL)
+    return 0;
+
+  int k = remaining;
+
+  // Player-ball contact, or the shooting range if the player shoots
+  // The ball travels at most speed * f * sub_dt per sub step, since friction is applied before the integration
+  const Scalar range = RADIUS_PLAYER + RADIUS_BALL + (shoot ? SHOOT_DIST : Scalar(0));
+  k = std::min(k, linearFreeSubSteps((ball_pos - player_pos).norm() - range - eps,
+                                     SUB_DT * ball_speed * FRICTION + player_travel, k));
+
+  // Ball leaving the field (reflection), separately per axis
+  for (int i = 0; i < 2 and k > 0; ++i)
+  {
+    const Scalar low = (i == 0) ? SIZE.left() : SIZE.top();
+    const Scalar high = (i == 0) ? SIZE.right() : SIZE.bottom();
+
+    if (ball_vel(i) > 0.0)
+      k = std::min(k, ballFreeSubSteps(high - ball_pos(i) - eps, ball_vel(i), k));
+    else if (ball_vel(i) < 0.0)
+      k = std::min(k, ballFreeSubSteps(ball_pos(i) - low - eps, -ball_vel(i), k));
+
+    // Player leaving the field (clipping)
+    if (player_vel(i) > 0.0)
+      k = std::min(k, linearFreeSubSteps(high - player_pos(i) - eps, SUB_DT * player_vel(i), k));
+    else if (player_vel(i) < 0.0)
+      k = std::min(k, linearFreeSubSteps(player_pos(i) - low - eps, -SUB_DT * player_vel(i), k));
+  }
+
+  // Ball entering a goal, distance to the closed rectangles
+  for (const Rect* goal : {&GOAL_LEFT, &GOAL_RIGHT})
+  {
+    const Scalar dx = std::max({goal->left() - ball_pos(0), Scalar(0), ball_pos(0) - goal->right()});
+    const Scalar dy = std::max({goal->top() - ball_pos(1), Scalar(0), ball_pos(1) - goal->bottom()});
+
+    k = std::min(k, ballFreeSubSteps(std::sqrt(dx * dx + dy * dy) - eps, ball_speed, k));
+  }
+
+  const Scalar ball_goal_distance = (ball_pos - m_goal_right_center).norm();
+
+  // Ball getting stuck behind the goal keeper, only possible once the ball is slow enough
+  if (ball_speed * m_friction_pow[remaining] < 1e-5)
+    k = std::min(k, ballFreeSubSteps(ball_goal_distance - DISTANCE_GOALKEEPER - eps, ball_speed, k));
+
+  if (HasOpponent and k > 0)
+  {
+    const Scalar player_goal_distance = (player_pos - m_goal_right_center).norm();
+
+    // Player-opponent: The opponent sits on the ray from the goal center through the player,
+    // so their distance is exactly | |p - g| - keeper distance |
+    k = std::min(k, linearFreeSubSteps(std::abs(player_goal_distance - DISTANCE_GOALKEEPER) - 2.0 * RADIUS_PLAYER - eps,
+                                       player_travel, k));
+
+    // Opponent-ball: The opponent lives on a circle around the goal center, the ball has to cross it
+    const Scalar ball_range = RADIUS_PLAYER + RADIUS_BALL;
+    int k_ball = ballFreeSubSteps(std::abs(ball_goal_distance - DISTANCE_GOALKEEPER) - ball_range - eps, ball_speed, k);
+
+    // Alternative bound with the actual opponent position: the opponent follows the direction to the player,
+    // it moves at most keeper distance * player travel / (closest distance between player and goal center)
+    const Scalar closest = player_goal_distance - k * player_travel;
+
+    if (closest > 0.0)
+    {
+      const Vector2 opponent_pos = m_goal_right_center + DISTANCE_GOALKEEPER * (player_pos - m_goal_right_center) / player_goal_distance;
+      const Scalar opponent_travel = DISTANCE_GOALKEEPER * player_travel / closest;
+
+      k_ball = std::max(k_ball, linearFreeSubSteps((ball_pos - opponent_pos).norm() - ball_range - eps,
+                                                   SUB_DT * ball_speed * FRICTION + opponent_travel, k));
+    }
+
+    k = std::min(k, k_ball);
+  }
+
+  return k;
+}
+
+template <typename Scalar>
+int BasicHaxBallCore<Scalar>::ballFreeSubSteps(Scalar gap, Scalar speed, int remaining) const
+{
+  if (gap <= 0.0)
+    return 0;
+
+  const Scalar travel = SUB_DT * speed;
+
+  if (travel * m_friction_sum[remaining] < gap)
+    return remaining;
+
+  // Without friction the motion is linear
+  if (FRICTION >= 1.0)
+    return linearFreeSubSteps(gap, travel, remaining);
+
+  // travel * f (1 - f^j) / (1 - f) < gap  <=>  f^j > q
+  const Scalar q = Scalar(1) - gap * (1.0 - FRICTION) / (FRICTION * travel);
+
+  if (q <= 0.0)
+    return remaining;
+
+  const int j = static_cast<int>(std::ceil(std::log(q) / m_log_friction)) - 1;
+
+  return std::max(0, std::min(j, remaining));
+}
+
+template <typename Scalar>
+int BasicHaxBallCore<Scalar>::linearFreeSubSteps(Scalar gap, Scalar travel, int remaining) const
+{
+  if (gap <= 0.0)
+    return 0;
+
+  if (travel * remaining < gap)
+    return remaining;
+
+  // travel * j < gap
+  const int j = static_cast<int>(std::ceil(gap / travel)) - 1;
+
+  return std::max(0, std::min(j, remaining));
+}
+
+template <typename Scalar>
+template <bool HasOpponent>
+void BasicHaxBallCore<Scalar>::advanceFree(const Vector2& player_vel, int k)
+{
+  // Closed form of k sub steps: v_k = f^k v_0 and b_k = b_0 + sub_dt (f + ... + f^k) v_0
+  m_state.template segment<2>(2) += (SUB_DT * m_friction_sum[k]) * m_state.template segment<2>(4);
+  m_state.template segment<2>(4) *= m_friction_pow[k];
+  m_state.template segment<2>(0) += (k * SUB_DT) * player_vel;
+
+  if(HasOpponent)
+  {
+    m_position_opponent = m_state.template segment<2>(0) - m_goal_right_center;
+    m_position_opponent = m_goal_right_center + DISTANCE_GOALKEEPER * m_position_opponent / m_position_opponent.norm();
+  }
+
+  // No goal in a free sub step
+  m_wasInLeftGoal = false;
+  m_wasInRightGoal = false;
+}
+
+template <typename Scalar>
+template <bool HasOpponent>
+void BasicHaxBallCore<Scalar>::subStep(const Vector2& player_vel_action, bool shoot)
+{
+  Vector2 player_pos = m_state.template segment<2>(0);
+  Vector2 ball_pos = m_state.template segment<2>(2);
+  Vector2 ball_vel = m_state.template segment<2>(4);
+
+  // The player-opponent collision writes into the velocity, work on a copy
+  Vector2 player_vel = player_vel_action;
+
+  // friction is a percentage, i.e., what part of the velocity "survives"
+  // Currently, there is no integration of accelerations required, e.g. wind.
+  ball_vel = ball_vel * FRICTION;
+
+  // Euler integration for position
+  ball_pos = ball_pos + SUB_DT * ball_vel;
+  player_pos = player_pos + SUB_DT * player_vel;
+
+  if(HasOpponent)
+  {
+    // Define opponent position to be between goal and ball
+    // Since it is defined exclusively by the player position, the opponent is NOT part of the state vector
+    m_position_opponent = player_pos - m_goal_right_center;
+    // One meter away from goal center (well if distance is set to 1m)
+    m_position_opponent = m_goal_right_center + DISTANCE_GOALKEEPER * m_position_opponent / m_position_opponent.norm();
+  }
+
+  // handle player-ball collision, player is inf heavy mass so the ball gets the velocity
+  collision(player_pos, player_vel, RADIUS_PLAYER,
+            ball_pos, ball_vel, RADIUS_BALL, 0.33f);
+
+  if(HasOpponent)
+  {
+    // handle opponent-ball collision, opponent is inf heavy mass so the ball gets the velocity
+    collision(m_position_opponent, m_velocity_opponent, RADIUS_PLAYER,
+              ball_pos, ball_vel, RADIUS_BALL, 1.0f);
+
+    // handle player-opponent collision, both are infinte heavy ...
+    // opponent stays in place, player is projected to the outside
+    collision(m_position_opponent, m_velocity_opponent, RADIUS_PLAYER,
+              player_pos, player_vel, RADIUS_PLAYER, 1.0f);
+  }
+
+  // Collision with infinite heavy borders -> reflection for ball
+  if( ball_pos(0) < SIZE.left() or ball_pos(0) > SIZE.right())
+    ball_vel(0) *= -1.0;
+
+  if( ball_pos(1) < SIZE.top() or ball_pos(1) > SIZE.bottom())
+    ball_vel(1) *= -1.0;
+
+  // Clip position to keep player and ball on the screen
+  if (player_pos(0) < SIZE.left()) player_pos(0) = SIZE.left();
+  if (player_pos(0) > SIZE.right()) player_pos(0) = SIZE.right();
+  if (player_pos(1) < SIZE.top()) player_pos(1) = SIZE.top();
+  if (player_pos(1) > SIZE.bottom()) player_pos(1) = SIZE.bottom();
+
+  if (ball_pos(0) < SIZE.left()) ball_pos(0) = SIZE.left();
+  if (ball_pos(0) > SIZE.right()) ball_pos(0) = SIZE.right();
+  if (ball_pos(1) < SIZE.top()) ball_pos(1) = SIZE.top();
+  if (ball_pos(1) > SIZE.bottom()) ball_pos(1) = SIZE.bottom();
+
+  if (ball_vel(0) < -MAX_SPEED_BALL) ball_vel(0) = -MAX_SPEED_BALL;
+  if (ball_vel(0) > +MAX_SPEED_BALL) ball_vel(0) = +MAX_SPEED_BALL;
+  if (ball_vel(1) < -MAX_SPEED_BALL) ball_vel(1) = -MAX_SPEED_BALL;
+  if (ball_vel(1) > +MAX_SPEED_BALL) ball_vel(1) = +MAX_SPEED_BALL;
+
+  // Handle shooting, if ball is in range its velocity gets overwritten
+  Vector2 diff = ball_pos - player_pos;
+  Scalar distance = diff.norm();
+
+  if (shoot and (distance - RADIUS_PLAYER - RADIUS_BALL) < SHOOT_DIST and distance > 1e-5)
+    ball_vel = MAX_SPEED_BALL * diff / distance;
+
+  // Reset ball if stuck with no velocity behind goal keeper
+  if(ball_vel.norm() < 1e-5 and (m_goal_right_center - ball_pos).norm() < DISTANCE_GOALKEEPER )
+    ball_pos.fill(0.0);
+
+  // Store this indicators to be able to tell what happened during the execution of step()
+  m_wasInLeftGoal = GOAL_LEFT.contains(ball_pos(0), ball_pos(1));
+  m_wasInRightGoal = GOAL_RIGHT.contains(ball_pos(0), ball_pos(1));
+
+  if(m_wasInLeftGoal) m_num_opponent_goals++;
+  if(m_wasInRightGoal) m_num_agent_goals++;
+
+  // Reset ball position to center without velocity if it touches a goal area
+  if(m_wasInLeftGoal or m_wasInRightGoal)
+  {
+    ball_pos.fill(0.0);
+    ball_vel.fill(0.0);
+  }
+
+  // Store the updated state as single vector (for the agent to process)
+  // Not using the setter here to avoid the unneccessary boundary check and the call to resetOthers()
+  m_state <<
+      player_pos(0), player_pos(1),
+      ball_pos(0), ball_pos(1),
+      ball_vel(0), ball_vel(1);
+}
+
+template <typename Scalar>
+void BasicHaxBallCore<Scalar>::reset()
+{
+  // Rejection sampling instead of the recursion: Redraw if player is stuck behind goal keeper
+  do
+  {
+    m_state(0) = random_number(SIZE.left(), SIZE.right());
+    m_state(1) = random_number(SIZE.top(), SIZE.bottom());
+
+    m_state(2) = random_number(SIZE.left(), SIZE.right());
+    m_state(3) = random_number(SIZE.top(), SIZE.bottom());
+
+    m_state(4) = random_number(-MAX_SPEED_BALL, +MAX_SPEED_BALL);
+    m_state(5) = random_number(-MAX_SPEED_BALL, +MAX_SPEED_BALL);
+  }
+  while((m_goal_right_center - m_state.template segment<2>(0)).norm() < DISTANCE_GOALKEEPER);
+
+  resetOthers();
+}
+
+template <typename Scalar>
+void BasicHaxBallCore<Scalar>::resetOthers()
+{
+  m_wasInLeftGoal = false;
+  m_wasInRightGoal = false;
+
+  m_num_agent_goals = 0;
+  m_num_opponent_goals = 0;
+}
+
+template <typename Scalar>
+void BasicHaxBallCore<Scalar>::collision(const Vector2& p1, const Vector2& v1, Scalar r1,
+                                         Vector2& p2, Vector2& v2, Scalar r2,
+                                         const float elasticity) const
+{
+  // Work in particel 1's coordinate frame to make things easier
+  Vector2 p2_in_1 = p2 - p1;
+  Vector2 v2_in_1 = v2 - v1;
+
+  Scalar distance = p2_in_1.norm();
+
+  // Early out such that p2 and v2 remain unchanged, applies to:
+  // - No collision
+  // - ball and player at same position (avoid zero division)
+  if (distance > r1 + r2 or distance < 1e-5)
+    return;
+
+  // A rotated coordinate system, which makes resolving the collision trivial
+  Vector2 normal = p2_in_1 / distance;
+  Vector2 perpen; perpen << -normal(1), normal(0);
+
+  // Project the movement of Particle 2 on this coordinate system
+  Scalar v_normal = normal.dot(v2_in_1);
+  Scalar v_perpen = perpen.dot(v2_in_1);
+
+  // Reflections == Flipped normal velocity
+  // 100% Elastic: Ball gets full velocity
+  //   0% Elastic: Ball looses velocity, it goes completely to inf havy particle p1
+  Vector2 v2_new_normal = -v_normal * normal * Scalar(elasticity);
+
+  // Perpendicular direction is not affected
+  Vector2 v2_new_perpen = v_perpen * perpen;
+
+  // Superposition is new velocity after collision, back to world frame
+  v2 = v2_new_normal + v2_new_perpen + v1;
+
+  // Finally, fix intersection by teleporting particle p2 to the surface
+  p2 = p1 + (r1 + r2) * normal;
+}
+
+template <typename Scalar>
+Scalar BasicHaxBallCore<Scalar>::random_number(Scalar low, Scalar high)
+{
+  return m_random_engine.uniform<Scalar>(low, high);
+}
+
+// The only two precisions of the simulation, see HaxBallCore and HaxBallCoreF
+template class BasicHaxBallCore<float>;
+template class BasicHaxBallCore<double>;
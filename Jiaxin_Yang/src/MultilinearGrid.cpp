@@ -0,0 +1,120 @@
+#include "MultilinearGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+MultilinearGrid::MultilinearGrid(int state_dimension) :
+  m_state_dimension(state_dimension), m_points(1)
+{
+
+}
+
+int MultilinearGrid::addDimension(int component, double low, double high, double resolution)
+{
+  if (component < 0 or component >= m_state_dimension or not (high > low) or not (resolution > 0.0)
+      or getDimensions() >= MAX_DIMENSIONS)
+  {
+    std::stringstream ss;
+    ss << "Invalid dimension for the multilinear grid: component " << component << ", range [" << low << ", "
+       << high << "], resolution " << resolution << ", " << getDimensions() << " dimensions so far";
+    throw std::invalid_argument(ss.str());
+  }
+
+  Dimension dimension;
+
+  dimension.component = component;
+  dimension.low = low;
+  dimension.inverse = 1.0 / resolution;
+  dimension.high = (high - low) * dimension.inverse;
+  dimension.points = std::max<std::int64_t>(static_cast<std::int64_t>(std::ceil(dimension.high)) + 1, 2);
+  dimension.stride = m_points;
+
+  if (m_points > std::numeric_limits<int>::max() / dimension.points)
+  {
+    std::stringstream ss;
+    ss << "Too many points for the multilinear grid: " << dimension.points << " more along component " << component;
+    throw std::invalid_argument(ss.str());
+  }
+
+  m_points *= dimension.points;
+  m_dimensions.push_back(dimension);
+
+  return getDimensions() - 1;
+}
+
+Eigen::MatrixXd MultilinearGrid::getLayout() const
+{
+  Eigen::MatrixXd layout(4, getDimensions());
+
+  for (int d = 0; d < getDimensions(); ++d)
+  {
+    const Dimension& dimension = m_dimensions[d];
+    layout.col(d) << dimension.component, dimension.low, dimension.low + dimension.high / dimension.inverse, 1.0 / dimension.inverse;
+  }
+
+  return layout;
+}
+
+void MultilinearGrid::corners(const Eigen::Ref<const Eigen::VectorXd>& state,
+                              Eigen::Ref<Eigen::VectorXi> corners, Eigen::Ref<Eigen::VectorXd> weights) const
+{
+  corners(0) = 0;
+  weights(0) = 1.0;
+
+  for (int d = 0, n = 1; d < getDimensions(); ++d, n *= 2)
+  {
+    const Dimension& dimension = m_dimensions[d];
+    const double u = std::max(0.0, std::min((state(dimension.component) - dimension.low) * dimension.inverse, dimension.high));
+
+    // The last cell is closed, the upper border belongs to it
+    const int cell = static_cast<int>(std::min(static_cast<std::int64_t>(u), dimension.points - 2));
+
+    split(corners.data(), weights.data(), n, cell * static_cast<int>(dimension.stride), static_cast<int>(dimension.stride), u - cell);
+  }
+}
+
+void MultilinearGrid::cornersBatch(const Eigen::Ref<const Eigen::MatrixXd>& states,
+                                   Eigen::Ref<CornerMatrix> corners, Eigen::Ref<WeightMatrix> weights) const
+{
+  if (corners.rows() != getCorners() or corners.cols() != states.cols()
+      or weights.rows() != getCorners() or weights.cols() != states.cols())
+  {
+    std::stringstream ss;
+    ss << "Invalid batch for the multilinear grid: " << corners.rows() << " x " << corners.cols() << " corners and "
+       << weights.rows() << " x " << weights.cols() << " weights for " << states.cols() << " states and "
+       << getCorners() << " corners";
+    throw std::invalid_argument(ss.str());
+  }
+
+  // Component by component over all states: clipping, the cell and the fraction, one row per dimension
+  Eigen::ArrayXXi offsets(getDimensions(), states.cols());
+  Eigen::ArrayXXd fractions(getDimensions(), states.cols());
+  Eigen::ArrayXd u(states.cols());
+  Eigen::ArrayXi cell(states.cols());
+
+  for (int d = 0; d < getDimensions(); ++d)
+  {
+    const Dimension& dimension = m_dimensions[d];
+
+    u = ((states.row(dimension.component).transpose().array() - dimension.low) * dimension.inverse).max(0.0).min(dimension.high);
+    cell = u.cast<int>().min(static_cast<int>(dimension.points - 2));
+    fractions.row(d) = (u - cell.cast<double>()).transpose();
+    offsets.row(d) = (cell * static_cast<int>(dimension.stride)).transpose();
+  }
+
+  // Then the corners of every state, contiguous in its column
+  for (Eigen::Index i = 0; i < states.cols(); ++i)
+  {
+    int* state_corners = &corners(0, i);
+    double* state_weights = &weights(0, i);
+
+    state_corners[0] = 0;
+    state_weights[0] = 1.0;
+
+    for (int d = 0, n = 1; d < getDimensions(); ++d, n *= 2)
+      split(state_corners, state_weights, n, offsets(d, i), static_cast<int>(m_dimensions[d].stride), fractions(d, i));
+  }
+}
@@ -0,0 +1,99 @@
+#include "MultilinearQ.h"
+
+const double MultilinearQ::ALPHA = 0.1;
+const double MultilinearQ::GAMMA = 0.9;
+const double MultilinearQ::EPSILON = 0.1;
+const int MultilinearQ::TRAJECTORIES = 1000;
+const int MultilinearQ::STEPS = 100;
+const char* const MultilinearQ::CHECKPOINT_KIND = "MultilinearQ";
+
+MultilinearQ::MultilinearQ(double position_resolution, double velocity_resolution, std::uint64_t seed) :
+  LinearQ(seed)
+{
+  m_grid.addDimension(0, HaxBallField::SIZE.left(), HaxBallField::SIZE.right(), position_resolution);
+  m_grid.addDimension(1, HaxBallField::SIZE.top(), HaxBallField::SIZE.bottom(), position_resolution);
+  m_grid.addDimension(2, HaxBallField::SIZE.left(), HaxBallField::SIZE.right(), position_resolution);
+  m_grid.addDimension(3, HaxBallField::SIZE.top(), HaxBallField::SIZE.bottom(), position_resolution);
+  m_grid.addDimension(4, -HaxBallField::MAX_SPEED_BALL, HaxBallField::MAX_SPEED_BALL, velocity_resolution);
+  m_grid.addDimension(5, -HaxBallField::MAX_SPEED_BALL, HaxBallField::MAX_SPEED_BALL, velocity_resolution);
+
+  m_weights.setZero(PADDED_ACTIONS, m_grid.getSize());
+}
+
+MultilinearQ::~MultilinearQ()
+{
+
+}
+
+void MultilinearQ::activate(const Eigen::Ref<const Eigen::VectorXd>& state, Features& cells) const
+{
+  cells.corners.resize(m_grid.getCorners(), 1);
+  cells.weights.resize(m_grid.getCorners(), 1);
+  m_grid.corners(state, cells.corners.col(0), cells.weights.col(0));
+}
+
+void MultilinearQ::activateBatch(const Eigen::Ref<const Eigen::MatrixXd>& states, Features& cells) const
+{
+  cells.corners.resize(m_grid.getCorners(), states.cols());
+  cells.weights.resize(m_grid.getCorners(), states.cols());
+  m_grid.cornersBatch(states, cells.corners, cells.weights);
+}
+
+MultilinearQ::ActionValues MultilinearQ::actionValues(const Features& cells, int k) const
+{
+  const int* corners = &cells.corners(0, k);
+  const double* weights = &cells.weights(0, k);
+
+  // Fixed size columns, every multiply add is a handful of SIMD instructions
+  ActionValues q = weights[0] * m_weights.col(corners[0]);
+
+  for (Eigen::Index c = 1; c < cells.corners.rows(); ++c)
+    q += weights[c] * m_weights.col(corners[c]);
+
+  return q;
+}
+
+MultilinearQ::ActionValues MultilinearQ::actionValuesAtomic(const Features& cells, int k) const
+{
+  // Each value is read once, no SIMD, but consistent while other threads update
+  ActionValues q = ActionValues::Zero();
+
+  for (Eigen::Index c = 0; c < cells.corners.rows(); ++c)
+  {
+    const double* values = &m_weights(0, cells.corners(c, k));
+
+    for (int a = 0; a < ACTIONS; ++a)
+    {
+      double value;
+#pragma omp atomic read
+      value = values[a];
+      q(a) += cells.weights(c, k) * value;
+    }
+  }
+
+  return q;
+}
+
+void MultilinearQ::update(const Features& cells, int k, int action, double target)
+{
+  // Atomic reads, the values change while other threads train
+  double q = 0.0;
+
+  for (Eigen::Index c = 0; c < cells.corners.rows(); ++c)
+  {
+    double value;
+#pragma omp atomic read
+    value = m_weights(action, cells.corners(c, k));
+    q += cells.weights(c, k) * value;
+  }
+
+  // Corner c moves by delta * w_c, the interpolation by delta * sum w_c^2 = ALPHA * (target - q)
+  const double delta = ALPHA * (target - q) / cells.weights.col(k).squaredNorm();
+
+  for (Eigen::Index c = 0; c < cells.corners.rows(); ++c)
+  {
+    double* value = &m_weights(action, cells.corners(c, k));
+#pragma omp atomic update
+    *value += delta * cells.weights(c, k);
+  }
+}
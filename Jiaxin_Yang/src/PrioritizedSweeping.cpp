@@ -0,0 +1,270 @@
+#include "PrioritizedSweeping.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include <omp.h>
+
+#include "RewardFunctions.h"
+
+const std::uint64_t PrioritizedSweeping::REPORT_INTERVAL = 100000;
+
+PrioritizedSweeping::PrioritizedSweeping(double position_resolution, double velocity_resolution, int samples, std::uint64_t seed,
+                                         bool symmetric) :
+  ValueIteration(position_resolution, velocity_resolution, samples, seed, symmetric),
+  m_queue(2 * omp_get_max_threads()), m_distance_weight(1.0), m_goal_weight(1.0), m_plans(0)
+{
+
+}
+
+PrioritizedSweeping::~PrioritizedSweeping()
+{
+
+}
+
+double PrioritizedSweeping::reward(const Eigen::Ref<const Eigen::VectorXd>& s,
+                                   const Eigen::Ref<const Eigen::VectorXd>& action,
+                                   const Eigen::Ref<const Eigen::VectorXd>& s_prime) const
+{
+  return m_distance_weight * Reward::distance_player_ball_dense(s, action, s_prime)
+      + m_goal_weight * Reward::ball_in_goal(s, action, s_prime);
+}
+
+void PrioritizedSweeping::setRewardWeights(double distance, double goal)
+{
+  m_distance_weight = distance;
+  m_goal_weight = goal;
+
+  if (not hasModel())
+    return;
+
+  const std::vector<std::uint32_t> changed = updateRewards();
+  m_dirty.insert(m_dirty.end(), changed.begin(), changed.end());
+}
+
+void PrioritizedSweeping::buildPredecessors()
+{
+  const std::size_t cells = m_cells.size();
+
+  // Counting sort of the transitions by successor, in increasing order of the predecessor
+  std::vector<std::uint64_t> offsets(cells + 1, 0);
+
+  for (std::size_t c = 0; c < cells; ++c)
+    for (std::uint64_t i = m_offsets[c * ACTIONS]; i < m_offsets[(c + 1) * ACTIONS]; ++i)
+      if (m_successors[i] != TERMINAL and m_successors[i] != c)
+        offsets[m_successors[i] + 1]++;
+
+  for (std::size_t c = 0; c < cells; ++c)
+    offsets[c + 1] += offsets[c];
+
+  std::vector<std::uint32_t> predecessors(offsets[cells]);
+  std::vector<float> probabilities(offsets[cells]);
+  std::vector<std::uint64_t> next(offsets.begin(), offsets.end() - 1);
+
+  for (std::size_t c = 0; c < cells; ++c)
+  {
+    for (std::uint64_t i = m_offsets[c * ACTIONS]; i < m_offsets[(c + 1) * ACTIONS]; ++i)
+    {
+      // The backups solve the self loops, see greedyFixedPoint()
+      if (m_successors[i] == TERMINAL or m_successors[i] == c)
+        continue;
+
+      const std::uint64_t j = next[m_successors[i]]++;
+
+      predecessors[j] = static_cast<std::uint32_t>(c);
+      probabilities[j] = m_probabilities[i];
+    }
+  }
+
+  // One entry per predecessor with the largest probability over its actions
+  m_predecessor_offsets.assign(cells + 1, 0);
+  m_predecessors.clear();
+  m_predecessor_weights.clear();
+
+  for (std::size_t c = 0; c < cells; ++c)
+  {
+    for (std::uint64_t i = offsets[c]; i < offsets[c + 1]; ++i)
+    {
+      const float weight = static_cast<float>(GAMMA * probabilities[i]);
+
+      if (m_predecessors.size() > m_predecessor_offsets[c] and m_predecessors.back() == predecessors[i])
+        m_predecessor_weights.back() = std::max(m_predecessor_weights.back(), weight);
+      else
+      {
+        m_predecessors.push_back(predecessors[i]);
+        m_predecessor_weights.push_back(weight);
+      }
+    }
+
+    m_predecessor_offsets[c + 1] = m_predecessors.size();
+  }
+
+  m_predecessors.shrink_to_fit();
+  m_predecessor_weights.shrink_to_fit();
+}
+
+void PrioritizedSweeping::raise(std::uint32_t cell, double change, double threshold, Philox4x32& random_engine)
+{
+  double bound;
+
+#pragma omp atomic capture
+  bound = m_bounds[cell] += change;
+
+  if (bound <= threshold)
+    return;
+
+  // Only the thread which sets the flag queues the cell
+  std::uint8_t queued;
+
+#pragma omp atomic capture
+  {
+    queued = m_queued[cell];
+    m_queued[cell] = 1;
+  }
+
+  if (not queued)
+    m_queue.push(cell, bound, random_engine);
+}
+
+std::uint64_t PrioritizedSweeping::plan(double threshold, std::uint64_t max_backups)
+{
+  if (not hasModel())
+    buildModel();
+
+  if (m_predecessors.empty())
+  {
+    buildPredecessors();
+
+    m_bounds.assign(m_cells.size(), 0.0);
+    m_queued.assign(m_cells.size(), 0);
+    m_dirty.resize(m_cells.size());
+
+    for (std::size_t c = 0; c < m_cells.size(); ++c)
+      m_dirty[c] = static_cast<std::uint32_t>(c);
+  }
+
+  const std::uint64_t plan_seed = Philox4x32::deriveSeed(m_seed, m_plans++);
+  const auto start = std::chrono::steady_clock::now();
+
+  std::atomic<std::uint64_t> backups(0);
+  std::atomic<int> busy(0);
+  std::uint64_t next_report = REPORT_INTERVAL;
+
+  m_progress.clear();
+
+  // Thread 0 records the progress
+  auto report = [&]()
+  {
+    Progress progress;
+
+    progress.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    progress.backups = backups.load(std::memory_order_relaxed);
+    progress.queued = m_queue.getSize();
+    progress.residual = m_queue.getTopPriority();
+
+    m_progress.push_back(progress);
+  };
+
+#pragma omp parallel
+  {
+    Philox4x32 random_engine(plan_seed, omp_get_thread_num());
+
+    // The exact Bellman errors of the cells with a new reward or, in the first call, of all cells
+#pragma omp for schedule(dynamic, 256)
+    for (std::int64_t i = 0; i < static_cast<std::int64_t>(m_dirty.size()); ++i)
+    {
+      const std::uint32_t cell = m_dirty[i];
+      int best_action;
+      double value;
+
+      const double best = greedy<true>(cell, best_action);
+
+#pragma omp atomic read
+      value = m_values[cell];
+
+      raise(cell, std::abs(best - value), threshold, random_engine);
+    }
+
+#pragma omp single
+    {
+      m_dirty.clear();
+      report();
+    }
+
+    PriorityMultiQueue::Entry entry;
+
+    while (backups.load(std::memory_order_relaxed) < max_backups)
+    {
+      if (omp_get_thread_num() == 0 and backups.load(std::memory_order_relaxed) >= next_report)
+      {
+        report();
+        next_report += REPORT_INTERVAL;
+      }
+
+      busy.fetch_add(1, std::memory_order_acq_rel);
+
+      if (not m_queue.pop(random_engine, entry))
+      {
+        busy.fetch_sub(1, std::memory_order_acq_rel);
+
+        // Done if no other thread is backing up a cell, which could queue more
+        if (busy.load(std::memory_order_acquire) == 0 and m_queue.getSize() == 0)
+          break;
+
+        std::this_thread::yield();
+        continue;
+      }
+
+      const std::uint32_t cell = entry.item;
+
+      // Reset before the backup reads the values, changes of the successors from now on count again
+#pragma omp atomic write
+      m_bounds[cell] = 0.0;
+
+#pragma omp atomic write
+      m_queued[cell] = 0;
+
+      int best_action;
+      double value;
+
+      const double best = greedyFixedPoint(cell, best_action);
+
+#pragma omp atomic capture
+      {
+        value = m_values[cell];
+        m_values[cell] = best;
+      }
+
+#pragma omp atomic write
+      m_policy[cell] = static_cast<std::uint8_t>(best_action);
+
+      backups.fetch_add(1, std::memory_order_relaxed);
+
+      // The Bellman errors of the predecessors changed by at most weight * delta
+      const double delta = std::abs(best - value);
+
+      if (delta > 0.0)
+        for (std::uint64_t i = m_predecessor_offsets[cell]; i < m_predecessor_offsets[cell + 1]; ++i)
+          raise(m_predecessors[i], m_predecessor_weights[i] * delta, threshold, random_engine);
+
+      busy.fetch_sub(1, std::memory_order_acq_rel);
+    }
+  }
+
+  report();
+  m_residual = m_progress.back().residual;
+
+  return backups.load();
+}
+
+std::size_t PrioritizedSweeping::memoryUsage() const
+{
+  return ValueIteration::memoryUsage()
+      + sizeof(std::uint64_t) * m_predecessor_offsets.size()
+      + sizeof(std::uint32_t) * m_predecessors.size()
+      + sizeof(float) * m_predecessor_weights.size()
+      + sizeof(double) * m_bounds.size()
+      + sizeof(std::uint8_t) * m_queued.size();
+}
@@ -0,0 +1,106 @@
+#include "PriorityMultiQueue.h"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+const double PriorityMultiQueue::EMPTY = -std::numeric_limits<double>::infinity();
+
+PriorityMultiQueue::PriorityMultiQueue(int heaps) : m_size(0)
+{
+  if (heaps < 1)
+  {
+    std::stringstream ss;
+    ss << "Invalid number of heaps for a priority multi queue: " << heaps;
+    throw std::invalid_argument(ss.str());
+  }
+
+  for (int i = 0; i < heaps; ++i)
+  {
+    m_heaps.emplace_back(new Heap);
+    m_heaps.back()->top.store(EMPTY, std::memory_order_relaxed);
+  }
+}
+
+void PriorityMultiQueue::push(std::uint32_t item, double priority, Philox4x32& random_engine)
+{
+  Heap& heap = *m_heaps[random_engine() % m_heaps.size()];
+
+  // Counted first, pop() may find the item before push() returns
+  m_size.fetch_add(1, std::memory_order_acq_rel);
+
+  std::lock_guard<std::mutex> lock(heap.mutex);
+
+  heap.entries.push_back(Entry{priority, item});
+  std::push_heap(heap.entries.begin(), heap.entries.end());
+  heap.top.store(heap.entries.front().priority, std::memory_order_relaxed);
+}
+
+bool PriorityMultiQueue::tryPop(Heap& heap, Entry& entry)
+{
+  std::unique_lock<std::mutex> lock(heap.mutex, std::try_to_lock);
+
+  if (not lock.owns_lock() or heap.entries.empty())
+    return false;
+
+  std::pop_heap(heap.entries.begin(), heap.entries.end());
+  entry = heap.entries.back();
+  heap.entries.pop_back();
+  heap.top.store(heap.entries.empty() ? EMPTY : heap.entries.front().priority, std::memory_order_relaxed);
+
+  m_size.fetch_sub(1, std::memory_order_acq_rel);
+
+  return true;
+}
+
+bool PriorityMultiQueue::pop(Philox4x32& random_engine, Entry& entry)
+{
+  const std::size_t heaps = m_heaps.size();
+
+  while (getSize() > 0)
+  {
+    // Two random choices, the larger top wins
+    for (int attempt = 0; attempt < 4; ++attempt)
+    {
+      Heap* first = m_heaps[random_engine() % heaps].get();
+      Heap* second = m_heaps[random_engine() % heaps].get();
+
+      if (second->top.load(std::memory_order_relaxed) > first->top.load(std::memory_order_relaxed))
+        std::swap(first, second);
+
+      if (first->top.load(std::memory_order_relaxed) != EMPTY and tryPop(*first, entry))
+        return true;
+    }
+
+    // Few items left or much contention, look at every heap once
+    const std::size_t start = random_engine() % heaps;
+
+    for (std::size_t i = 0; i < heaps; ++i)
+      if (tryPop(*m_heaps[(start + i) % heaps], entry))
+        return true;
+  }
+
+  return false;
+}
+
+double PriorityMultiQueue::getTopPriority() const
+{
+  double top = EMPTY;
+
+  for (const auto& heap : m_heaps)
+    top = std::max(top, heap->top.load(std::memory_order_relaxed));
+
+  return top == EMPTY ? 0.0 : top;
+}
+
+void PriorityMultiQueue::clear()
+{
+  for (auto& heap : m_heaps)
+  {
+    heap->entries.clear();
+    heap->top.store(EMPTY, std::memory_order_relaxed);
+  }
+
+  m_size.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,223 @@
+#include "QLambda.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include "HaxBallCore.h"
+
+const double QLambda::ALPHA = 0.1;
+const double QLambda::EPSILON = 0.1;
+const int QLambda::TRAJECTORIES = 1000;
+const int QLambda::STEPS = 100;
+
+QLambda::QLambda(double lambda, double discount, double threshold, std::uint64_t seed, bool full_state, bool symmetric) :
+  QLearning(seed, full_state, symmetric), m_lambda(lambda), m_discount(discount), m_threshold(threshold), m_steps(0), m_updates(0)
+{
+  if (not (lambda >= 0.0 and lambda <= 1.0) or not (discount >= 0.0 and discount < 1.0)
+      or not (threshold > 0.0 and threshold <= 1.0))
+  {
+    std::stringstream ss;
+    ss << "Invalid parameters of Q(lambda): lambda " << lambda << ", discount " << discount
+       << ", threshold " << threshold;
+    throw std::invalid_argument(ss.str());
+  }
+}
+
+QLambda::~QLambda()
+{
+
+}
+
+void QLambda::visit(std::vector<Trace>& traces, std::uint64_t cell, int action)
+{
+  // Replacing traces: the other actions of the cell were not taken here, their traces end
+  traces.erase(std::remove_if(traces.begin(), traces.end(), [cell](const Trace& t) { return t.cell == cell; }),
+               traces.end());
+  traces.push_back(Trace{cell, action, 1.0});
+}
+
+template <typename TableType>
+std::uint64_t QLambda::updateTraces(TableType& qTable, std::vector<Trace>& traces, double delta, double decay)
+{
+  const std::uint64_t updates = traces.size();
+  std::size_t kept = 0;
+
+  for (const Trace& t : traces)
+  {
+    qTable.atomicAdd(t.cell, t.action, ALPHA * delta * t.trace);
+
+    // Compacted in place, the list stays in the order of the visits
+    const double trace = t.trace * decay;
+
+    if (trace >= m_threshold)
+      traces[kept++] = Trace{t.cell, t.action, trace};
+  }
+
+  traces.resize(kept);
+
+  return updates;
+}
+
+void QLambda::training()
+{
+  std::visit([this](auto& table) { training(table); }, qTable);
+}
+
+template <typename TableType>
+void QLambda::training(TableType& qTable)
+{
+  const int actions = ACTIONS_PER_AXIS * ACTIONS_PER_AXIS;
+  std::uint64_t steps = 0, updates = 0;
+
+  // Every step can visit a new cell, the table must not grow while the threads share it
+  reserveCells(static_cast<std::uint64_t>(TRAJECTORIES) * STEPS);
+
+  // Stream i of the first seed starts trajectory i, stream i of the second one explores in it
+  const std::uint64_t iteration_seed = Philox4x32::deriveSeed(m_seed, m_iteration++);
+  const std::uint64_t exploration_seed = Philox4x32::deriveSeed(iteration_seed, 1);
+
+  // All threads update the shared Q-table with atomic operations, no locks (Hogwild)
+#pragma omp parallel for reduction(+:steps, updates)
+  for (int i = 0; i < TRAJECTORIES; ++i)
+  {
+    HaxBallCore env(true, iteration_seed, i);
+    Philox4x32 random_engine(exploration_seed, i);
+    HaxBallCore::StepInfo info;
+
+    Eigen::VectorXd
+        state(env.getStateDimension()),
+        action(env.getActionDimension());
+
+    // Epsilon greedy on atomic reads of the Q-table
+    auto choose = [&](std::uint64_t cell)
+    {
+      if (random_engine.uniform<double>() < EPSILON)
+        return static_cast<int>(random_engine() % actions);
+
+      return qTable.bestActionAtomic(cell);
+    };
+
+    std::vector<Trace> traces;
+    traces.reserve(64);
+
+    // The cells and actions of the table and the traces are the canonical ones
+    bool mirrored, mirrored_prime;
+
+    env.getState(state);
+    std::uint64_t cell = canonicalIndex(state, mirrored);
+    int a = choose(cell);
+
+    for (int j = 0; j < STEPS; ++j)
+    {
+      const std::pair<int, int> velocity = mirrored ? mirrorAction(actionPair(a)) : actionPair(a);
+      action << velocity.first, velocity.second, 1.0;
+      env.step(action, info);
+
+      const std::uint64_t cell_prime = canonicalIndex(info.state_prime, mirrored_prime);
+      const double r = reward(roundedState(state), state);
+
+      visit(traces, cell, a);
+
+      double delta = r - qTable.atomicLoad(cell, a);
+      double decay = 0.0;
+      int a_prime;
+
+      // A goal ends the episode, the ball is back in the center and nothing is bootstrapped
+      if (info.terminal)
+        a_prime = choose(cell_prime);
+      else
+      {
+        const int best = qTable.bestActionAtomic(cell_prime);
+        a_prime = choose(cell_prime);
+        delta += m_discount * qTable.atomicLoad(cell_prime, best);
+
+        // Watkins: the traces follow the greedy policy only, an exploratory action ends them
+        if (a_prime == best)
+          decay = m_discount * m_lambda;
+      }
+
+      updates += updateTraces(qTable, traces, delta, decay);
+
+      state = info.state_prime;
+      cell = cell_prime;
+      mirrored = mirrored_prime;
+      a = a_prime;
+    }
+
+    steps += STEPS;
+  }
+
+  m_steps += steps;
+  m_updates += updates;
+}
+
+void QLambda::trainingBatched()
+{
+  std::visit([this](auto& table) { trainingBatched(table); }, qTable);
+}
+
+template <typename TableType>
+void QLambda::trainingBatched(TableType& qTable)
+{
+  const int actions = ACTIONS_PER_AXIS * ACTIONS_PER_AXIS;
+
+  reserveCells(static_cast<std::uint64_t>(TRAJECTORIES) * STEPS);
+
+  const std::uint64_t iteration_seed = Philox4x32::deriveSeed(m_seed, m_iteration++);
+  const std::uint64_t exploration_seed = Philox4x32::deriveSeed(iteration_seed, 1);
+
+#pragma omp parallel for
+  for (int i = 0; i < TRAJECTORIES; ++i)
+  {
+    HaxBallCore env(true, iteration_seed, i);
+    Philox4x32 random_engine(exploration_seed, i);
+    HaxBallCore::StepInfo info;
+
+    Eigen::VectorXd
+        state(env.getStateDimension()),
+        action(env.getActionDimension());
+
+    Trajectory trajectory(STEPS);
+    std::vector<std::uint64_t> cells(STEPS);
+    std::vector<int> taken(STEPS);
+
+    bool mirrored, mirrored_prime;
+
+    env.getState(state);
+    std::uint64_t cell = canonicalIndex(state, mirrored);
+    int best = qTable.bestActionAtomic(cell);
+
+    for (int j = 0; j < STEPS; ++j)
+    {
+      // Epsilon greedy, the greedy action was found with the value of the last step
+      const int a = random_engine.uniform<double>() < EPSILON ? static_cast<int>(random_engine() % actions) : best;
+      const std::pair<int, int> velocity = mirrored ? mirrorAction(actionPair(a)) : actionPair(a);
+
+      action << velocity.first, velocity.second, 1.0;
+      env.step(action, info);
+
+      const std::uint64_t cell_prime = canonicalIndex(info.state_prime, mirrored_prime);
+
+      best = qTable.bestActionAtomic(cell_prime);
+      trajectory.append(reward(roundedState(state), state), qTable.atomicLoad(cell_prime, best), info.terminal);
+
+      cells[j] = cell;
+      taken[j] = a;
+
+      state = info.state_prime;
+      cell = cell_prime;
+      mirrored = mirrored_prime;
+    }
+
+    trajectory.compute(m_discount, STEPS, m_lambda);
+
+    const Eigen::ArrayXd& targets = trajectory.getLambdaReturns();
+
+    for (int j = 0; j < STEPS; ++j)
+      qTable.atomicAdd(cells[j], taken[j], ALPHA * (targets(j) - qTable.atomicLoad(cells[j], taken[j])));
+  }
+
+  m_steps += static_cast<std::uint64_t>(TRAJECTORIES) * STEPS;
+  m_updates += static_cast<std::uint64_t>(TRAJECTORIES) * STEPS;
+}
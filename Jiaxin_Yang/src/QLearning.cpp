@@ -1,20 +1,34 @@
 #include "QLearning.h"
+#include <algorithm>
 #include <cmath>
 #include <limits>
+#include <stdexcept>
 #include <iostream>
 #include <fstream>
 
-#include <QApplication>
-#include <QDebug>
 #include <Eigen/Dense>
 
-#include "HaxBall.h"
-#include "HaxBallGui.h"
+#include "Checkpoint.h"
+#include "HaxBallCore.h"
+#include "Symmetry.h"
 
-#include "RandomSearch.h"
-#include "DummyAgent.h"
+const double QLearning::RESOLUTION = 1.0;
+const double QLearning::MAX_DISTANCE_X = 8.0;
+const double QLearning::MAX_DISTANCE_Y = 4.0;
+const double QLearning::RESOLUTION_BALL = 0.5;
+const double QLearning::RESOLUTION_VELOCITY = 1.0;
+const char* const QLearning::CHECKPOINT_KIND = "QLearning";
 
-QLearning::QLearning() : qTable(createQTable())
+namespace
+{
+  /// The state of the training in a checkpoint
+  struct TrainingState
+  {
+    std::uint64_t seed, iteration, full_state, index_range;
+  };
+}
+
+QLearning::QLearning(std::uint64_t seed, bool full_state, bool symmetric) : m_seed(seed), m_iteration(0), m_full_state(full_state), m_symmetric(symmetric), m_discretizer(createDiscretizer(full_state)), qTable(createQTable(full_state))
 {
   //std::ifstream file("rewards.csv");
   //std::ifstream file("qtable.csv");
@@ -29,70 +43,105 @@ QLearning::~QLearning()
   outfile.close();
 }
 
+Discretizer QLearning::createDiscretizer(bool full_state)
+{
+  Discretizer discretizer;
+  Eigen::VectorXd weights(HaxBallField::STATE_DIMENSION);
+
+  // Player minus ball position, x and y
+  weights << 1.0, 0.0, -1.0, 0.0, 0.0, 0.0;
+  discretizer.addDimension(weights, -MAX_DISTANCE_X, MAX_DISTANCE_X, RESOLUTION);
+
+  weights << 0.0, 1.0, 0.0, -1.0, 0.0, 0.0;
+  discretizer.addDimension(weights, -MAX_DISTANCE_Y, MAX_DISTANCE_Y, RESOLUTION);
+
+  // Ball position and velocity, about 4e6 cells, the sparse Q-table stores only the visited ones
+  if (full_state)
+  {
+    discretizer.addDimension(2, HaxBallField::SIZE.left(), HaxBallField::SIZE.right(), RESOLUTION_BALL);
+    discretizer.addDimension(3, HaxBallField::SIZE.top(), HaxBallField::SIZE.bottom(), RESOLUTION_BALL);
+    discretizer.addDimension(4, -HaxBallField::MAX_SPEED_BALL, HaxBallField::MAX_SPEED_BALL, RESOLUTION_VELOCITY);
+    discretizer.addDimension(5, -HaxBallField::MAX_SPEED_BALL, HaxBallField::MAX_SPEED_BALL, RESOLUTION_VELOCITY);
+  }
+
+  return discretizer;
+}
+
 // Function to create and initialize the Q-table
-QTable QLearning::createQTable()
+QLearning::Table QLearning::createQTable(bool full_state)
 {
-  QTable qTable;
-  // Initialize all Q-values to 0
-  for (int x1 = -8; x1 <= 8; x1+= 1) {
-    for (int y1 = -4; y1 <= 4; y1+= 1) {
-      std::pair<int, int> state_distance = std::make_pair(x1, y1);
-      for (int x2 = -1; x2 <= 1; x2+= 1) {
-        for (int y2 = -1; y2 <= 1; y2+= 1) {
-          std::pair<int, int> action = std::make_pair(x2, y2);
-          qTable[state_distance][action] = 0.0; // Initialize Q-value to 0
-        }
-      }
-    }
-  }  
-  return qTable;  
+  const int actions = ACTIONS_PER_AXIS * ACTIONS_PER_AXIS;
+
+  // One column per velocity command, all Q-values 0 until a cell gets visited, the table grows with the training
+  if (full_state)
+    return SparseQTable(actions, 1024, 0.0);
+
+  // The 17 x 9 offset cells fit into a direct lookup, one row per cell index of the discretizer
+  return QTable(static_cast<int>(createDiscretizer(false).getIndexRange()), 1, actions, 0.0);
 }
 
-double QLearning::calculateAverageQValue(const QTable& qTable) const
+void QLearning::reserveCells(std::uint64_t cells)
 {
-  double sumQValues = 0.0;
-  int numValues = 0;
+  if (SparseQTable* sparse = std::get_if<SparseQTable>(&qTable))
+    sparse->reserve(std::min<std::uint64_t>(sparse->getSize() + cells, m_discretizer.getCells()));
+}
 
-  for (const auto& stateAction : qTable)
-  {
-    const auto& actionQValues = stateAction.second;
+std::uint64_t QLearning::stateIndex(const Eigen::Ref<const Eigen::VectorXd>& state) const
+{
+  return m_discretizer.index(state);
+}
 
-    for (const auto& actionQValue : actionQValues)
-    {
-      sumQValues += actionQValue.second;
-      numValues++;
-    }
+std::uint64_t QLearning::canonicalIndex(const Eigen::Ref<const Eigen::VectorXd>& state, bool& mirrored) const
+{
+  if (not m_symmetric)
+  {
+    mirrored = false;
+    return m_discretizer.index(state);
   }
 
+  return Symmetry::canonicalIndex(m_discretizer, state, mirrored);
+}
+
+int QLearning::actionIndex(const std::pair<int, int>& action)
+{
+  // Same order as the old std::map: sorted by x first, then by y
+  return (action.first + 1) * ACTIONS_PER_AXIS + (action.second + 1);
+}
+
+std::pair<int, int> QLearning::actionPair(int index)
+{
+  return std::make_pair(index / ACTIONS_PER_AXIS - 1, index % ACTIONS_PER_AXIS - 1);
+}
+
+double QLearning::calculateAverageQValue(const QTable& qTable) const
+{
+  double sumQValues = qTable.sum();
+  double numValues = static_cast<double>(qTable.getCells()) * qTable.getActions();
+
   double averageQValue = (numValues > 0) ? (sumQValues / numValues) : 0.0;
   return sumQValues;
 }
 
-std::pair<int, int> QLearning::getBestAction(const QTable& qTable, const std::pair<double, double>& RoundedState) const
+double QLearning::calculateAverageQValue(const SparseQTable& qTable) const
 {
-  // Find the action with the highest Q-value for the given state
-  double maxQValue = std::numeric_limits<double>::lowest();
-  std::pair<int, int> bestAction;
-  // Iterate over the QTable using iterators
-  for (const auto& stateAction : qTable)
-  {
-    const auto& state = stateAction.first;
-    const auto& actionQValues = stateAction.second;
-    if (state == RoundedState)
-    {
-      // Iterate over the action Q-values for the current state
-      for (const auto& actionQValue : actionQValues)
-      {
-        if (actionQValue.second > maxQValue)
-        {
-          maxQValue = actionQValue.second;
-          bestAction = actionQValue.first;
-        }
-      }
-      break; // Found the desired state, no need to continue searching
-    }
-  }
-  return bestAction; 
+  double sumQValues = qTable.sum();
+  double numValues = static_cast<double>(qTable.getSize()) * qTable.getActions();
+
+  double averageQValue = (numValues > 0) ? (sumQValues / numValues) : 0.0;
+  return sumQValues;
+}
+
+template <typename TableType>
+std::pair<int, int> QLearning::getBestAction(const TableType& qTable, std::uint64_t cell) const
+{
+  // Find the action with the highest Q-value for the given state, a direct or a hash lookup of the cell
+  return actionPair(qTable.bestAction(cell));
+}
+
+template <typename TableType>
+std::pair<int, int> QLearning::getBestActionAtomic(const TableType& qTable, std::uint64_t cell) const
+{
+  return actionPair(qTable.bestActionAtomic(cell));
 }
 
 // std::pair<int, int> QLearning::getBestAction(const QTable& qTable, const std::pair<int, int>& RoundedState) const
@@ -111,7 +160,7 @@ std::pair<int, int> QLearning::getBestAction(const QTable& qTable, const std::pa
 //   return bestAction; 
 // }
 
-double QLearning::reward(const std::pair<int, int>& state_distance, const Eigen::Ref<const Eigen::VectorXd>& state)
+double QLearning::reward(const std::pair<double, double>& state_distance, const Eigen::Ref<const Eigen::VectorXd>& state)
 {
   // if (state[2] >= 3.9 && state[3] >= -0.7 && state[3] <= 0.7) {
   //   double x = state_distance.first;
@@ -145,15 +194,15 @@ double QLearning::reward(const std::pair<int, int>& state_distance, const Eigen:
   
 }
 
-void QLearning::updateQTable(const Eigen::Ref<const Eigen::VectorXd>& state, QTable& qTable, const std::pair<int, int>& state_distance, const std::pair<int, int>& action, const std::pair<int, int>& nextState, double learningRate, const double& discountFactor)
+template <typename TableType>
+void QLearning::updateQTable(const Eigen::Ref<const Eigen::VectorXd>& state, TableType& qTable, const std::pair<double, double>& state_distance, std::uint64_t cell, const std::pair<int, int>& action, std::uint64_t nextCell, double learningRate, const double& discountFactor)
 { // Retrieve the current Q-value for the state-action pair
-  double currentQValue = qTable[state_distance][action];
-
-  // Find the best action for the next state
-  std::pair<int, int> bestNextAction = getBestAction(qTable, nextState);
+  // Atomic reads and updates: the training threads share the Q-table (Hogwild)
+  const int column = actionIndex(action);
+  double currentQValue = qTable.atomicLoad(cell, column);
 
-  // Retrieve the Q-value of the best action in the next state
-  double bestNextQValue = qTable[nextState][bestNextAction];
+  // Retrieve the Q-value of the best action in the next state, an unvisited cell is not inserted
+  double bestNextQValue = qTable.maxValueAtomic(nextCell);
 
   // Calculate the reward (you can use the reward function here)
   double rewardvalue = reward(state_distance, state);
@@ -165,13 +214,18 @@ void QLearning::updateQTable(const Eigen::Ref<const Eigen::VectorXd>& state, QTa
 
   //outfile << rewardvalue << std::endl;
 
-  // Apply the Q-learning update rule
-  double newQValue = currentQValue + learningRate * (rewardvalue + discountFactor * bestNextQValue - currentQValue);
-
-  // Update the Q-value in the Q-table
-  qTable[state_distance][action] = newQValue;
+  // Apply the Q-learning update rule as an increment, concurrent updates of the same value add up instead of getting lost,
+  // the cell gets inserted on its first update
+  qTable.atomicAdd(cell, column, learningRate * (rewardvalue + discountFactor * bestNextQValue - currentQValue));
 }
 
+template std::pair<int, int> QLearning::getBestAction<QTable>(const QTable&, std::uint64_t) const;
+template std::pair<int, int> QLearning::getBestAction<SparseQTable>(const SparseQTable&, std::uint64_t) const;
+template std::pair<int, int> QLearning::getBestActionAtomic<QTable>(const QTable&, std::uint64_t) const;
+template std::pair<int, int> QLearning::getBestActionAtomic<SparseQTable>(const SparseQTable&, std::uint64_t) const;
+template void QLearning::updateQTable<QTable>(const Eigen::Ref<const Eigen::VectorXd>&, QTable&, const std::pair<double, double>&, std::uint64_t, const std::pair<int, int>&, std::uint64_t, double, const double&);
+template void QLearning::updateQTable<SparseQTable>(const Eigen::Ref<const Eigen::VectorXd>&, SparseQTable&, const std::pair<double, double>&, std::uint64_t, const std::pair<int, int>&, std::uint64_t, double, const double&);
+
 ////////////////////// change here to distance //////////////////////
 // std::pair<double, double> QLearning::roundedState(const Eigen::Ref<const Eigen::VectorXd>& state) const
 // {
@@ -188,60 +242,136 @@ void QLearning::updateQTable(const Eigen::Ref<const Eigen::VectorXd>& state, QTa
 // }
 std::pair<double, double> QLearning::roundedState(const Eigen::Ref<const Eigen::VectorXd>& state) const
 {
-    int roundedNumber0 = static_cast<int>(std::round(state[0] - state[2])); //distance x --> check the meaning of this
-    int roundedNumber1 = static_cast<int>(std::round(state[1] - state[3])); //distance y --> check the meaning of this
-    int roundedState0 = std::max(-8, std::min(roundedNumber0, 8)); //  check the meaning ot this again
-    int roundedState1 = std::max(-4, std::min(roundedNumber1, 4)); // 
-    return std::make_pair(roundedState0, roundedState1);
+    // Player ball offset, rounded to the grid and clipped, the first two dimensions of the discretizer
+    Eigen::VectorXd values(m_discretizer.getDimensions());
+    m_discretizer.snap(state, values);
+    return std::make_pair(values(0), values(1));
 }
-/***TO DO***/
-/*change the resoulition to 0.5*/
-/***TO DO***/
 
 void QLearning::setAction(const Eigen::Ref<const Eigen::VectorXd>& state,
                           Eigen::Ref<Eigen::VectorXd> action, 
                           const std::pair<int, int>& Bestaction)
 
 {
-  const unsigned int dim = m_world.getStateDimension();
   action << Bestaction.first, Bestaction.second, 0.0;
 }
 
+void QLearning::seed(std::uint64_t seed)
+{
+  m_seed = seed;
+  m_iteration = 0;
+}
+
+void QLearning::save(const std::string& path) const
+{
+  CheckpointWriter writer(CHECKPOINT_KIND);
+
+  writer.addValue("training", TrainingState{m_seed, m_iteration, m_full_state, m_discretizer.getIndexRange()});
+  writer.addValue("symmetric", static_cast<std::uint64_t>(m_symmetric));
+  std::visit([&writer](const auto& table) { table.save(writer, "qtable"); }, qTable);
+
+  writer.write(path);
+}
+
+void QLearning::load(const std::string& path)
+{
+  CheckpointReader reader(path);
+
+  if (reader.getKind() != CHECKPOINT_KIND)
+    throw std::runtime_error("The checkpoint '" + path + "' belongs to a " + reader.getKind() + " agent, not to QLearning");
+
+  const TrainingState state = reader.value<TrainingState>("training");
+  const bool full_state = state.full_state != 0;
+  Discretizer discretizer = createDiscretizer(full_state);
+
+  // The cell indices in the table are only meaningful on the same grid
+  if (discretizer.getIndexRange() != state.index_range)
+    throw std::runtime_error("The checkpoint '" + path + "' was written with a different grid of the Q-table");
+
+  Table table = createQTable(full_state);
+
+  if (SparseQTable* sparse = std::get_if<SparseQTable>(&table))
+    sparse->load(reader, "qtable");
+  else if (reader.has("qtable.keys"))
+  {
+    // Checkpoints of the offset grid written while it had a sparse table, its cells are copied into the dense one
+    QTable& dense = std::get<QTable>(table);
+    SparseQTable stored(dense.getActions());
+    stored.load(reader, "qtable");
+
+    if (stored.getActions() != dense.getActions())
+      throw std::runtime_error("The checkpoint '" + path + "' has a different number of actions");
+
+    for (std::size_t s = 0; s < stored.getSlots(); ++s)
+    {
+      if (stored.key(s) != SparseQTable::EMPTY)
+        std::copy(stored.values(s), stored.values(s) + stored.getActions(), dense.values(static_cast<int>(stored.key(s))));
+    }
+  }
+  else
+    std::get<QTable>(table).load(reader, "qtable");
+
+  qTable = table;
+  m_discretizer = discretizer;
+  m_full_state = full_state;
+
+  // Checkpoints written before the symmetry have none
+  m_symmetric = reader.has("symmetric") and reader.value<std::uint64_t>("symmetric") != 0;
+  m_seed = state.seed;
+  m_iteration = state.iteration;
+}
+
 void QLearning::training()
 {
+    std::visit([this](auto& table) { training(table); }, qTable);
+}
+
+template <typename TableType>
+void QLearning::training(TableType& qTable)
+{
+    const int trajectories = 1000, steps = 100;
     int maingoal = 0;
 
-#pragma omp parallel for
-    for (int i = 0; i < 1000; ++i)
+    // Every step can visit a new cell, the table must not grow while the threads share it
+    reserveCells(trajectories * steps);
+
+    // Trajectory i of this call uses stream i, the start states do not depend on the thread running it
+    const std::uint64_t iteration_seed = Philox4x32::deriveSeed(m_seed, m_iteration++);
+
+    // All threads update the shared Q-table with atomic operations, no locks (Hogwild)
+#pragma omp parallel for reduction(+:maingoal)
+    for (int i = 0; i < trajectories; ++i)
     {
-        HaxBall env;
+        HaxBallCore env(true, iteration_seed, i);
         int goal = 0;
         Eigen::VectorXd
             state(env.getStateDimension()),
-            action(env.getActionDimension()),
-            state_prime(env.getStateDimension());
+            action(env.getActionDimension());
+        HaxBallCore::StepInfo info;
 
-        for (int j = 0; j < 100; ++j)
-        {
-            env.getState(state);
-            std::pair<int, int> RoundedState = roundedState(state);
-            std::pair<int, int> Bestaction = getBestAction(qTable, RoundedState);
-            policy(state, action);
-            env.step(action);
-            env.getState(state_prime);
-            std::pair<int, int> RoundedState_prime = roundedState(state_prime);
-            updateQTable(state, qTable, RoundedState, Bestaction, RoundedState_prime, 0.1, 0.1);
-
-            // if (state[2] >= 3.95 && state[3] >= -0.7 && state[3] <= 0.7)
-            // {
-            //     goal++;
-            // }
-        }
+        env.getState(state);
+        std::pair<double, double> RoundedState = roundedState(state);
+        bool mirrored;
+        std::uint64_t cell = canonicalIndex(state, mirrored);
 
-#pragma omp critical
+        for (int j = 0; j < steps; ++j)
         {
-            maingoal += goal;
+            // The table holds the actions of the canonical cell, the velocity command is mirrored back
+            std::pair<int, int> Bestaction = getBestActionAtomic(qTable, cell);
+            const std::pair<int, int> velocity = mirrored ? mirrorAction(Bestaction) : Bestaction;
+            action << velocity.first, velocity.second, 1.0; // the same as policy(), but safe while other threads update
+            env.step(action, info);
+            std::pair<double, double> RoundedState_prime = roundedState(info.state_prime);
+            std::uint64_t cell_prime = canonicalIndex(info.state_prime, mirrored);
+            updateQTable(state, qTable, RoundedState, cell, Bestaction, cell_prime, 0.1, 0.1);
+
+            goal += info.agent_goals;
+            state = info.state_prime;
+            RoundedState = RoundedState_prime;
+            cell = cell_prime;
         }
+
+        maingoal += goal;
     }
 
    // outfile << static_cast<double>(maingoal) / 1000.0 << std::endl;
@@ -252,8 +382,13 @@ void QLearning::policy(const Eigen::Ref<const Eigen::VectorXd>& state,
                        Eigen::Ref<Eigen::VectorXd> action) const
 {
   // Implementation for the linear policy using state and action
-  std::pair<int, int> RoundedState = roundedState(state);
-  std::pair<int, int> Bestaction = getBestAction(qTable, RoundedState);
+  bool mirrored;
+  const std::uint64_t cell = canonicalIndex(state, mirrored);
+  std::pair<int, int> Bestaction = std::visit([this, cell](const auto& table) { return getBestAction(table, cell); }, qTable);
+
+  if (mirrored)
+    Bestaction = mirrorAction(Bestaction);
+
   action << Bestaction.first, Bestaction.second, 1.0;
 }
 
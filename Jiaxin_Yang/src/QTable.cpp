@@ -0,0 +1,128 @@
+#include "QTable.h"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "Eigen/Dense"
+
+#include "Checkpoint.h"
+
+QTable::QTable(int cells_x, int cells_y, int actions, double value) :
+  m_cells_x(cells_x), m_cells_y(cells_y), m_actions(actions)
+{
+  if (cells_x <= 0 or cells_y <= 0 or actions <= 0)
+  {
+    std::stringstream ss;
+    ss << "Invalid size for the Q-table: " << cells_x << " x " << cells_y << " cells, " << actions << " actions";
+    throw std::invalid_argument(ss.str());
+  }
+
+  const int lines = (actions + LINE - 1) / LINE;
+
+  m_stride = lines * LINE;
+
+  // Padding first, fill() overwrites the actions afterwards
+  Line padding;
+  std::fill(padding.q, padding.q + LINE, std::numeric_limits<double>::lowest());
+
+  m_data.assign(static_cast<size_t>(getCells()) * lines, padding);
+
+  fill(value);
+}
+
+int QTable::bestAction(int cell) const
+{
+  const double* q = values(cell);
+  const double best = maxValue(cell);
+
+  // The first action with the maximum, the same tie breaking as a linear search with '>'
+  int action = 0;
+
+  while (q[action] != best)
+    action++;
+
+  return action;
+}
+
+double QTable::maxValue(int cell) const
+{
+  // Vectorised over the whole padded cell, the padding never wins
+  return Eigen::Map<const Eigen::VectorXd, Eigen::Aligned64>(values(cell), m_stride).maxCoeff();
+}
+
+int QTable::bestActionAtomic(int cell) const
+{
+  // Each value is read once, the result is consistent even if the cell changes meanwhile
+  int action = 0;
+  double best = atomicLoad(cell, 0);
+
+  for (int a = 1; a < m_actions; ++a)
+  {
+    const double q = atomicLoad(cell, a);
+
+    if (q > best)
+    {
+      best = q;
+      action = a;
+    }
+  }
+
+  return action;
+}
+
+double QTable::maxValueAtomic(int cell) const
+{
+  double best = atomicLoad(cell, 0);
+
+  for (int a = 1; a < m_actions; ++a)
+    best = std::max(best, atomicLoad(cell, a));
+
+  return best;
+}
+
+void QTable::fill(double value)
+{
+  for (int c = 0; c < getCells(); ++c)
+    std::fill(values(c), values(c) + m_actions, value);
+}
+
+double QTable::sum() const
+{
+  double sum = 0.0;
+
+  for (int c = 0; c < getCells(); ++c)
+    sum += Eigen::Map<const Eigen::VectorXd, Eigen::Aligned64>(values(c), m_actions).sum();
+
+  return sum;
+}
+
+void QTable::save(CheckpointWriter& writer, const std::string& name) const
+{
+  const Grid grid = {m_cells_x, m_cells_y, m_actions, m_stride};
+
+  writer.addValue(name + ".grid", grid);
+  writer.add(name + ".cells", m_data.data(), m_data.size() * sizeof(Line));
+}
+
+void QTable::load(const CheckpointReader& reader, const std::string& name)
+{
+  const Grid grid = reader.value<Grid>(name + ".grid");
+
+  std::size_t bytes;
+  const Line* lines = static_cast<const Line*>(reader.data(name + ".cells", bytes));
+
+  if (grid.cells_x <= 0 or grid.cells_y <= 0 or grid.actions <= 0
+      or grid.stride != (grid.actions + LINE - 1) / LINE * LINE
+      or bytes != static_cast<std::size_t>(grid.cells_x * grid.cells_y * grid.stride) * sizeof(double))
+    throw std::runtime_error("The Q-table '" + name + "' in the checkpoint is inconsistent");
+
+  m_cells_x = static_cast<int>(grid.cells_x);
+  m_cells_y = static_cast<int>(grid.cells_y);
+  m_actions = static_cast<int>(grid.actions);
+  m_stride = static_cast<int>(grid.stride);
+
+  // The padding is stored too, it still holds the lowest double
+  m_data.assign(lines, lines + bytes / sizeof(Line));
+}
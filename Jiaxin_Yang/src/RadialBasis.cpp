@@ -0,0 +1,321 @@
+#include "RadialBasis.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+#include "Philox.h"
+
+const double RadialBasis::CUTOFF = 2.0;
+
+namespace
+{
+  /// The number of centres whose distances are computed at once, on the stack
+  const int CHUNK = 64;
+}
+
+RadialBasis::RadialBasis(int state_dimension) :
+  m_state_dimension(state_dimension), m_bucketed(0), m_offsets(2, 0)
+{
+
+}
+
+int RadialBasis::addDimension(int component, double low, double high, double width)
+{
+  if (getCentres() > 0)
+    throw std::logic_error("The dimensions of a radial basis cannot change after its centres are set");
+
+  if (component < 0 or component >= m_state_dimension or not (high > low) or not (width > 0.0)
+      or getDimensions() >= MAX_DIMENSIONS)
+  {
+    std::stringstream ss;
+    ss << "Invalid dimension for the radial basis: component " << component << ", range [" << low << ", " << high
+       << "], width " << width;
+    throw std::invalid_argument(ss.str());
+  }
+
+  Dimension dimension;
+
+  dimension.component = component;
+  dimension.low = low;
+  dimension.inverse = 1.0 / width;
+  dimension.high = (high - low) * dimension.inverse;
+  dimension.buckets = static_cast<int>(std::max(std::min(std::ceil(dimension.high / CUTOFF), 1e9), 1.0));
+  dimension.stride = 0;
+
+  m_dimensions.push_back(dimension);
+
+  return getDimensions() - 1;
+}
+
+void RadialBasis::setCentres(const Eigen::Ref<const Eigen::MatrixXd>& centres)
+{
+  if (centres.rows() != getDimensions())
+  {
+    std::stringstream ss;
+    ss << "Invalid centres for the radial basis: " << centres.rows() << " rows for " << getDimensions() << " dimensions";
+    throw std::invalid_argument(ss.str());
+  }
+
+  // Scaled and clipped
+  CentreMatrix scaled(getDimensions(), centres.cols());
+
+  for (int d = 0; d < getDimensions(); ++d)
+  {
+    const Dimension& dimension = m_dimensions[d];
+    scaled.row(d) = ((centres.row(d).array() - dimension.low) * dimension.inverse).max(0.0).min(dimension.high);
+  }
+
+  sortCentres(scaled, false);
+}
+
+void RadialBasis::restoreCentres(const Eigen::Ref<const CentreMatrix>& centres)
+{
+  if (centres.rows() != getDimensions())
+  {
+    std::stringstream ss;
+    ss << "Invalid centres for the radial basis: " << centres.rows() << " rows for " << getDimensions() << " dimensions";
+    throw std::invalid_argument(ss.str());
+  }
+
+  for (int d = 0; d < getDimensions() and centres.cols() > 0; ++d)
+  {
+    if (not (centres.row(d).minCoeff() >= 0.0 and centres.row(d).maxCoeff() <= m_dimensions[d].high))
+    {
+      std::stringstream ss;
+      ss << "Invalid centres for the radial basis: outside of the scaled range [0, " << m_dimensions[d].high
+         << "] of dimension " << d;
+      throw std::invalid_argument(ss.str());
+    }
+  }
+
+  sortCentres(centres, true);
+}
+
+void RadialBasis::sortCentres(const Eigen::Ref<const CentreMatrix>& centres, bool keep_order)
+{
+  // The leading dimensions whose buckets still hold MIN_OCCUPANCY centres on average
+  std::vector<int> strides(getDimensions(), 0);
+  std::int64_t total = 1;
+  int bucketed = 0;
+
+  for (const Dimension& dimension : m_dimensions)
+  {
+    if (total * dimension.buckets * MIN_OCCUPANCY > centres.cols())
+      break;
+
+    strides[bucketed++] = static_cast<int>(total);
+    total *= dimension.buckets;
+  }
+
+  // The bucket of every centre
+  std::vector<int> buckets(centres.cols(), 0);
+
+  for (int d = 0; d < bucketed; ++d)
+    for (Eigen::Index i = 0; i < centres.cols(); ++i)
+      buckets[i] += std::min(static_cast<int>(centres(d, i) / CUTOFF), m_dimensions[d].buckets - 1) * strides[d];
+
+  if (keep_order and not std::is_sorted(buckets.begin(), buckets.end()))
+    throw std::invalid_argument("Invalid centres for the radial basis: not in the order of their buckets");
+
+  // Counting sort by bucket, the order within a bucket stays, sorted centres stay where they are
+  std::vector<int> offsets(total + 1, 0);
+
+  for (int bucket : buckets)
+    offsets[bucket + 1]++;
+
+  for (std::int64_t b = 0; b < total; ++b)
+    offsets[b + 1] += offsets[b];
+
+  if (keep_order)
+    m_centres = centres;
+  else
+  {
+    std::vector<int> next(offsets.begin(), offsets.end() - 1);
+    m_centres.resize(getDimensions(), centres.cols());
+
+    for (Eigen::Index i = 0; i < centres.cols(); ++i)
+      m_centres.col(next[buckets[i]]++) = centres.col(i);
+  }
+
+  for (int d = 0; d < getDimensions(); ++d)
+    m_dimensions[d].stride = strides[d];
+
+  m_bucketed = bucketed;
+  m_offsets.swap(offsets);
+}
+
+void RadialBasis::placeCentres(int count, std::uint64_t seed)
+{
+  Philox4x32 random_engine(seed, 0);
+  Eigen::MatrixXd centres(getDimensions(), count);
+
+  for (int i = 0; i < count; ++i)
+    for (int d = 0; d < getDimensions(); ++d)
+      centres(d, i) = m_dimensions[d].low + random_engine.uniform<double>() * m_dimensions[d].high / m_dimensions[d].inverse;
+
+  setCentres(centres);
+}
+
+Eigen::VectorXd RadialBasis::centre(int i) const
+{
+  Eigen::VectorXd position(getDimensions());
+
+  for (int d = 0; d < getDimensions(); ++d)
+    position(d) = m_centres(d, i) / m_dimensions[d].inverse + m_dimensions[d].low;
+
+  return position;
+}
+
+Eigen::MatrixXd RadialBasis::getLayout() const
+{
+  Eigen::MatrixXd layout(4, getDimensions());
+
+  for (int d = 0; d < getDimensions(); ++d)
+  {
+    const Dimension& dimension = m_dimensions[d];
+    layout.col(d) << dimension.component, dimension.low, dimension.low + dimension.high / dimension.inverse, 1.0 / dimension.inverse;
+  }
+
+  return layout;
+}
+
+void RadialBasis::gather(const Eigen::Ref<const Eigen::VectorXd>& state, std::vector<int>& centres,
+                         std::vector<double>& distances) const
+{
+  const int dimensions = getDimensions();
+
+  if (dimensions == 0 or getCentres() == 0)
+    return;
+
+  // The scaled state and the buckets within the cutoff, at most three per bucketed dimension
+  double u[MAX_DIMENSIONS];
+  int first[MAX_DIMENSIONS], last[MAX_DIMENSIONS], bucket[MAX_DIMENSIONS];
+
+  for (int d = 0; d < dimensions; ++d)
+  {
+    const Dimension& dimension = m_dimensions[d];
+
+    u[d] = std::max(0.0, std::min((state(dimension.component) - dimension.low) * dimension.inverse, dimension.high));
+
+    if (d < m_bucketed)
+    {
+      const int home = std::min(static_cast<int>(u[d] / CUTOFF), dimension.buckets - 1);
+
+      first[d] = std::max(home - 1, 0);
+      last[d] = std::min(home + 1, dimension.buckets - 1);
+      bucket[d] = first[d];
+    }
+  }
+
+  // Without bucketed dimensions all centres are one range
+  if (m_bucketed == 0)
+    first[0] = last[0] = 0;
+
+  double squared[CHUNK], farthest[CHUNK];
+
+  for (;;)
+  {
+    // The buckets along the first dimension are contiguous
+    int base = 0;
+
+    for (int d = 1; d < m_bucketed; ++d)
+      base += bucket[d] * m_dimensions[d].stride;
+
+    const int begin = m_offsets[base + first[0]], end = m_offsets[base + last[0] + 1];
+
+    for (int start = begin; start < end; start += CHUNK)
+    {
+      const int n = std::min(CHUNK, end - start);
+
+      std::fill(squared, squared + n, 0.0);
+      std::fill(farthest, farthest + n, 0.0);
+
+      // Dimension by dimension over contiguous coordinates, vectorises
+      for (int d = 0; d < dimensions; ++d)
+      {
+        const double* row = &m_centres(d, start);
+
+        for (int k = 0; k < n; ++k)
+        {
+          const double delta = row[k] - u[d];
+          squared[k] += delta * delta;
+          farthest[k] = std::max(farthest[k], std::abs(delta));
+        }
+      }
+
+      // Few centres of a range are active, a vectorised count skips most chunks without a branch per centre
+      int active = 0;
+
+      for (int k = 0; k < n; ++k)
+        active += farthest[k] <= CUTOFF;
+
+      for (int k = 0; k < n and active > 0; ++k)
+      {
+        if (farthest[k] <= CUTOFF)
+        {
+          centres.push_back(start + k);
+          distances.push_back(squared[k]);
+        }
+      }
+    }
+
+    // The next combination of the buckets of the other dimensions
+    int d = 1;
+
+    while (d < m_bucketed and bucket[d] == last[d])
+    {
+      bucket[d] = first[d];
+      ++d;
+    }
+
+    if (d >= m_bucketed)
+      break;
+
+    ++bucket[d];
+  }
+}
+
+void RadialBasis::normalise(Features& features)
+{
+  Eigen::Map<Eigen::ArrayXd> weights(features.weights.data(), features.weights.size());
+
+  // All exponentials at once, Eigen vectorises exp()
+  weights = (-0.5 * weights).exp();
+
+  for (int k = 0; k < features.getStates(); ++k)
+  {
+    auto row = weights.segment(features.offsets[k], features.offsets[k + 1] - features.offsets[k]);
+
+    if (row.size() > 0)
+      row /= row.sum();
+  }
+}
+
+void RadialBasis::activate(const Eigen::Ref<const Eigen::VectorXd>& state, Features& features) const
+{
+  features.offsets.assign(1, 0);
+  features.centres.clear();
+  features.weights.clear();
+
+  gather(state, features.centres, features.weights);
+  features.offsets.push_back(static_cast<int>(features.centres.size()));
+
+  normalise(features);
+}
+
+void RadialBasis::activateBatch(const Eigen::Ref<const Eigen::MatrixXd>& states, Features& features) const
+{
+  features.offsets.assign(1, 0);
+  features.centres.clear();
+  features.weights.clear();
+
+  for (Eigen::Index i = 0; i < states.cols(); ++i)
+  {
+    gather(states.col(i), features.centres, features.weights);
+    features.offsets.push_back(static_cast<int>(features.centres.size()));
+  }
+
+  normalise(features);
+}
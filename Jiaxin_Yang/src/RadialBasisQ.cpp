@@ -0,0 +1,147 @@
+#include "RadialBasisQ.h"
+
+#include <sstream>
+#include <stdexcept>
+
+const double RadialBasisQ::POSITION_WIDTH = 0.5;
+const double RadialBasisQ::VELOCITY_WIDTH = 1.0;
+const double RadialBasisQ::ALPHA = 0.1;
+const double RadialBasisQ::GAMMA = 0.9;
+const double RadialBasisQ::EPSILON = 0.1;
+const int RadialBasisQ::TRAJECTORIES = 1000;
+const int RadialBasisQ::STEPS = 100;
+const char* const RadialBasisQ::CHECKPOINT_KIND = "RadialBasisQ";
+
+RadialBasisQ::RadialBasisQ(int centres, std::uint64_t seed) :
+  LinearQ(seed)
+{
+  if (centres <= 0)
+  {
+    std::stringstream ss;
+    ss << "Invalid number of centres for RadialBasisQ: " << centres;
+    throw std::invalid_argument(ss.str());
+  }
+
+  m_basis.addDimension(0, HaxBallField::SIZE.left(), HaxBallField::SIZE.right(), POSITION_WIDTH);
+  m_basis.addDimension(1, HaxBallField::SIZE.top(), HaxBallField::SIZE.bottom(), POSITION_WIDTH);
+  m_basis.addDimension(2, HaxBallField::SIZE.left(), HaxBallField::SIZE.right(), POSITION_WIDTH);
+  m_basis.addDimension(3, HaxBallField::SIZE.top(), HaxBallField::SIZE.bottom(), POSITION_WIDTH);
+  m_basis.addDimension(4, -HaxBallField::MAX_SPEED_BALL, HaxBallField::MAX_SPEED_BALL, VELOCITY_WIDTH);
+  m_basis.addDimension(5, -HaxBallField::MAX_SPEED_BALL, HaxBallField::MAX_SPEED_BALL, VELOCITY_WIDTH);
+
+  // Stream 0 of the seed places the centres, the training derives its own seeds
+  m_basis.placeCentres(centres, seed);
+
+  m_weights.setZero(PADDED_ACTIONS, m_basis.getCentres());
+}
+
+RadialBasisQ::~RadialBasisQ()
+{
+
+}
+
+RadialBasisQ::ActionValues RadialBasisQ::actionValues(const Features& features, int k) const
+{
+  // Fixed size columns, every multiply add is a handful of SIMD instructions
+  ActionValues q = ActionValues::Zero();
+
+  for (int i = features.offsets[k]; i < features.offsets[k + 1]; ++i)
+    q += features.weights[i] * m_weights.col(features.centres[i]);
+
+  return q;
+}
+
+RadialBasisQ::ActionValues RadialBasisQ::actionValuesAtomic(const Features& features, int k) const
+{
+  // Each weight is read once, no SIMD, but consistent while other threads update
+  ActionValues q = ActionValues::Zero();
+
+  for (int i = features.offsets[k]; i < features.offsets[k + 1]; ++i)
+  {
+    const double* weights = &m_weights(0, features.centres[i]);
+
+    for (int a = 0; a < ACTIONS; ++a)
+    {
+      double weight;
+#pragma omp atomic read
+      weight = weights[a];
+      q(a) += features.weights[i] * weight;
+    }
+  }
+
+  return q;
+}
+
+void RadialBasisQ::update(const Features& features, int k, int action, double target)
+{
+  const int begin = features.offsets[k], end = features.offsets[k + 1];
+
+  // Nothing to learn far away from all centres
+  if (begin == end)
+    return;
+
+  // Atomic reads, the weights change while other threads train
+  double q = 0.0, norm = 0.0;
+
+  for (int i = begin; i < end; ++i)
+  {
+    double weight;
+#pragma omp atomic read
+    weight = m_weights(action, features.centres[i]);
+    q += features.weights[i] * weight;
+    norm += features.weights[i] * features.weights[i];
+  }
+
+  // Centre i moves by delta * psi_i, Q(s, a) by delta * sum psi_i^2 = ALPHA * (target - q)
+  const double delta = ALPHA * (target - q) / norm;
+
+  for (int i = begin; i < end; ++i)
+  {
+    double* weight = &m_weights(action, features.centres[i]);
+#pragma omp atomic update
+    *weight += delta * features.weights[i];
+  }
+}
+
+void RadialBasisQ::updateBatch(const Eigen::Ref<const Eigen::MatrixXd>& states, const Eigen::Ref<const Eigen::VectorXi>& actions,
+                               const Eigen::Ref<const Eigen::VectorXd>& targets)
+{
+  if (actions.size() != states.cols() or targets.size() != states.cols()
+      or (actions.size() > 0 and (actions.minCoeff() < 0 or actions.maxCoeff() >= ACTIONS)))
+  {
+    std::stringstream ss;
+    ss << "Invalid batch for RadialBasisQ: " << actions.size() << " actions and " << targets.size() << " targets for "
+       << states.cols() << " states, actions must be in [0, " << ACTIONS << ")";
+    throw std::invalid_argument(ss.str());
+  }
+
+  // All features first, then the updates in order, a later state sees the earlier updates
+  Features features;
+  m_basis.activateBatch(states, features);
+
+  for (int k = 0; k < features.getStates(); ++k)
+    update(features, k, actions(k), targets(k));
+}
+
+void RadialBasisQ::saveSections(CheckpointWriter& writer) const
+{
+  // One centre per row, the transposed rows of the basis are in the column major order of the file without a copy
+  writer.addMatrix("centres", m_basis.getScaledCentres().transpose());
+}
+
+void RadialBasisQ::loadSections(const CheckpointReader& reader, const std::string& path, Eigen::Index features)
+{
+  const Eigen::Map<const Eigen::MatrixXd> centres = reader.matrix("centres");
+
+  if (centres.rows() != features or centres.cols() != m_basis.getDimensions())
+    throw std::runtime_error("The checkpoint '" + path + "' has a different number of centres or dimensions");
+
+  try
+  {
+    m_basis.restoreCentres(centres.transpose());
+  }
+  catch (const std::invalid_argument& e)
+  {
+    throw std::runtime_error("The checkpoint '" + path + "' has invalid centres: " + e.what());
+  }
+}
@@ -6,10 +6,12 @@
 #include <vector>
 #include <numeric>      // std::iota
 #include <algorithm>    // std::sort, std::stable_sort
-#include <QDebug>
+#include <stdexcept>
 
 #include <omp.h>
 
+#include "Checkpoint.h"
+#include "HaxBallBatch.h"
 #include "RewardFunctions.h"
 #include "eigenmvn.h" // Multivariate Normal Distribution
 
@@ -17,6 +19,7 @@ const unsigned int RandomSearch::N_TOTAL = 10'000;
 const unsigned int RandomSearch::N_KEEP = 1000;
 const unsigned int RandomSearch::TAU = 100;
 const double RandomSearch::GAMMA = 0.9;
+const char* const RandomSearch::CHECKPOINT_KIND = "RandomSearch";
 
 
 template <typename T>
@@ -37,10 +40,11 @@ std::vector<size_t> sort_indexes(const std::vector<T> &v)
   return idx;
 }
 
-RandomSearch::RandomSearch()
+RandomSearch::RandomSearch(std::uint64_t seed) :
+  m_seed(seed), m_iteration(0)
 {
   // No clue where to start, but should not matter due to sampling with huge covariance in beginning
-  m_parameters.resize(m_world.getStateDimension() * m_world.getActionDimension());
+  m_parameters.resize(HaxBallField::STATE_DIMENSION * HaxBallField::ACTION_DIMENSION);
   m_parameters.fill(0.0);
   
 
@@ -53,6 +57,44 @@ RandomSearch::~RandomSearch()
 }
 
 
+void RandomSearch::seed(std::uint64_t seed)
+{
+  m_seed = seed;
+  m_iteration = 0;
+}
+
+void RandomSearch::save(const std::string& path) const
+{
+  CheckpointWriter writer(CHECKPOINT_KIND);
+
+  writer.addMatrix("parameters", m_parameters);
+  writer.addMatrix("covariance", m_covariance);
+  writer.addValue("seed", m_seed);
+  writer.addValue("iteration", m_iteration);
+
+  writer.write(path);
+}
+
+void RandomSearch::load(const std::string& path)
+{
+  CheckpointReader reader(path);
+
+  if (reader.getKind() != CHECKPOINT_KIND)
+    throw std::runtime_error("The checkpoint '" + path + "' belongs to a " + reader.getKind() + " agent, not to RandomSearch");
+
+  const Eigen::Map<const Eigen::MatrixXd> parameters = reader.matrix("parameters");
+  const Eigen::Map<const Eigen::MatrixXd> covariance = reader.matrix("covariance");
+
+  if (parameters.rows() != m_parameters.rows() or parameters.cols() != 1
+      or covariance.rows() != m_parameters.rows() or covariance.cols() != m_parameters.rows())
+    throw std::runtime_error("The checkpoint '" + path + "' has parameters of a different size");
+
+  m_parameters = parameters;
+  m_covariance = covariance;
+  m_seed = reader.value<std::uint64_t>("seed");
+  m_iteration = reader.value<std::uint64_t>("iteration");
+}
+
 void RandomSearch::policy(const Eigen::Ref<const Eigen::VectorXd>& state,
                           Eigen::Ref<Eigen::VectorXd> action) const
 {
@@ -65,7 +107,7 @@ void RandomSearch::policy(const Eigen::Ref<const Eigen::VectorXd>& state,
                           const Eigen::Ref<const Eigen::VectorXd>& parameters,
                           Eigen::Ref<Eigen::VectorXd> action) const
 {
-  const unsigned int dim = m_world.getStateDimension();
+  const unsigned int dim = HaxBallField::STATE_DIMENSION;
 
   double a1,a2,a3;
 
@@ -86,6 +128,23 @@ void RandomSearch::policy(const Eigen::Ref<const Eigen::VectorXd>& state,
   action << a1, a2, a3;
 }
 
+void RandomSearch::policyBatch(const Eigen::Ref<const Eigen::MatrixXd>& states,
+                               Eigen::Ref<Eigen::MatrixXd> actions) const
+{
+  // The parameter vector holds the rows of A one after another, i.e. it is A in row major order
+  const Eigen::Map<const Eigen::Matrix<double, HaxBallField::ACTION_DIMENSION, HaxBallField::STATE_DIMENSION, Eigen::RowMajor>>
+      A(m_parameters.data());
+
+  checkColumns("actions", actions.cols(), states.cols());
+
+  // One matrix product for all states
+  actions.noalias() = A * states;
+
+  // Same clipping as in policy()
+  actions.topRows(2) = actions.topRows(2).cwiseMax(-1.0).cwiseMin(1.0);
+  actions.row(2) = actions.row(2).cwiseMax(0.0).cwiseMin(1.0);
+}
+
 double RandomSearch::reward(const Eigen::Ref<const Eigen::VectorXd>& state,
                           const Eigen::Ref<const Eigen::VectorXd>& action,
                           const Eigen::Ref<const Eigen::VectorXd>& state_prime) const
@@ -109,48 +168,65 @@ Eigen::VectorXd RandomSearch::getQfactor(const Eigen::Ref<const Eigen::VectorXd>
   return Q;
 }
 
+void RandomSearch::rewardBatch(const Eigen::Ref<const Eigen::MatrixXd>& states,
+                               const Eigen::Ref<const Eigen::MatrixXd>& actions,
+                               const Eigen::Ref<const Eigen::MatrixXd>& states_prime,
+                               Eigen::Ref<Eigen::VectorXd> rewards) const
+{
+  checkColumns("actions", actions.cols(), states.cols());
+  checkColumns("states_prime", states_prime.cols(), states.cols());
+  checkColumns("rewards", rewards.rows(), states.cols());
+
+  // Qualified call: no virtual dispatch, the reward gets inlined
+  for (Eigen::Index i = 0; i < states.cols(); ++i)
+    rewards(i) = RandomSearch::reward(states.col(i), actions.col(i), states_prime.col(i));
+}
+
 void RandomSearch::training()
 {
+  // Random numbers of this iteration: stream 0 for the particles, stream 1 for the seed of the environments
+  // Nothing depends on the thread which draws a number, hence the result is the same for any number of threads
+  const std::uint64_t iteration_seed = Philox4x32::deriveSeed(m_seed, m_iteration++);
+
   // Draw particles from multivariate Gaussian:
   // https://ros-developer.com/2017/11/15/generating-multivariate-normal-distribution-samples-using-c11-eigen-library/
   // https://github.com/beniz/eigenmvn
-  Eigen::EigenMultivariateNormal<double> normal(m_parameters, m_covariance);
+  Eigen::EigenMultivariateNormal<double> normal(m_parameters, m_covariance, false, iteration_seed, 0);
   Eigen::MatrixXd particles = normal.samples(RandomSearch::N_TOTAL);  // 18 x 500
 
-  std::vector<double> scores(RandomSearch::N_TOTAL);
+  std::vector<double> scores(RandomSearch::N_TOTAL, 0.0);
 
   // Rollouts as in the eval center, but since the policy is changed for each particle there is no easy way to reuse existing code ...
-#pragma omp parallel for
-  for (int i = 0; i < RandomSearch::N_TOTAL; ++i)
+  // All particles run in lockstep in one batch of environments, which is initialised randomly
+  HaxBallBatch envs(RandomSearch::N_TOTAL, true, Philox4x32::deriveSeed(iteration_seed, 1));
+
+  // Variables to store the s,a,s' tuples, one column per particle
+  Eigen::MatrixXd
+      states(envs.getStateDimension(), RandomSearch::N_TOTAL),
+      actions(envs.getActionDimension(), RandomSearch::N_TOTAL),
+      states_prime(envs.getStateDimension(), RandomSearch::N_TOTAL);
+
+  // Discount of step j, updated multiplicatively
+  double discount = 1.0;
+
+  // Create rollouts (finite horizon approximation for infinite horizon, choose TAU long or GAMMA small enough
+  for(unsigned int j = 0; j < RandomSearch::TAU ; ++j)
   {
-    // One step reward and accumulator for discounted return
-    double r, R = 0.0;
-
-    // Required in worker thread to keep the internal states of the environment separated
-    // Initialises the environment randomly
-    HaxBall env;
-
-    // Variables to store the s,a,s' tuple, one copy per worker thread
-    Eigen::VectorXd
-        state(env.getStateDimension()),
-        action(env.getActionDimension()),
-        state_prime(env.getStateDimension());
-
-    // Create rollout (finite horizon approximation for infinite horizon, choose TAU long or GAMMA small enough
-    for(int j = 0; j < RandomSearch::TAU ; ++j)
-    {
-      env.getState(state);
-      // std::cout << "State: " << state << std::endl;
-      policy(state, particles.col(i), action);
-      std::cout << "Action: " << action << std::endl;
-      env.step(action);
-      env.getState(state_prime);
-      // std::cout << "State_prime: " << state_prime << std::endl;
-      r = reward(state, action, state_prime);
-      R += std::pow(RandomSearch::GAMMA, j) * r;
-    }
-
-    scores[i] = R;
+    envs.getStates(states);
+
+#pragma omp parallel for
+    for (unsigned int i = 0; i < RandomSearch::N_TOTAL; ++i)
+      policy(states.col(i), particles.col(i), actions.col(i));
+
+    envs.step(actions);
+    envs.getStates(states_prime);
+
+    // Qualified call: no virtual dispatch, the reward gets inlined
+#pragma omp parallel for
+    for (unsigned int i = 0; i < RandomSearch::N_TOTAL; ++i)
+      scores[i] += discount * RandomSearch::reward(states.col(i), actions.col(i), states_prime.col(i));
+
+    discount *= RandomSearch::GAMMA;
   }
 
   // Sort particles according to their scores
@@ -0,0 +1,274 @@
+#include "ReplayBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+const double ReplayBuffer::PRIORITY_EPSILON = 1e-6;
+
+ReplayBuffer::ReplayBuffer(std::size_t capacity, double alpha, int state_dimension, int action_dimension) :
+  m_capacity(capacity), m_state_dimension(state_dimension), m_action_dimension(action_dimension), m_alpha(alpha),
+  m_next(0), m_stamps(capacity), m_leaves(1), m_max_priority(1.0)
+{
+  if (capacity == 0 or not (alpha >= 0.0) or state_dimension < 1 or action_dimension < 1)
+  {
+    std::stringstream ss;
+    ss << "Invalid replay buffer: capacity " << capacity << ", alpha " << alpha << ", dimensions "
+       << state_dimension << " and " << action_dimension;
+    throw std::invalid_argument(ss.str());
+  }
+
+  for (auto& stamp : m_stamps)
+    stamp.store(0, std::memory_order_relaxed);
+
+  m_states.setZero(state_dimension, capacity);
+  m_actions.setZero(action_dimension, capacity);
+  m_states_prime.setZero(state_dimension, capacity);
+  m_rewards.setZero(capacity);
+  m_dones.setZero(capacity);
+
+  while (m_leaves < capacity)
+    m_leaves *= 2;
+
+  m_tree.assign(2 * m_leaves, 0.0);
+}
+
+std::size_t ReplayBuffer::getSize() const
+{
+  return static_cast<std::size_t>(std::min<std::uint64_t>(m_next.load(std::memory_order_relaxed), m_capacity));
+}
+
+std::size_t ReplayBuffer::append(const Eigen::Ref<const Eigen::VectorXd>& state,
+                                 const Eigen::Ref<const Eigen::VectorXd>& action,
+                                 double reward,
+                                 const Eigen::Ref<const Eigen::VectorXd>& state_prime,
+                                 bool done)
+{
+  // The only synchronisation between the actors: every append gets its own ticket and slot
+  const std::uint64_t ticket = m_next.fetch_add(1, std::memory_order_relaxed);
+  const std::size_t slot = static_cast<std::size_t>(ticket % m_capacity);
+
+  // Claim the slot with an odd stamp. If the actor a full buffer earlier is still writing here, wait for it, if a
+  // later actor took the slot already, this transition is older than everything in the buffer and gets dropped.
+  std::uint64_t stamp = m_stamps[slot].load(std::memory_order_relaxed);
+
+  do
+  {
+    if (stamp > 2 * ticket)
+      return m_capacity;
+
+    if (stamp % 2 == 1)
+      stamp = m_stamps[slot].load(std::memory_order_relaxed);
+  }
+  while (stamp % 2 == 1 or not m_stamps[slot].compare_exchange_weak(stamp, 2 * ticket + 1, std::memory_order_relaxed));
+
+  std::atomic_thread_fence(std::memory_order_release);
+
+  // Not sampled while being written, readers who already picked the slot see the odd stamp
+  setPriority(slot, 0.0);
+
+  for (int d = 0; d < m_state_dimension; ++d)
+  {
+    store(m_states(d, slot), state(d));
+    store(m_states_prime(d, slot), state_prime(d));
+  }
+
+  for (int d = 0; d < m_action_dimension; ++d)
+    store(m_actions(d, slot), action(d));
+
+  store(m_rewards(slot), reward);
+  store(m_dones(slot), done ? 1.0 : 0.0);
+
+  m_stamps[slot].store(2 * ticket + 2, std::memory_order_release);
+
+  setPriority(slot, m_max_priority.load(std::memory_order_relaxed));
+
+  return slot;
+}
+
+void ReplayBuffer::sample(Philox4x32& random_engine, double beta, Eigen::Ref<SlotVector> slots, Eigen::Ref<StampVector> stamps,
+                          Eigen::Ref<Eigen::VectorXd> weights) const
+{
+  if (weights.rows() != slots.rows() or stamps.rows() != slots.rows())
+  {
+    std::stringstream ss;
+    ss << "Invalid sample of the replay buffer: " << weights.rows() << " weights and " << stamps.rows() << " stamps for "
+       << slots.rows() << " slots";
+    throw std::invalid_argument(ss.str());
+  }
+
+  const std::size_t size = getSize();
+
+  if (size == 0)
+    throw std::logic_error("Cannot sample from an empty replay buffer");
+
+  const double total = getTotalPriority();
+  const double segment = total / slots.rows();
+  double max_weight = 0.0;
+
+  for (Eigen::Index i = 0; i < slots.rows(); ++i)
+  {
+    const std::size_t slot = find((i + random_engine.uniform<double>()) * segment);
+
+    // The stamp before the priority, a transition written in between has a newer stamp than the one returned
+    stamps(i) = m_stamps[slot].load(std::memory_order_acquire);
+    const double priority = getPriority(slot);
+
+    // A slot that is just being written has priority 0 and weight 0
+    slots(i) = static_cast<std::int64_t>(slot);
+    weights(i) = priority > 0.0 ? std::pow(size * priority / total, -beta) : 0.0;
+    max_weight = std::max(max_weight, weights(i));
+  }
+
+  // Normalised by the largest weight, the updates only get scaled down
+  if (max_weight > 0.0)
+    weights /= max_weight;
+}
+
+std::size_t ReplayBuffer::gather(const Eigen::Ref<const SlotVector>& slots,
+                                 const Eigen::Ref<const StampVector>& stamps,
+                                 Eigen::Ref<Eigen::MatrixXd> states,
+                                 Eigen::Ref<Eigen::MatrixXd> actions,
+                                 Eigen::Ref<Eigen::VectorXd> rewards,
+                                 Eigen::Ref<Eigen::MatrixXd> states_prime,
+                                 Eigen::Ref<Eigen::VectorXd> dones,
+                                 Eigen::Ref<Eigen::VectorXd> weights) const
+{
+  const Eigen::Index n = slots.rows();
+
+  if (stamps.rows() != n or states.rows() != m_state_dimension or states.cols() != n or actions.rows() != m_action_dimension or actions.cols() != n
+      or states_prime.rows() != m_state_dimension or states_prime.cols() != n
+      or rewards.rows() != n or dones.rows() != n or weights.rows() != n)
+  {
+    std::stringstream ss;
+    ss << "Invalid batch for the replay buffer: " << n << " slots, states " << states.rows() << " x " << states.cols()
+       << ", actions " << actions.rows() << " x " << actions.cols();
+    throw std::invalid_argument(ss.str());
+  }
+
+  std::size_t torn = 0;
+
+  for (Eigen::Index i = 0; i < n; ++i)
+  {
+    const std::size_t slot = static_cast<std::size_t>(slots(i));
+
+    // Seqlock: the stamp must be even and the one of sample() over the whole copy
+    const std::uint64_t before = m_stamps[slot].load(std::memory_order_acquire);
+
+    for (int d = 0; d < m_state_dimension; ++d)
+    {
+      states(d, i) = load(m_states(d, slot));
+      states_prime(d, i) = load(m_states_prime(d, slot));
+    }
+
+    for (int d = 0; d < m_action_dimension; ++d)
+      actions(d, i) = load(m_actions(d, slot));
+
+    rewards(i) = load(m_rewards(slot));
+    dones(i) = load(m_dones(slot));
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    const std::uint64_t after = m_stamps[slot].load(std::memory_order_relaxed);
+
+    if (before == 0 or before % 2 == 1 or before != after or before != stamps(i))
+    {
+      weights(i) = 0.0;
+      torn++;
+    }
+  }
+
+  return torn;
+}
+
+bool ReplayBuffer::updatePriority(std::size_t slot, std::uint64_t stamp, double td_error)
+{
+  // The TD error belongs to the transition that was sampled, not to a newer one in the same slot
+  if (stamp == 0 or stamp % 2 == 1 or m_stamps[slot].load(std::memory_order_acquire) != stamp)
+    return false;
+
+  const double priority = std::pow(std::abs(td_error) + PRIORITY_EPSILON, m_alpha);
+
+  setPriority(slot, priority);
+
+  // An append may have claimed the slot between the check and the write. Restore what it sets: 0 while it writes,
+  // the priority of new transitions once it is done. If it sets the priority after this, that does no harm.
+  const std::uint64_t now = m_stamps[slot].load(std::memory_order_acquire);
+
+  if (now != stamp)
+  {
+    setPriority(slot, now % 2 == 1 ? 0.0 : m_max_priority.load(std::memory_order_relaxed));
+    return false;
+  }
+
+  // New transitions get the largest priority so far
+  double max = m_max_priority.load(std::memory_order_relaxed);
+
+  while (priority > max and not m_max_priority.compare_exchange_weak(max, priority, std::memory_order_relaxed))
+  {
+  }
+
+  return true;
+}
+
+double ReplayBuffer::getPriority(std::size_t slot) const
+{
+  return load(m_tree[m_leaves + slot]);
+}
+
+double ReplayBuffer::getTotalPriority() const
+{
+  return load(m_tree[1]);
+}
+
+void ReplayBuffer::rebuild()
+{
+  for (std::size_t node = m_leaves - 1; node >= 1; --node)
+    m_tree[node] = m_tree[2 * node] + m_tree[2 * node + 1];
+}
+
+void ReplayBuffer::setPriority(std::size_t slot, double priority)
+{
+  const std::size_t leaf = m_leaves + slot;
+  double old;
+
+#pragma omp atomic capture
+  {
+    old = m_tree[leaf];
+    m_tree[leaf] = priority;
+  }
+
+  // Only the difference goes up the tree, concurrent updates of other leaves add up in the common ancestors
+  const double delta = priority - old;
+
+  if (delta == 0.0)
+    return;
+
+  for (std::size_t node = leaf / 2; node >= 1; node /= 2)
+  {
+#pragma omp atomic update
+    m_tree[node] += delta;
+  }
+}
+
+std::size_t ReplayBuffer::find(double value) const
+{
+  std::size_t node = 1;
+
+  while (node < m_leaves)
+  {
+    const double left = load(m_tree[2 * node]);
+
+    if (value < left)
+      node = 2 * node;
+    else
+    {
+      value -= left;
+      node = 2 * node + 1;
+    }
+  }
+
+  // Rounding or concurrent updates can run past the last transition, its neighbour is the closest one
+  return std::min(node - m_leaves, getSize() - 1);
+}
@@ -0,0 +1,355 @@
+#include "SparseQTable.h"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "Eigen/Dense"
+
+#include "Checkpoint.h"
+
+SparseQTable::SparseQTable(int actions, std::size_t capacity, double value) :
+  m_actions(actions), m_value(value), m_slots(0), m_shift(64), m_size(0)
+{
+  if (actions <= 0 or capacity == 0)
+  {
+    std::stringstream ss;
+    ss << "Invalid size for the sparse Q-table: capacity " << capacity << ", " << actions << " actions";
+    throw std::invalid_argument(ss.str());
+  }
+
+  m_stride = (actions + LINE - 1) / LINE * LINE;
+
+  allocate(capacity);
+}
+
+SparseQTable::SparseQTable(const SparseQTable& other) :
+  m_actions(other.m_actions), m_value(other.m_value), m_stride(other.m_stride),
+  m_slots(other.m_slots), m_shift(other.m_shift), m_size(other.getSize()),
+  m_keys(other.m_slots), m_data(other.m_data)
+{
+  for (std::size_t s = 0; s < m_slots; ++s)
+    m_keys[s].store(other.key(s), std::memory_order_relaxed);
+}
+
+SparseQTable& SparseQTable::operator=(const SparseQTable& other)
+{
+  if (this != &other)
+  {
+    m_actions = other.m_actions;
+    m_value = other.m_value;
+    m_stride = other.m_stride;
+    m_slots = other.m_slots;
+    m_shift = other.m_shift;
+    m_size.store(other.getSize(), std::memory_order_relaxed);
+    m_keys = std::vector<std::atomic<std::uint64_t>>(m_slots);
+    m_data = other.m_data;
+
+    for (std::size_t s = 0; s < m_slots; ++s)
+      m_keys[s].store(other.key(s), std::memory_order_relaxed);
+  }
+
+  return *this;
+}
+
+void SparseQTable::allocate(std::size_t cells)
+{
+  // A power of two with at least LOAD_FACTOR slots per cell, at least two slots to keep the shift below 64
+  m_slots = 2;
+  m_shift = 63;
+
+  while (m_slots < cells * LOAD_FACTOR)
+  {
+    m_slots *= 2;
+    m_shift--;
+  }
+
+  // Padding first, then the initial value of the actions, a free slot always holds the values of a new cell
+  Line padding;
+  std::fill(padding.q, padding.q + LINE, std::numeric_limits<double>::lowest());
+
+  m_data.assign(m_slots * (m_stride / LINE), padding);
+
+  for (std::size_t s = 0; s < m_slots; ++s)
+    std::fill(values(s), values(s) + m_actions, m_value);
+
+  m_keys = std::vector<std::atomic<std::uint64_t>>(m_slots);
+
+  for (auto& key : m_keys)
+    key.store(EMPTY, std::memory_order_relaxed);
+
+  m_size.store(0, std::memory_order_relaxed);
+}
+
+std::size_t SparseQTable::memoryUsage() const
+{
+  return m_keys.size() * sizeof(std::atomic<std::uint64_t>) + m_data.size() * sizeof(Line);
+}
+
+std::ptrdiff_t SparseQTable::find(std::uint64_t key) const
+{
+  const std::size_t mask = m_slots - 1;
+
+  // Linear probing, a free slot ends the search since cells are never removed one by one
+  for (std::size_t s = home(key), n = 0; n < m_slots; s = (s + 1) & mask, ++n)
+  {
+    const std::uint64_t k = m_keys[s].load(std::memory_order_acquire);
+
+    if (k == key)
+      return static_cast<std::ptrdiff_t>(s);
+
+    if (k == EMPTY)
+      return -1;
+  }
+
+  return -1;
+}
+
+std::ptrdiff_t SparseQTable::insert(std::uint64_t key)
+{
+  if (key == EMPTY)
+    throw std::invalid_argument("The key of a free slot cannot be inserted into the sparse Q-table");
+
+  const std::size_t mask = m_slots - 1;
+
+  for (std::size_t s = home(key), n = 0; n < m_slots; s = (s + 1) & mask, ++n)
+  {
+    std::uint64_t k = m_keys[s].load(std::memory_order_acquire);
+
+    if (k == EMPTY)
+    {
+      if (getSize() >= getCapacity())
+      {
+        std::stringstream ss;
+        ss << "The sparse Q-table is full (" << getCapacity() << " cells), reserve() more before the training";
+        throw std::length_error(ss.str());
+      }
+
+      // Claim the slot, if another thread was faster k receives its key and the probing goes on
+      if (m_keys[s].compare_exchange_strong(k, key, std::memory_order_acq_rel, std::memory_order_acquire))
+      {
+        m_size.fetch_add(1, std::memory_order_relaxed);
+        return static_cast<std::ptrdiff_t>(s);
+      }
+    }
+
+    if (k == key)
+      return static_cast<std::ptrdiff_t>(s);
+  }
+
+  throw std::length_error("The sparse Q-table has no free slot left");
+}
+
+double SparseQTable::operator()(std::uint64_t key, int action) const
+{
+  const std::ptrdiff_t slot = find(key);
+  return slot < 0 ? m_value : values(slot)[action];
+}
+
+double& SparseQTable::operator()(std::uint64_t key, int action)
+{
+  std::ptrdiff_t slot = find(key);
+
+  if (slot < 0)
+  {
+    if (getSize() >= getCapacity())
+      reserve(2 * getCapacity());
+
+    slot = insert(key);
+  }
+
+  return values(slot)[action];
+}
+
+int SparseQTable::bestAction(std::uint64_t key) const
+{
+  const std::ptrdiff_t slot = find(key);
+
+  // All actions of a new cell are equal, the first one wins
+  if (slot < 0)
+    return 0;
+
+  const double* q = values(slot);
+  const double best = Eigen::Map<const Eigen::VectorXd, Eigen::Aligned64>(q, m_stride).maxCoeff();
+
+  int action = 0;
+
+  while (q[action] != best)
+    action++;
+
+  return action;
+}
+
+double SparseQTable::maxValue(std::uint64_t key) const
+{
+  const std::ptrdiff_t slot = find(key);
+
+  if (slot < 0)
+    return m_value;
+
+  // Vectorised over the whole padded slot, the padding never wins
+  return Eigen::Map<const Eigen::VectorXd, Eigen::Aligned64>(values(slot), m_stride).maxCoeff();
+}
+
+double SparseQTable::atomicLoad(std::uint64_t key, int action) const
+{
+  const std::ptrdiff_t slot = find(key);
+
+  if (slot < 0)
+    return m_value;
+
+  double value;
+#pragma omp atomic read
+  value = values(slot)[action];
+  return value;
+}
+
+void SparseQTable::atomicAdd(std::uint64_t key, int action, double delta)
+{
+  double* value = values(insert(key)) + action;
+#pragma omp atomic update
+  *value += delta;
+}
+
+int SparseQTable::bestActionAtomic(std::uint64_t key) const
+{
+  const std::ptrdiff_t slot = find(key);
+
+  if (slot < 0)
+    return 0;
+
+  // Each value is read once, the result is consistent even if the cell changes meanwhile
+  const double* q = values(slot);
+  int action = 0;
+  double best;
+
+#pragma omp atomic read
+  best = q[0];
+
+  for (int a = 1; a < m_actions; ++a)
+  {
+    double value;
+#pragma omp atomic read
+    value = q[a];
+
+    if (value > best)
+    {
+      best = value;
+      action = a;
+    }
+  }
+
+  return action;
+}
+
+double SparseQTable::maxValueAtomic(std::uint64_t key) const
+{
+  const std::ptrdiff_t slot = find(key);
+
+  if (slot < 0)
+    return m_value;
+
+  const double* q = values(slot);
+  double best;
+
+#pragma omp atomic read
+  best = q[0];
+
+  for (int a = 1; a < m_actions; ++a)
+  {
+    double value;
+#pragma omp atomic read
+    value = q[a];
+    best = std::max(best, value);
+  }
+
+  return best;
+}
+
+void SparseQTable::reserve(std::size_t cells)
+{
+  if (cells <= getCapacity())
+    return;
+
+  // Rehash into new arrays, the slots of the cells change
+  std::vector<std::atomic<std::uint64_t>> old_keys;
+  std::vector<Line> old_data;
+
+  old_keys.swap(m_keys);
+  old_data.swap(m_data);
+
+  allocate(cells);
+
+  for (std::size_t s = 0; s < old_keys.size(); ++s)
+  {
+    const std::uint64_t key = old_keys[s].load(std::memory_order_relaxed);
+    const double* q = old_data.data()->q + s * m_stride;
+
+    if (key != EMPTY)
+      std::copy(q, q + m_actions, values(insert(key)));
+  }
+}
+
+void SparseQTable::clear()
+{
+  allocate(getCapacity());
+}
+
+double SparseQTable::sum() const
+{
+  double sum = 0.0;
+
+  for (std::size_t s = 0; s < m_slots; ++s)
+  {
+    if (key(s) != EMPTY)
+      sum += Eigen::Map<const Eigen::VectorXd, Eigen::Aligned64>(values(s), m_actions).sum();
+  }
+
+  return sum;
+}
+
+void SparseQTable::save(CheckpointWriter& writer, const std::string& name) const
+{
+  static_assert(sizeof(std::atomic<std::uint64_t>) == sizeof(std::uint64_t), "The keys are written as plain integers");
+
+  const Meta meta = {m_actions, m_stride, static_cast<std::int64_t>(m_slots), static_cast<std::int64_t>(getSize()), m_value};
+
+  writer.addValue(name + ".meta", meta);
+  writer.add(name + ".keys", m_keys.data(), m_slots * sizeof(std::uint64_t));
+  writer.add(name + ".values", m_data.data(), m_data.size() * sizeof(Line));
+}
+
+void SparseQTable::load(const CheckpointReader& reader, const std::string& name)
+{
+  const Meta meta = reader.value<Meta>(name + ".meta");
+
+  std::size_t key_bytes, value_bytes;
+  const std::uint64_t* keys = static_cast<const std::uint64_t*>(reader.data(name + ".keys", key_bytes));
+  const Line* lines = static_cast<const Line*>(reader.data(name + ".values", value_bytes));
+
+  const std::size_t slots = static_cast<std::size_t>(meta.slots);
+
+  if (meta.actions <= 0 or meta.stride != (meta.actions + LINE - 1) / LINE * LINE or meta.slots < 2
+      or (slots & (slots - 1)) != 0 or meta.size < 0 or static_cast<std::size_t>(meta.size) > slots / LOAD_FACTOR
+      or key_bytes != slots * sizeof(std::uint64_t) or value_bytes != slots * meta.stride * sizeof(double))
+    throw std::runtime_error("The sparse Q-table '" + name + "' in the checkpoint is inconsistent");
+
+  m_actions = static_cast<int>(meta.actions);
+  m_stride = static_cast<int>(meta.stride);
+  m_value = meta.value;
+  m_slots = slots;
+  m_shift = 64;
+
+  for (std::size_t s = slots; s > 1; s /= 2)
+    m_shift--;
+
+  // The hash only depends on the number of slots, hence the slots are valid as they are
+  m_data.assign(lines, lines + value_bytes / sizeof(Line));
+  m_keys = std::vector<std::atomic<std::uint64_t>>(slots);
+
+  for (std::size_t s = 0; s < slots; ++s)
+    m_keys[s].store(keys[s], std::memory_order_relaxed);
+
+  m_size.store(static_cast<std::size_t>(meta.size), std::memory_order_relaxed);
+}
@@ -0,0 +1,123 @@
+#include "TileCoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+  /// The displacement of a tiling along a dimension in tile widths, t * (2d + 1) / tilings modulo one
+  double shift(int tiling, int dimension, int tilings)
+  {
+    return static_cast<double>((tiling * (2 * dimension + 1)) % tilings) / tilings;
+  }
+}
+
+TileCoder::TileCoder(int tilings, int size_bits, int state_dimension) :
+  m_tilings(tilings), m_size_bits(size_bits), m_state_dimension(state_dimension), m_tiles_per_tiling(1)
+{
+  if (tilings < 1 or size_bits < 1 or size_bits > 30)
+  {
+    std::stringstream ss;
+    ss << "Invalid tile coder: " << tilings << " tilings, table size 2^" << size_bits;
+    throw std::invalid_argument(ss.str());
+  }
+}
+
+int TileCoder::addDimension(int component, double low, double high, double width)
+{
+  if (component < 0 or component >= m_state_dimension or not (high > low) or not (width > 0.0))
+  {
+    std::stringstream ss;
+    ss << "Invalid dimension for the tile coder: component " << component << ", range [" << low << ", " << high
+       << "], width " << width;
+    throw std::invalid_argument(ss.str());
+  }
+
+  Dimension dimension;
+
+  dimension.component = component;
+  dimension.low = low;
+  dimension.high = high;
+  dimension.inverse = 1.0 / width;
+  dimension.tiles = static_cast<std::int64_t>(std::ceil((high - low) * dimension.inverse)) + 1;
+  dimension.stride = m_tiles_per_tiling;
+
+  if (m_tiles_per_tiling > MAX_TILES / dimension.tiles / m_tilings)
+  {
+    std::stringstream ss;
+    ss << "Too many tiles for the tile coder: " << dimension.tiles << " more along component " << component;
+    throw std::invalid_argument(ss.str());
+  }
+
+  m_tiles_per_tiling *= dimension.tiles;
+  m_dimensions.push_back(dimension);
+
+  return getDimensions() - 1;
+}
+
+Eigen::MatrixXd TileCoder::getLayout() const
+{
+  Eigen::MatrixXd layout(4, getDimensions());
+
+  for (int d = 0; d < getDimensions(); ++d)
+  {
+    const Dimension& dimension = m_dimensions[d];
+    layout.col(d) << dimension.component, dimension.low, dimension.high, 1.0 / dimension.inverse;
+  }
+
+  return layout;
+}
+
+void TileCoder::activeTiles(const Eigen::Ref<const Eigen::VectorXd>& state, Eigen::Ref<Eigen::VectorXi> tiles) const
+{
+  for (int t = 0; t < m_tilings; ++t)
+  {
+    // The number of the tile in tiling t, mixed radix over the dimensions, then the tilings one after another
+    std::int64_t tile = t * m_tiles_per_tiling;
+
+    for (int d = 0; d < getDimensions(); ++d)
+    {
+      const Dimension& dimension = m_dimensions[d];
+      const double u = (std::max(dimension.low, std::min(state(dimension.component), dimension.high)) - dimension.low) * dimension.inverse;
+
+      tile += static_cast<std::int64_t>(std::floor(u + shift(t, d, m_tilings))) * dimension.stride;
+    }
+
+    tiles(t) = hash(static_cast<std::uint64_t>(tile));
+  }
+}
+
+void TileCoder::activeTilesBatch(const Eigen::Ref<const Eigen::MatrixXd>& states, Eigen::Ref<TileMatrix> tiles) const
+{
+  if (tiles.rows() != m_tilings or tiles.cols() != states.cols())
+  {
+    std::stringstream ss;
+    ss << "Invalid batch for the tile coder: " << tiles.rows() << " x " << tiles.cols() << " tiles for "
+       << states.cols() << " states and " << m_tilings << " tilings";
+    throw std::invalid_argument(ss.str());
+  }
+
+  // The tile numbers, one column per tiling, contiguous over the states
+  Eigen::Array<std::int64_t, Eigen::Dynamic, Eigen::Dynamic> numbers(states.cols(), m_tilings);
+  Eigen::ArrayXd u(states.cols());
+
+  for (int t = 0; t < m_tilings; ++t)
+    numbers.col(t).setConstant(t * m_tiles_per_tiling);
+
+  // Component by component, clipping and scaling once, then the coordinate in every tiling
+  for (int d = 0; d < getDimensions(); ++d)
+  {
+    const Dimension& dimension = m_dimensions[d];
+
+    u = (states.row(dimension.component).transpose().array().max(dimension.low).min(dimension.high) - dimension.low) * dimension.inverse;
+
+    for (int t = 0; t < m_tilings; ++t)
+      numbers.col(t) += (u + shift(t, d, m_tilings)).floor().cast<std::int64_t>() * dimension.stride;
+  }
+
+  for (Eigen::Index i = 0; i < states.cols(); ++i)
+    for (int t = 0; t < m_tilings; ++t)
+      tiles(t, i) = hash(static_cast<std::uint64_t>(numbers(i, t)));
+}
@@ -0,0 +1,97 @@
+#include "TileCoding.h"
+
+const int TileCoding::TILINGS = 8;
+const int TileCoding::SIZE_BITS = 14;
+const double TileCoding::ALPHA = 0.1;
+const double TileCoding::GAMMA = 0.9;
+const double TileCoding::EPSILON = 0.1;
+const int TileCoding::TRAJECTORIES = 1000;
+const int TileCoding::STEPS = 100;
+const char* const TileCoding::CHECKPOINT_KIND = "TileCoding";
+
+TileCoding::TileCoding(std::uint64_t seed) :
+  LinearQ(seed), m_coder(TILINGS, SIZE_BITS)
+{
+  // Player and ball position with tiles of 1 x 1, the ball velocity with tiles of 2 x 2
+  m_coder.addDimension(0, HaxBallField::SIZE.left(), HaxBallField::SIZE.right(), 1.0);
+  m_coder.addDimension(1, HaxBallField::SIZE.top(), HaxBallField::SIZE.bottom(), 1.0);
+  m_coder.addDimension(2, HaxBallField::SIZE.left(), HaxBallField::SIZE.right(), 1.0);
+  m_coder.addDimension(3, HaxBallField::SIZE.top(), HaxBallField::SIZE.bottom(), 1.0);
+  m_coder.addDimension(4, -HaxBallField::MAX_SPEED_BALL, HaxBallField::MAX_SPEED_BALL, 2.0);
+  m_coder.addDimension(5, -HaxBallField::MAX_SPEED_BALL, HaxBallField::MAX_SPEED_BALL, 2.0);
+
+  m_weights.setZero(PADDED_ACTIONS, m_coder.getSize());
+}
+
+TileCoding::~TileCoding()
+{
+
+}
+
+void TileCoding::activate(const Eigen::Ref<const Eigen::VectorXd>& state, Features& tiles) const
+{
+  tiles.resize(TILINGS, 1);
+  m_coder.activeTiles(state, tiles.col(0));
+}
+
+void TileCoding::activateBatch(const Eigen::Ref<const Eigen::MatrixXd>& states, Features& tiles) const
+{
+  tiles.resize(TILINGS, states.cols());
+  m_coder.activeTilesBatch(states, tiles);
+}
+
+TileCoding::ActionValues TileCoding::actionValues(const Features& tiles, int k) const
+{
+  // Fixed size columns, every addition is a handful of SIMD instructions
+  ActionValues q = m_weights.col(tiles(0, k));
+
+  for (int t = 1; t < TILINGS; ++t)
+    q += m_weights.col(tiles(t, k));
+
+  return q;
+}
+
+TileCoding::ActionValues TileCoding::actionValuesAtomic(const Features& tiles, int k) const
+{
+  // Each weight is read once, no SIMD, but consistent while other threads update
+  ActionValues q = ActionValues::Zero();
+
+  for (int t = 0; t < TILINGS; ++t)
+  {
+    const double* weights = &m_weights(0, tiles(t, k));
+
+    for (int a = 0; a < ACTIONS; ++a)
+    {
+      double weight;
+#pragma omp atomic read
+      weight = weights[a];
+      q(a) += weight;
+    }
+  }
+
+  return q;
+}
+
+void TileCoding::update(const Features& tiles, int k, int action, double target)
+{
+  // Atomic reads, the weights change while other threads train
+  double q = 0.0;
+
+  for (int t = 0; t < TILINGS; ++t)
+  {
+    double weight;
+#pragma omp atomic read
+    weight = m_weights(action, tiles(t, k));
+    q += weight;
+  }
+
+  // The step is shared among the tilings, Q(s, a) moves by ALPHA * (target - Q(s, a)) if no tiles collide
+  const double delta = ALPHA / TILINGS * (target - q);
+
+  for (int t = 0; t < TILINGS; ++t)
+  {
+    double* weight = &m_weights(action, tiles(t, k));
+#pragma omp atomic update
+    *weight += delta;
+  }
+}
@@ -0,0 +1,71 @@
+#include "Trajectory.h"
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+Trajectory::Trajectory(std::size_t capacity)
+{
+  m_rewards.reserve(capacity);
+  m_values.reserve(capacity);
+  m_continues.reserve(capacity);
+}
+
+void Trajectory::clear()
+{
+  m_rewards.clear();
+  m_values.clear();
+  m_continues.clear();
+}
+
+void Trajectory::compute(double gamma, int n, double lambda)
+{
+  if (not (gamma >= 0.0 and gamma <= 1.0) or n < 1 or not (lambda >= 0.0 and lambda <= 1.0))
+  {
+    std::stringstream ss;
+    ss << "Invalid parameters of the targets of a trajectory: gamma " << gamma << ", n " << n << ", lambda " << lambda;
+    throw std::invalid_argument(ss.str());
+  }
+
+  const Eigen::Index T = static_cast<Eigen::Index>(m_rewards.size());
+
+  m_returns.resize(T);
+  m_lambda_returns.resize(T);
+  m_n_step.resize(T);
+  m_remaining.resize(T);
+
+  if (T == 0)
+    return;
+
+  const Eigen::Map<const Eigen::ArrayXd> values(m_values.data(), T);
+
+  // The truncated tail bootstraps, V(s_T) of the last step
+  double G = values(T - 1), G_lambda = values(T - 1);
+  int remaining = -1;
+
+  for (Eigen::Index t = T - 1; t >= 0; --t)
+  {
+    // A terminal step has V(s_t+1) = 0 and discounts the rest of the trajectory to 0
+    const double discount = gamma * m_continues[t];
+
+    G = m_rewards[t] + discount * G;
+    G_lambda = m_rewards[t] + discount * ((1.0 - lambda) * values(t) + lambda * G_lambda);
+    remaining = m_continues[t] == 0.0 ? 0 : remaining + 1;
+
+    m_returns(t) = G;
+    m_lambda_returns(t) = G_lambda;
+    m_remaining(t) = remaining;
+  }
+
+  // G_t - gamma^n G_t+n + gamma^n V(s_t+n) where the episode goes on for n more steps, else the return is the target
+  m_n_step = m_returns;
+
+  if (n < T)
+  {
+    const double gamma_n = std::pow(gamma, n);
+    const Eigen::Index m = T - n;
+
+    m_n_step.head(m) = (m_remaining.head(m) >= n).select(
+        m_returns.head(m) - gamma_n * (m_returns.tail(m) - values.segment(n - 1, m)), m_returns.head(m));
+  }
+}
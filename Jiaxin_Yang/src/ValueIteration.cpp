@@ -0,0 +1,495 @@
+#include "ValueIteration.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "ActionSpace.h"
+#include "HaxBallCore.h"
+#include "RewardFunctions.h"
+#include "Symmetry.h"
+
+const double ValueIteration::GAMMA = 0.9;
+
+namespace
+{
+  /// The bounds of the state components, the grid and the states of the model stay within them
+  const double LOW[HaxBallField::STATE_DIMENSION] = {
+    HaxBallField::SIZE.left(), HaxBallField::SIZE.top(), HaxBallField::SIZE.left(), HaxBallField::SIZE.top(),
+    -HaxBallField::MAX_SPEED_BALL, -HaxBallField::MAX_SPEED_BALL };
+
+  const double HIGH[HaxBallField::STATE_DIMENSION] = {
+    HaxBallField::SIZE.right(), HaxBallField::SIZE.bottom(), HaxBallField::SIZE.right(), HaxBallField::SIZE.bottom(),
+    HaxBallField::MAX_SPEED_BALL, HaxBallField::MAX_SPEED_BALL };
+}
+
+ValueIteration::ValueIteration(double position_resolution, double velocity_resolution, int samples, std::uint64_t seed,
+                               bool symmetric) :
+  m_samples(samples), m_seed(seed), m_symmetric(symmetric), m_residual(0.0)
+{
+  if (samples < 1)
+  {
+    std::stringstream ss;
+    ss << "Invalid number of samples per cell and action: " << samples;
+    throw std::invalid_argument(ss.str());
+  }
+
+  for (int d = 0; d < HaxBallField::STATE_DIMENSION; ++d)
+  {
+    m_resolution.push_back(d < 4 ? position_resolution : velocity_resolution);
+    m_discretizer.addDimension(d, LOW[d], HIGH[d], m_resolution[d]);
+  }
+
+  if (m_discretizer.getCells() >= TERMINAL)
+  {
+    std::stringstream ss;
+    ss << "Too many cells for value iteration: " << m_discretizer.getCells();
+    throw std::invalid_argument(ss.str());
+  }
+
+  // All grid points, mixed radix over the dimensions, then sorted by their Morton index, a mirrored pair appears twice
+  m_cells.reserve(m_discretizer.getCells());
+
+  Eigen::VectorXd state(HaxBallField::STATE_DIMENSION);
+  std::vector<int> coordinates(HaxBallField::STATE_DIMENSION, 0);
+
+  for (std::uint64_t i = 0; i < m_discretizer.getCells(); ++i)
+  {
+    for (int d = 0; d < HaxBallField::STATE_DIMENSION; ++d)
+      state(d) = LOW[d] + coordinates[d] * m_resolution[d];
+
+    bool mirrored;
+    m_cells.push_back(m_symmetric ? Symmetry::canonicalIndex(m_discretizer, state, mirrored) : m_discretizer.index(state));
+
+    for (int d = 0; d < HaxBallField::STATE_DIMENSION and ++coordinates[d] == m_discretizer.getCells(d); ++d)
+      coordinates[d] = 0;
+  }
+
+  std::sort(m_cells.begin(), m_cells.end());
+  m_cells.erase(std::unique(m_cells.begin(), m_cells.end()), m_cells.end());
+}
+
+ValueIteration::~ValueIteration()
+{
+
+}
+
+std::uint32_t ValueIteration::cellOf(const Eigen::Ref<const Eigen::VectorXd>& state, bool& mirrored) const
+{
+  mirrored = false;
+
+  const std::uint64_t index = m_symmetric ? Symmetry::canonicalIndex(m_discretizer, state, mirrored)
+                                          : m_discretizer.index(state);
+  const auto cell = std::lower_bound(m_cells.begin(), m_cells.end(), index);
+
+  if (cell == m_cells.end() or *cell != index)
+  {
+    std::stringstream ss;
+    ss << "The state " << state.transpose() << " has no cell in the model";
+    throw std::logic_error(ss.str());
+  }
+
+  return static_cast<std::uint32_t>(cell - m_cells.begin());
+}
+
+void ValueIteration::buildModel()
+{
+  const std::size_t cells = m_cells.size();
+  const std::size_t rows = cells * ACTIONS;
+
+  // At most m_samples successors per row, compacted afterwards
+  std::vector<std::uint32_t> successors(rows * m_samples);
+  std::vector<float> probabilities(rows * m_samples);
+  std::vector<std::uint32_t> counts(rows);
+
+  m_rewards.assign(rows, 0.0f);
+
+#pragma omp parallel
+  {
+    // Without opponent the step only depends on the state and the action
+    HaxBallCore env(false, m_seed);
+    HaxBallCore::StepInfo info;
+
+    Eigen::VectorXd
+        center(HaxBallField::STATE_DIMENSION),
+        state(HaxBallField::STATE_DIMENSION),
+        action(HaxBallField::ACTION_DIMENSION);
+
+#pragma omp for schedule(dynamic, 64)
+    for (std::int64_t c = 0; c < static_cast<std::int64_t>(cells); ++c)
+    {
+      m_discretizer.center(m_cells[c], center);
+
+      for (int a = 0; a < ACTIONS; ++a)
+      {
+        const std::size_t row = c * ACTIONS + a;
+        const std::size_t begin = row * m_samples;
+        double reward = 0.0;
+        std::uint32_t count = 0;
+
+        Action::action_map(a, action);
+
+        for (int k = 0; k < m_samples; ++k)
+        {
+          sampleState(c, a, k, center, state);
+          env.setState(state);
+          env.step(action, info);
+
+          reward += this->reward(state, action, info.state_prime);
+
+          // A goal ends the episode, nothing to bootstrap. A mirrored successor has the value of its canonical cell.
+          bool mirrored;
+          const std::uint32_t successor = info.terminal ? TERMINAL : cellOf(info.state_prime, mirrored);
+          std::uint32_t i = 0;
+
+          while (i < count and successors[begin + i] != successor)
+            ++i;
+
+          if (i == count)
+          {
+            successors[begin + count] = successor;
+            probabilities[begin + count] = 0.0f;
+            count++;
+          }
+
+          probabilities[begin + i] += 1.0f / m_samples;
+        }
+
+        m_rewards[row] = static_cast<float>(reward / m_samples);
+        counts[row] = count;
+      }
+    }
+  }
+
+  // Compressed rows
+  m_offsets.resize(rows + 1);
+  m_offsets[0] = 0;
+
+  for (std::size_t row = 0; row < rows; ++row)
+    m_offsets[row + 1] = m_offsets[row] + counts[row];
+
+  m_successors.resize(m_offsets[rows]);
+  m_probabilities.resize(m_offsets[rows]);
+
+  for (std::size_t row = 0; row < rows; ++row)
+  {
+    std::copy_n(successors.begin() + row * m_samples, counts[row], m_successors.begin() + m_offsets[row]);
+    std::copy_n(probabilities.begin() + row * m_samples, counts[row], m_probabilities.begin() + m_offsets[row]);
+  }
+
+  m_values.assign(cells, 0.0);
+  m_next_values.assign(cells, 0.0);
+  m_policy.assign(cells, 0);
+  m_residual = 0.0;
+}
+
+void ValueIteration::sampleState(std::uint32_t cell, int action, int sample, const Eigen::VectorXd& center,
+                                 Eigen::Ref<Eigen::VectorXd> state) const
+{
+  // The grid point first, then uniform within the cell, counter based: the same points for any thread count
+  state = center;
+
+  for (int d = 0; sample > 0 and d < HaxBallField::STATE_DIMENSION; ++d)
+  {
+    const double u = Philox4x32::uniformAt(m_seed, cell, (action * m_samples + sample) * HaxBallField::STATE_DIMENSION + d);
+    state(d) += (u - 0.5) * m_resolution[d];
+  }
+
+  for (int d = 0; d < HaxBallField::STATE_DIMENSION; ++d)
+    state(d) = std::max(LOW[d], std::min(state(d), HIGH[d]));
+}
+
+std::vector<std::uint32_t> ValueIteration::updateRewards()
+{
+  if (not hasModel())
+    return std::vector<std::uint32_t>();
+
+  const std::int64_t cells = static_cast<std::int64_t>(m_cells.size());
+  std::vector<std::uint8_t> changed(cells, 0);
+
+#pragma omp parallel
+  {
+    HaxBallCore env(false, m_seed);
+    HaxBallCore::StepInfo info;
+
+    Eigen::VectorXd
+        center(HaxBallField::STATE_DIMENSION),
+        state(HaxBallField::STATE_DIMENSION),
+        action(HaxBallField::ACTION_DIMENSION);
+
+    // The same sample points and steps as buildModel(), only the rewards are new
+#pragma omp for schedule(dynamic, 64)
+    for (std::int64_t c = 0; c < cells; ++c)
+    {
+      m_discretizer.center(m_cells[c], center);
+
+      for (int a = 0; a < ACTIONS; ++a)
+      {
+        const std::size_t row = c * ACTIONS + a;
+        double reward = 0.0;
+
+        Action::action_map(a, action);
+
+        for (int k = 0; k < m_samples; ++k)
+        {
+          sampleState(c, a, k, center, state);
+          env.setState(state);
+          env.step(action, info);
+
+          reward += this->reward(state, action, info.state_prime);
+        }
+
+        const float expected = static_cast<float>(reward / m_samples);
+
+        if (expected != m_rewards[row])
+        {
+          m_rewards[row] = expected;
+          changed[c] = 1;
+        }
+      }
+    }
+  }
+
+  std::vector<std::uint32_t> changed_cells;
+
+  for (std::int64_t c = 0; c < cells; ++c)
+    if (changed[c])
+      changed_cells.push_back(static_cast<std::uint32_t>(c));
+
+  return changed_cells;
+}
+
+template <bool atomic>
+double ValueIteration::actionValue(std::uint32_t cell, int action, const std::vector<double>& values) const
+{
+  const std::size_t row = static_cast<std::size_t>(cell) * ACTIONS + action;
+  double expected = 0.0;
+
+  for (std::uint64_t i = m_offsets[row]; i < m_offsets[row + 1]; ++i)
+  {
+    const std::uint32_t successor = m_successors[i];
+
+    if (successor == TERMINAL)
+      continue;
+
+    double value;
+
+    if constexpr (atomic)
+    {
+#pragma omp atomic read
+      value = values[successor];
+    }
+    else
+      value = values[successor];
+
+    expected += m_probabilities[i] * value;
+  }
+
+  return m_rewards[row] + GAMMA * expected;
+}
+
+template <bool atomic>
+double ValueIteration::greedy(std::uint32_t cell, int& best_action) const
+{
+  double best = actionValue<atomic>(cell, 0, m_values);
+  best_action = 0;
+
+  for (int a = 1; a < ACTIONS; ++a)
+  {
+    const double q = actionValue<atomic>(cell, a, m_values);
+
+    if (q > best)
+    {
+      best = q;
+      best_action = a;
+    }
+  }
+
+  return best;
+}
+
+template double ValueIteration::greedy<false>(std::uint32_t, int&) const;
+template double ValueIteration::greedy<true>(std::uint32_t, int&) const;
+
+double ValueIteration::greedyFixedPoint(std::uint32_t cell, int& best_action) const
+{
+  double best = -std::numeric_limits<double>::infinity();
+  best_action = 0;
+
+  for (int a = 0; a < ACTIONS; ++a)
+  {
+    const std::size_t row = static_cast<std::size_t>(cell) * ACTIONS + a;
+    double expected = 0.0, self = 0.0;
+
+    for (std::uint64_t i = m_offsets[row]; i < m_offsets[row + 1]; ++i)
+    {
+      const std::uint32_t successor = m_successors[i];
+
+      if (successor == TERMINAL)
+        continue;
+
+      if (successor == cell)
+      {
+        self += m_probabilities[i];
+        continue;
+      }
+
+      double value;
+
+#pragma omp atomic read
+      value = m_values[successor];
+
+      expected += m_probabilities[i] * value;
+    }
+
+    // V = r + GAMMA * (expected + self * V), solved for V
+    const double q = (m_rewards[row] + GAMMA * expected) / (1.0 - GAMMA * self);
+
+    if (q > best)
+    {
+      best = q;
+      best_action = a;
+    }
+  }
+
+  return best;
+}
+
+double ValueIteration::sweepJacobi()
+{
+  const std::int64_t cells = static_cast<std::int64_t>(m_cells.size());
+  double residual = 0.0;
+
+#pragma omp parallel for schedule(static) reduction(max:residual)
+  for (std::int64_t c = 0; c < cells; ++c)
+  {
+    int best_action;
+    const double best = greedy<false>(c, best_action);
+
+    m_next_values[c] = best;
+    residual = std::max(residual, std::abs(best - m_values[c]));
+  }
+
+  m_values.swap(m_next_values);
+
+  return residual;
+}
+
+double ValueIteration::sweepGaussSeidel()
+{
+  const std::int64_t cells = static_cast<std::int64_t>(m_cells.size());
+  double residual = 0.0;
+
+  // Static schedule: one contiguous shard per thread, in Morton order most successors are in the own shard
+#pragma omp parallel for schedule(static) reduction(max:residual)
+  for (std::int64_t c = 0; c < cells; ++c)
+  {
+    int best_action;
+    const double best = greedy<true>(c, best_action);
+
+    // Only this thread writes the value of c, the others read it atomically
+    residual = std::max(residual, std::abs(best - m_values[c]));
+
+#pragma omp atomic write
+    m_values[c] = best;
+  }
+
+  return residual;
+}
+
+int ValueIteration::solve(double tolerance, int max_sweeps, Sweep sweep)
+{
+  if (not hasModel())
+    buildModel();
+
+  int sweeps = 0;
+
+  while (sweeps < max_sweeps)
+  {
+    m_residual = sweep == JACOBI ? sweepJacobi() : sweepGaussSeidel();
+    sweeps++;
+
+    if (m_residual < tolerance)
+      break;
+  }
+
+  // The greedy actions of the final values
+  const std::int64_t cells = static_cast<std::int64_t>(m_cells.size());
+
+#pragma omp parallel for schedule(static)
+  for (std::int64_t c = 0; c < cells; ++c)
+  {
+    int best_action;
+
+    greedy<false>(c, best_action);
+    m_policy[c] = static_cast<std::uint8_t>(best_action);
+  }
+
+  return sweeps;
+}
+
+void ValueIteration::policy(const Eigen::Ref<const Eigen::VectorXd>& state,
+                            Eigen::Ref<Eigen::VectorXd> action) const
+{
+  if (not hasModel())
+    throw std::logic_error("ValueIteration has no model yet, call solve() first");
+
+  // The greedy action of the canonical cell, mirrored back for a mirrored state
+  bool mirrored;
+  const int best = m_policy[cellOf(state, mirrored)];
+
+  Action::action_map(mirrored ? Symmetry::mirrorAction(best) : best, action);
+}
+
+double ValueIteration::reward(const Eigen::Ref<const Eigen::VectorXd>& s,
+                              const Eigen::Ref<const Eigen::VectorXd>& action,
+                              const Eigen::Ref<const Eigen::VectorXd>& s_prime) const
+{
+  return Reward::distance_player_ball_dense(s, action, s_prime) + Reward::ball_in_goal(s, action, s_prime);
+}
+
+double ValueIteration::getQfactor(const Eigen::Ref<const Eigen::VectorXd>& state,
+                                  const Eigen::Ref<const Eigen::VectorXd>& action) const
+{
+  if (not hasModel())
+    return 0.0;
+
+  bool mirrored;
+  const std::uint32_t cell = cellOf(state, mirrored);
+  const int a = Action::action_map(action);
+
+  return actionValue<false>(cell, mirrored ? Symmetry::mirrorAction(a) : a, m_values);
+}
+
+Eigen::VectorXd ValueIteration::getQfactor(const Eigen::Ref<const Eigen::VectorXd>& state) const
+{
+  Eigen::VectorXd q = Eigen::VectorXd::Zero(ACTIONS);
+
+  if (not hasModel())
+    return q;
+
+  bool mirrored;
+  const std::uint32_t cell = cellOf(state, mirrored);
+
+  for (int a = 0; a < ACTIONS; ++a)
+    q(a) = actionValue<false>(cell, mirrored ? Symmetry::mirrorAction(a) : a, m_values);
+
+  return q;
+}
+
+double ValueIteration::getValue(const Eigen::Ref<const Eigen::VectorXd>& state) const
+{
+  bool mirrored;
+  return hasModel() ? m_values[cellOf(state, mirrored)] : 0.0;
+}
+
+std::size_t ValueIteration::memoryUsage() const
+{
+  return sizeof(std::uint64_t) * (m_cells.size() + m_offsets.size())
+      + sizeof(std::uint32_t) * m_successors.size()
+      + sizeof(float) * (m_probabilities.size() + m_rewards.size())
+      + sizeof(double) * (m_values.size() + m_next_values.size())
+      + sizeof(std::uint8_t) * m_policy.size();
+}
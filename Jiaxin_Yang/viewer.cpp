@@ -0,0 +1,62 @@
+#include <iostream>
+#include <string>
+
+#include <QApplication>
+
+#include "Checkpoint.h"
+#include "HaxBallGui.h"
+#include "MultilinearQ.h"
+#include "QLearning.h"
+#include "RadialBasisQ.h"
+#include "RandomSearch.h"
+#include "TileCoding.h"
+
+template <typename Agent>
+int show(const std::string& checkpoint, int argc, char** argv)
+{
+  Agent agent;
+  agent.load(checkpoint);
+
+  QApplication app(argc, argv);
+  HaxBallGui gui(agent);
+  gui.show();
+  gui.playGame(1.0, -1, false, false);
+
+  return app.exec();
+}
+
+// Shows a trained agent from a checkpoint without any training, e.g. the one main.cpp writes after every training
+// Usage: HaxBallViewer [checkpoint]
+int main(int argc, char** argv)
+{
+  const std::string checkpoint = argc > 1 ? argv[1] : "qlearning.ckpt";
+
+  try
+  {
+    // The kind in the header decides which agent to create
+    const std::string kind = CheckpointReader(checkpoint).getKind();
+
+    if (kind == QLearning::CHECKPOINT_KIND)
+      return show<QLearning>(checkpoint, argc, argv);
+
+    if (kind == RandomSearch::CHECKPOINT_KIND)
+      return show<RandomSearch>(checkpoint, argc, argv);
+
+    if (kind == TileCoding::CHECKPOINT_KIND)
+      return show<TileCoding>(checkpoint, argc, argv);
+
+    if (kind == MultilinearQ::CHECKPOINT_KIND)
+      return show<MultilinearQ>(checkpoint, argc, argv);
+
+    if (kind == RadialBasisQ::CHECKPOINT_KIND)
+      return show<RadialBasisQ>(checkpoint, argc, argv);
+
+    std::cerr << "Unknown agent '" << kind << "' in " << checkpoint << std::endl;
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+  }
+
+  return 1;
+}
@@ -3,6 +3,11 @@
 
 #include "Eigen/Dense"
 
+#include "HaxBallField.h"
+
+///
+/// The reward functions are inline, such that templated rollouts (see Rollout.h) can inline them into the step loop.
+///
 namespace Reward
 {
   ///
@@ -16,9 +21,13 @@ namespace Reward
   ///
   /// Dense Reward / Reward Shaping
   ///
-  double distance_player_origin(const Eigen::Ref<const Eigen::VectorXd>& state,
-                                const Eigen::Ref<const Eigen::VectorXd>& action,
-                                const Eigen::Ref<const Eigen::VectorXd>& state_prime);
+  inline double distance_player_origin(const Eigen::Ref<const Eigen::VectorXd>& state,
+                                       const Eigen::Ref<const Eigen::VectorXd>& action,
+                                       const Eigen::Ref<const Eigen::VectorXd>& state_prime)
+  {
+    Eigen::Vector2d player_pos = state.segment(0, 2);
+    return -player_pos.norm();
+  }
 
   ///
   /// \brief Distance of the player from the ball
@@ -32,9 +41,23 @@ namespace Reward
   ///
   /// Dense Reward / Reward Shaping
   ///
-  double distance_player_ball_dense(const Eigen::Ref<const Eigen::VectorXd>& state,
-                                    const Eigen::Ref<const Eigen::VectorXd>& action,
-                                    const Eigen::Ref<const Eigen::VectorXd>& state_prime);
+  inline double distance_player_ball_dense(const Eigen::Ref<const Eigen::VectorXd>& state,
+                                           const Eigen::Ref<const Eigen::VectorXd>& action,
+                                           const Eigen::Ref<const Eigen::VectorXd>& state_prime)
+  {
+    Eigen::Vector2d player_pos = state.segment(0, 2);
+    Eigen::Vector2d ball_pos = state.segment(2, 2);
+
+    Eigen::Vector2d diff = player_pos - ball_pos ;
+
+    double distance = diff.norm();
+
+    // Exponential decay is also possible
+    // Factors to make the function suitable for the size of the field
+    // return 5.0 * std::exp(-0.5*distance);
+
+    return -distance;
+  }
 
   ///
   /// \brief Binary indicator, whether the player is close to the ball
@@ -48,9 +71,28 @@ namespace Reward
   ///
   /// Sparse Reward
   ///
-  double distance_player_ball_sparse(const Eigen::Ref<const Eigen::VectorXd>& state,
-                                     const Eigen::Ref<const Eigen::VectorXd>& action,
-                                     const Eigen::Ref<const Eigen::VectorXd>& state_prime);
+  inline double distance_player_ball_sparse(const Eigen::Ref<const Eigen::VectorXd>& state,
+                                            const Eigen::Ref<const Eigen::VectorXd>& action,
+                                            const Eigen::Ref<const Eigen::VectorXd>& state_prime)
+  {
+    Eigen::Vector2d player_pos = state.segment(0, 2);
+    Eigen::Vector2d ball_pos = state.segment(2, 2);
+
+    Eigen::Vector2d diff = player_pos - ball_pos ;
+
+    double distance = diff.norm();
+
+    // Compile time constants, no environment required
+    constexpr double r = HaxBallField::RADIUS_BALL + HaxBallField::RADIUS_PLAYER;
+
+    if(distance < r * 1.25)
+    {
+      //qDebug() << "close enough";
+      return 1.0;
+    }
+
+    return 0.0;
+  }
 
   ///
   /// \brief Reward depending on the goal state
@@ -66,9 +108,21 @@ namespace Reward
   ///
   /// Sparse Reward
   ///
-  double ball_in_goal(const Eigen::Ref<const Eigen::VectorXd>& state,
-                      const Eigen::Ref<const Eigen::VectorXd>& action,
-                      const Eigen::Ref<const Eigen::VectorXd>& state_prime);
+  inline double ball_in_goal(const Eigen::Ref<const Eigen::VectorXd>& state,
+                             const Eigen::Ref<const Eigen::VectorXd>& action,
+                             const Eigen::Ref<const Eigen::VectorXd>& state_prime)
+  {
+    // Must be the current state, because the successor state is already that with the ball at the origin
+    Eigen::Vector2d ball_pos = state.segment(2, 2);
+
+    if(HaxBallField::GOAL_LEFT.contains(ball_pos(0), ball_pos(1)))
+      return -100.0;
+
+    if(HaxBallField::GOAL_RIGHT.contains(ball_pos(0), ball_pos(1)))
+      return +100.0;
+
+    return 0.0;
+  }
 }
 
 #endif // REWARDFUNCTIONS_H